@@ -0,0 +1,58 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include <cstdint>
+
+#include "CsmPhraseBank.h"
+#include "Latency.h"
+#include "Memory.h"
+#include "MidiChannel.h"
+#include "MidiProcessor.h"
+#include "OpnProbe.h"
+#include "Profile.h"
+#include "SeqLock.h"
+#include "ToneBank.h"
+#include "Voice.h"
+#include "VoiceAllocator.h"
+#include "config.h"
+
+/**
+ * @brief デバッガで表示するMIDI Channel/Voiceの状態
+ * @details Core0がMIDIの処理の合間に取得し、Core1が整形して表示する。
+ *          Core0ではprintfを呼び出さないので、表示中もMIDIの処理が止まらない
+ */
+struct DebugSnapshot {
+    ChannelState channels[MIDI_CABLES * MIDI_CHANNELS];  // ケーブル番号 * MIDI_CHANNELS + CH
+    VoiceState voices[MAX_VOICES];                       // 全Voice
+    int voice_count;                                     // voicesの有効数
+    // 統計情報
+    uint32_t time_ms;              // スナップショットを取得した時刻(ms)
+    AllocStats alloc;              // Voiceの割り当ての統計
+    uint32_t tone_load_count;      // 音色を設定した回数
+    uint32_t reorder_count;        // 並べ替えたNote Offの数
+    uint32_t create_us;            // MidiFactory::Create()の処理時間(us)
+    uint32_t ready_ms;             // 起動からMIDIメッセージの処理を開始するまでの時間(ms)
+    ResetTime reset;               // MIDIリセットの処理時間
+    OpnType dock_type[MAX_DOCKS];  // Dockに接続されたFM音源LSI
+    ToneBankState tone_bank;  // ユーザー音色の割り当て
+#if ENABLE_CSM != 0
+    PhraseBankState phrase_bank;  // ユーザーフレーズバンクの割り当て
+#endif
+#if ENABLE_LATENCY == 1
+    Latency::Histograms latency;  // レイテンシのヒストグラム(DEBUGGER_LATENCYで更新)
+#endif
+#if ENABLE_PROFILE == 1
+    ProfileEntry profile[PROFILE_POINT_NUM];  // 実行サイクル数の集計(DEBUGGER_PROFILEで更新)
+#endif
+#if ENABLE_MEMORY_STATS == 1
+    MemoryStats memory;  // ヒープとスタックの使用状況(DEBUGGER_MEMORYで更新)
+#endif
+};
+
+namespace Debugger {
+extern SeqLock<DebugSnapshot> gSnapshot;  // Core0 → Core1
+};  // namespace Debugger
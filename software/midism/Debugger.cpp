@@ -10,7 +10,13 @@
 #include <cstdio>
 #include <cstring>
 
-#include "VoiceAllocator.h"
+#include "BusLoad.h"
+#include "DebugSnapshot.h"
+#include "Latency.h"
+#include "Memory.h"
+#include "Profile.h"
+#include "RP2040.h"
+#include "Trace.h"
 #include "pico/multicore.h"
 #include "pico/stdlib.h"
 
@@ -21,6 +27,11 @@ using namespace Debugger;
  *********************************************************/
 volatile uint8_t Debugger::gDEBUG_LEVEL = 0;
 volatile bool Debugger::gMidiMode       = true;
+SeqLock<DebugSnapshot> Debugger::gSnapshot;
+
+static void (*idle_func)(void) = nullptr;  // コマンド入力・応答待ちの間に呼び出す関数
+static DebugSnapshot snapshot;             // 表示するスナップショット(Core1のスタックに置かない)
+static constexpr uint32_t SNAPSHOT_TIMEOUT_US = 1000000;  // スナップショットの応答待ち時間(us)
 
 #define DLIMITER   " "
 #define MAX_TOKENS 4
@@ -40,18 +51,42 @@ static int exec_command(token_list* t);
 #define ERR_COMMAND    (-1)
 #define ERR_PARAM_VAL  (-2)
 #define ERR_PARAM_MISS (-3)
+#define ERR_TIMEOUT    (-4)
 
 /*********************************************************
  * Monitor main
  *********************************************************/
-void Debugger::main(void) {
+void Debugger::main(void (*idle)(void)) {
     token_list tokens;
     char cmd_line[32];
+    int len  = 0;  // 入力済みの文字数
+    int prev = 0;  // 直前の入力文字
+    idle_func = idle;
 
+    putchar('>');
     while (1) {
-        putchar('>');
-        while (fgets(cmd_line, sizeof(cmd_line) - 1, stdin) == NULL);
-        cmd_line[strcspn(cmd_line, "\r\n")] = '\0';
+        // 1文字ずつ読み取り、入力がない間はidle()に処理を譲る
+        int c = getchar_timeout_us(0);
+        if (c == PICO_ERROR_TIMEOUT) {
+            if (idle) {
+                idle();
+            }
+            continue;
+        }
+        bool eol  = (c == '\r' || c == '\n');
+        bool crlf = (c == '\n' && prev == '\r');
+        prev      = c;
+        if (!eol) {
+            if (len < (int)sizeof(cmd_line) - 1) {
+                cmd_line[len++] = c;
+            }
+            continue;
+        }
+        if (crlf) {
+            continue;  // CR LFは1行とする
+        }
+        cmd_line[len] = '\0';
+        len           = 0;
         puts(cmd_line);
         tokenizer(cmd_line, DLIMITER, &tokens);
         switch (exec_command(&tokens)) {
@@ -66,10 +101,14 @@ void Debugger::main(void) {
         case ERR_PARAM_MISS:
             puts("missing param.");
             break;
+        case ERR_TIMEOUT:
+            puts("no response.");
+            break;
         default:
             puts("error!");
             break;
         }
+        putchar('>');
     }
 }
 
@@ -118,6 +157,12 @@ static int c_midi_reset(token_list* t);
 static int c_midi_dump_channel(token_list* t);
 static int c_midi_dump_voice(token_list* t);
 static int c_midi_stats(token_list* t);
+static int c_trace(token_list* t);
+static int c_latency(token_list* t);
+static int c_bus(token_list* t);
+static int c_profile(token_list* t);
+static int c_memory(token_list* t);
+static int c_bank(token_list* t);
 
 static const struct {
     const char* name;
@@ -129,6 +174,12 @@ static const struct {
     {    "dc", c_midi_dump_channel},
     {    "dv",   c_midi_dump_voice},
     { "stats",        c_midi_stats},
+    {    "tr",             c_trace},
+    {   "lat",           c_latency},
+    {   "bus",               c_bus},
+    {  "prof",           c_profile},
+    {   "mem",            c_memory},
+    {  "bank",              c_bank},
     {     "h",              c_help},
     {      "",                NULL}
 };
@@ -156,11 +207,17 @@ static int c_help(token_list* t) {
         "   [] : optional\n"
         "h        : Help\n"
         "dl [0-5] : Set debug print level\n"
-        "dc [0-15]: Dump MIDI Channel parameters\n"
+        "dc [0-63]: Dump MIDI Channel parameters (Cable*16+CH)\n"
         "dv       : Dump MIDI Voice parameters\n"
         "mm [0-1] : MIDI Mode 0:Ignore MIDI, 1:Process MIDI\n"
         "stats    : Statistics\n"
         "mreset   : MIDI Reset\n"
+        "tr [0-1] : Trace output 0:Text, 1:Raw (tools/trace_decode.py)\n"
+        "lat [0-1]: Print and reset MIDI latency histograms 1:with buckets\n"
+        "bus [0-1]: Bus utilization per Dock and register 1:with access counts\n"
+        "prof [0-1]: Function cycle profile 1:reset after print\n"
+        "mem [0-1]: Heap and stack usage 1:reset counts after print\n"
+        "bank     : User tone/phrase bank slots\n"
         "";
 
     puts(help_str);
@@ -202,18 +259,52 @@ static int c_midi_reset(token_list* t) {
     return NO_ERROR;
 }
 
+/*********************************************************
+ * Snapshot
+ *********************************************************/
+// Core0にスナップショットの更新を要求し、snapshotにコピーする
+static int request_snapshot(uint32_t cmd = DEBUGGER_SNAPSHOT) {
+    uint32_t seq = gSnapshot.GetSequence();
+    multicore_fifo_push_blocking(cmd);
+    uint32_t start = time_us_32();
+    while (time_us_32() - start < SNAPSHOT_TIMEOUT_US) {
+        if (gSnapshot.GetSequence() != seq && gSnapshot.TryRead(snapshot)) {
+            return NO_ERROR;
+        }
+        if (idle_func) {
+            idle_func();
+        }
+    }
+    return ERR_TIMEOUT;
+}
+
 /*********************************************************
  * Dump MIDI Channel parameters
  *********************************************************/
 static int c_midi_dump_channel(token_list* t) {
-    if (t->n == 1) {
-        // Dummp All channels
-        multicore_fifo_push_blocking(DEBUGGER_DUMP_CHANNEL | (0xff << 8));
-    } else if (t->n > 1) {
+    unsigned int ch = 0xff;
+    if (t->n > 1) {
         // Dump specified channel
-        unsigned int ch = 0;
-        get_uint(t, T_PARAM1, &ch);
-        multicore_fifo_push_blocking(DEBUGGER_DUMP_CHANNEL | (ch << 8));
+        int err = get_uint(t, T_PARAM1, &ch);
+        if (err != NO_ERROR) {
+            return err;
+        }
+        if (ch >= MIDI_CABLES * MIDI_CHANNELS) {
+            return ERR_PARAM_VAL;
+        }
+    }
+    int err = request_snapshot();
+    if (err != NO_ERROR) {
+        return err;
+    }
+    if (ch == 0xff) {
+        // Dummp All channels
+        for (auto& s : snapshot.channels) {
+            MidiChannel::print(s);
+        }
+    } else {
+        // チャンネル番号は、ケーブル番号 * MIDI_CHANNELS + チャンネル番号
+        MidiChannel::print(snapshot.channels[ch]);
     }
     return NO_ERROR;
 }
@@ -222,7 +313,14 @@ static int c_midi_dump_channel(token_list* t) {
  * Dump MIDI Voice parameters
  *********************************************************/
 static int c_midi_dump_voice(token_list* t) {
-    multicore_fifo_push_blocking(DEBUGGER_DUMP_VOICE);
+    int err = request_snapshot();
+    if (err != NO_ERROR) {
+        return err;
+    }
+    printf("\n=== Voice List ===\n");
+    for (int i = 0; i < snapshot.voice_count; i++) {
+        Voice::print(snapshot.voices[i]);
+    }
     return NO_ERROR;
 }
 
@@ -230,6 +328,172 @@ static int c_midi_dump_voice(token_list* t) {
  * Statistics
  *********************************************************/
 static int c_midi_stats(token_list* t) {
-    multicore_fifo_push_blocking(DEBUGGER_STATS);
+    int err = request_snapshot();
+    if (err != NO_ERROR) {
+        return err;
+    }
+    const AllocStats& a = snapshot.alloc;
+    printf("\nVoice allocation: local=%u pool=%u steal=%u failure=%u\n", a.path[AllocStats::LOCAL],
+           a.path[AllocStats::POOL], a.path[AllocStats::STEAL], a.path[AllocStats::FAILED]);
+    printf("Tone load: %u (allocation local=%u pool=%u steal=%u)\n", snapshot.tone_load_count,
+           a.tone_load[AllocStats::LOCAL], a.tone_load[AllocStats::POOL],
+           a.tone_load[AllocStats::STEAL]);
+    printf("Module affinity: %u/%u (%u%%)\n", a.hint_hit, a.hint,
+           a.hint ? (uint32_t)((uint64_t)a.hint_hit * 100 / a.hint) : 0);
+#if ENABLE_CSM != 0
+    printf("CH3 revoke: %u (cut %u)\n", a.revoke, a.revoke_cut);
+#endif
+    // Voiceごとのキーオンしていた時間の割合(MIDIリセットからの経過時間に対する%)
+    uint32_t elapsed = snapshot.time_ms - a.start_ms;
+    printf("Voice busy(%%) in %ums:", elapsed);
+    for (int i = 0; i < snapshot.voice_count; i++) {
+        const VoiceState& v = snapshot.voices[i];
+        printf("%s%02d:%3u", (i % 8) ? " " : "\n  ", v.id,
+               elapsed ? (uint32_t)((uint64_t)v.busy_ms * 100 / elapsed) : 0);
+    }
+    printf("\n");
+#if ENABLE_NOTEOFF_REORDER == 1
+    printf("NoteOff reordered: %d\n", snapshot.reorder_count);
+#endif
+    printf("Docks:");
+    for (int d = 0; d < MAX_DOCKS; d++) {
+        printf(" %d:%s", d, opn_type_name(snapshot.dock_type[d]));
+    }
+    printf("\n");
+    const ResetTime& r = snapshot.reset;
+    printf("Ready: boot=%ums (create=%uus) reset=%uus (max=%uus, %u times)\n", snapshot.ready_ms,
+           snapshot.create_us, r.last_us, r.max_us, r.count);
+    for (int core = 0; core < 2; core++) {
+        BusWaitStats bus = bus_wait_stats(core);
+        printf("Bus core%d: access=%u wait=%u total=%uus max=%uus\n", core, bus.count,
+               bus.contended, bus.wait_us, bus.max_wait);
+    }
+    for (auto& s : snapshot.channels) {
+        MidiChannel::print_stats(s);
+    }
+    return NO_ERROR;
+}
+
+/*********************************************************
+ * Trace
+ *********************************************************/
+static int c_trace(token_list* t) {
+#if ENABLE_TRACE == 1
+    unsigned int mode = 0;
+    if (t->n > 1) {
+        int err = get_uint(t, T_PARAM1, &mode);
+        if (err != NO_ERROR) {
+            return err;
+        }
+        Trace::gRawMode = (mode == 0) ? false : true;
+    }
+    printf("Trace: %s, dropped core0=%u core1=%u\n", Trace::gRawMode ? "Raw" : "Text",
+           Trace::gRing[0].GetDrops(), Trace::gRing[1].GetDrops());
     return NO_ERROR;
-}
\ No newline at end of file
+#else
+    return ERR_COMMAND;
+#endif
+}
+
+/*********************************************************
+ * Latency
+ *********************************************************/
+static int c_latency(token_list* t) {
+#if ENABLE_LATENCY == 1
+    unsigned int buckets = 0;
+    if (t->n > 1) {
+        int err = get_uint(t, T_PARAM1, &buckets);
+        if (err != NO_ERROR) {
+            return err;
+        }
+    }
+    int err = request_snapshot(DEBUGGER_LATENCY);
+    if (err != NO_ERROR) {
+        return err;
+    }
+    Latency::print(snapshot.latency, buckets != 0);
+    return NO_ERROR;
+#else
+    return ERR_COMMAND;
+#endif
+}
+
+/*********************************************************
+ * Bus utilization
+ *********************************************************/
+static int c_bus(token_list* t) {
+#if ENABLE_BUS_STATS == 1
+    unsigned int counts = 0;
+    if (t->n > 1) {
+        int err = get_uint(t, T_PARAM1, &counts);
+        if (err != NO_ERROR) {
+            return err;
+        }
+    }
+    BusLoad::print(counts != 0);
+    return NO_ERROR;
+#else
+    return ERR_COMMAND;
+#endif
+}
+
+/*********************************************************
+ * Profile
+ *********************************************************/
+static int c_profile(token_list* t) {
+#if ENABLE_PROFILE == 1
+    unsigned int reset = 0;
+    if (t->n > 1) {
+        int err = get_uint(t, T_PARAM1, &reset);
+        if (err != NO_ERROR) {
+            return err;
+        }
+    }
+    int err = request_snapshot(DEBUGGER_PROFILE | (reset ? 0x100 : 0));
+    if (err != NO_ERROR) {
+        return err;
+    }
+    Profile::print(snapshot.profile);
+    return NO_ERROR;
+#else
+    return ERR_COMMAND;
+#endif
+}
+
+/*********************************************************
+ * Memory
+ *********************************************************/
+static int c_memory(token_list* t) {
+#if ENABLE_MEMORY_STATS == 1
+    unsigned int reset = 0;
+    if (t->n > 1) {
+        int err = get_uint(t, T_PARAM1, &reset);
+        if (err != NO_ERROR) {
+            return err;
+        }
+    }
+    int err = request_snapshot(DEBUGGER_MEMORY | (reset ? 0x100 : 0));
+    if (err != NO_ERROR) {
+        return err;
+    }
+    Memory::print(snapshot.memory);
+    return NO_ERROR;
+#else
+    return ERR_COMMAND;
+#endif
+}
+
+/*********************************************************
+ * User bank
+ *********************************************************/
+static int c_bank(token_list* t) {
+    int err = request_snapshot();
+    if (err != NO_ERROR) {
+        return err;
+    }
+    ToneBank::print(snapshot.tone_bank);
+#if ENABLE_CSM != 0
+    CsmPhraseBank::print(snapshot.phrase_bank);
+#endif
+    return NO_ERROR;
+}
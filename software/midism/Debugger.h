@@ -26,10 +26,11 @@ namespace Debugger {
 /*
  * Debugger commands
  */
-constexpr uint8_t DEBUGGER_MIDI_RESET   = 0x01;
-constexpr uint8_t DEBUGGER_DUMP_CHANNEL = 0x02;
-constexpr uint8_t DEBUGGER_DUMP_VOICE   = 0x03;
-constexpr uint8_t DEBUGGER_STATS        = 0x04;
+constexpr uint8_t DEBUGGER_MIDI_RESET = 0x01;
+constexpr uint8_t DEBUGGER_SNAPSHOT   = 0x02;  // gSnapshotの更新要求
+constexpr uint8_t DEBUGGER_LATENCY    = 0x03;  // gSnapshot.latencyの更新とヒストグラムのリセット
+constexpr uint8_t DEBUGGER_PROFILE    = 0x04;  // gSnapshot.profileの更新(bit8:集計のリセット)
+constexpr uint8_t DEBUGGER_MEMORY     = 0x05;  // gSnapshot.memoryの更新(bit8:回数のリセット)
 
 /*
  * Debugger control variables
@@ -40,5 +41,9 @@ extern volatile uint8_t gDEBUG_LEVEL;
 /*
  * Debugger functions
  */
-extern void main(void);
+/**
+ * @brief デバッガのメインループ(Core1)
+ * @param idle コマンド入力待ちの間に繰り返し呼び出す関数(nullptr可)
+ */
+extern void main(void (*idle)(void));
 };  // namespace Debugger
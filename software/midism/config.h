@@ -5,23 +5,111 @@
 // See LICENSE file for details.
 //
 #pragma once
+#include <cstdint>
 
 // システムでサポートするMIDIチャンネル数(1-16)
 constexpr int MIDI_CHANNELS = 16;
 
+// USB MIDIの仮想ケーブル数(1-4)
+// ケーブルごとに独立したMIDI_CHANNELS分のチャンネルを持つ
+// (USBディスクリプタの生成でプリプロセッサから参照するため#defineとする)
+#define MIDI_CABLES 2
+
+// FM音源モジュールのDock数(/CS2-0で選択できる最大数)と、モジュールあたりのFMチャンネル数
+// (YM2608/YM2203の多い方)。VoiceとMIDIチャンネルを生成する静的な領域の大きさは、この構成から決まる
+// 起動時に全Dockを調べ、接続されているFM音源モジュールだけを使う
+constexpr int MAX_DOCKS            = 8;
+constexpr int FM_CHANNELS_PER_DOCK = 6;
+// FM音源LSIのクロック(kHz)
+constexpr float YM2608_CLOCK = 8000.0;
+constexpr float YM2203_CLOCK = 4000.0;
+
+// ケーブルごとに使用するDockのビットマップ(bit0:Dock0 - bit7:Dock7)
+// 全ケーブルで同じ値にするとVoiceを共有し、重ならない値にすると分割して使用する
+// MIDI_CABLESを変更した場合は全ケーブル分を指定すること(0のケーブルはビルドエラーになる)
+constexpr uint8_t MIDI_CABLE_DOCKS[MIDI_CABLES] = {
+    0xff,  // Cable 0
+    0xff,  // Cable 1
+};
+
+// DIN MIDI入力(UART)の有効化
+#define ENABLE_DIN_MIDI 1
+#if ENABLE_DIN_MIDI == 1
+// DIN MIDI入力を合流させるケーブル番号(ケーブルのMIDIチャンネルを共有する)
+constexpr int DIN_MIDI_CABLE = 0;
+#endif
+
+// 一度に受信したMIDIメッセージのうち、Note Offを先に処理する
+// (Note Onで他チャンネルのVoiceを回収する前に、同じバッチ内のNote Offで空いたVoiceを使う)
+#define ENABLE_NOTEOFF_REORDER 1
+
 // デバッグモードの有効化
 #define ENABLE_DEUGGER                         1
 #define ENABLE_DEBUG_PRINT                     1
+// MIDI処理のトレース(DPRINTFの代わりにバイナリで記録し、Core1で表示する)
+#define ENABLE_TRACE                           1
+#if ENABLE_TRACE == 1
+constexpr int TRACE_RING_SIZE = 256;  // コアごとのトレースのレコード数(2のべき乗)
+#endif
+// MIDIメッセージの受信からキーオンまでのレイテンシのヒストグラム(latコマンドで表示)
+#define ENABLE_LATENCY                         1
+// FM音源モジュールのバスのアクセス回数と使用時間の計測(busコマンドで表示)
+#define ENABLE_BUS_STATS                       1
+#if ENABLE_BUS_STATS == 1
+constexpr uint32_t BUS_SAMPLE_US = 100000;  // 使用率のサンプリング周期(us)
+constexpr int BUS_WINDOW         = 10;      // 使用率を求める区間(サンプル数)
+#endif
+// 主要な関数の実行サイクル数の計測(profコマンドで表示)
+#define ENABLE_PROFILE                         1
+// SysExによる統計情報の取得(UARTのコンソールを接続しない環境用)
+#define ENABLE_TELEMETRY                       1
+// ヒープとスタックの使用量の計測(memコマンドで表示)
+#define ENABLE_MEMORY_STATS                    1
 
 // CSMボイスの有効化
 #define ENABLE_CSM                             1
 
+// CSM Voiceの構成(CSM Voiceごとに使用するDockのビットマップ)
+// CSM Voiceに割り当てたDockのCH3は音楽用に使わない。Dockが重複してはいけない。
+// フレームは最下位のDockのTimer B(/IRQ)で更新するので、最下位のDockはDock0-3にすること。
+// 1 Dockあたり4オペレータで、CSM_N(VOICE.dat)より少ない場合は先頭のオペレータから使う。
+// 例) {0x01, 0x02}: Dock 0とDock 1にそれぞれ4オペレータのCSM Voice
+constexpr uint8_t CSM_VOICE_DOCKS[] = {
+    0x07,  // Dock 0-2 (12オペレータ)
+};
+constexpr int CSM_VOICES = sizeof(CSM_VOICE_DOCKS) / sizeof(CSM_VOICE_DOCKS[0]);
+// CSM Voiceが発音していない間、CSM Voiceに割り当てたDockのCH3を音楽用に使う場合は1にする
+// (0の場合、CH3は常にCSMモードにしておく)
+#define ENABLE_CSM_CH3_LENDING                 1
+
+// ユーザー音色バンク数(128音色単位, RAM上に確保する)
+constexpr int USER_TONE_BANKS = 4;
+// ユーザー音色バンクをFlashに保存する場合は1にする
+#define ENABLE_TONE_BANK_FLASH                 1
+
+// ユーザーCSMフレーズバンク数とサイズ(RAM上に確保する)
+constexpr int USER_PHRASE_BANKS     = 2;
+constexpr int USER_PHRASE_BANK_SIZE = 6 * 1024;
+// ユーザーCSMフレーズバンクをFlashに保存する場合は1にする
+#define ENABLE_PHRASE_BANK_FLASH               1
+// CSMフレームを補間するサブフレーム数(1:補間しない)
+// Timer Bの周期はFRAME_PERIOD / CSM_SUBFRAMESになる
+constexpr int CSM_SUBFRAMES = 1;
+
 // COARSE TUNEの有効化
 #define ENABLE_COARSE_TUNE                     1
 
 // MIDIパネルを接続する場合は1にする
 #define ENABLE_MIDI_PANEL                      1
 #if ENABLE_MIDI_PANEL == 1
+// パネルの走査周期(us, 1列あたり)。4列で1周する
+constexpr uint32_t PANEL_SCAN_US       = 2000;
+// スイッチのチャタリング除去時間(us)
+constexpr uint32_t PANEL_DEBOUNCE_US   = 20000;
+// MIDIリセットボタンの長押し時間(us)
+constexpr uint32_t PANEL_RESET_HOLD_US = 1000000;
+// MIDI入力の処理待ちで走査を保留する最大時間(us)
+constexpr uint32_t PANEL_MAX_YIELD_US  = 100000;
 // OPNAモジュールのバグ対策
 #define ENABLE_CONNECTOR_WIRING_BUG_WORKAROUND 1
 #endif
@@ -0,0 +1,97 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#include "BusLoad.h"
+
+#include <cstdio>
+
+#include "hardware/timer.h"
+
+#if ENABLE_BUS_STATS == 1
+/**
+ * @brief 占有時間の記録
+ */
+struct BusSample {
+    uint32_t time;                             // 記録した時刻(us)
+    uint32_t busy_us[BUS_DOCKS][BUS_CLASSES];  // 占有時間の合計(us)
+};
+
+static BusSample samples[BUS_WINDOW];  // 直近の記録(リングバッファ)
+static int sample_count = 0;           // 記録した数(BUS_WINDOWで飽和)
+static int sample_next  = 0;           // 次に書き込む位置
+
+static const char* const class_names[BUS_CLASSES] = {"FM_OP", "FM_CH", "KEYON", "RHYTHM", "SSG",
+                                                     "TIMER", "PORT",  "STAT",  "OTHER"};
+
+static void take(BusSample& s, uint32_t now) {
+    s.time = now;
+    for (int d = 0; d < BUS_DOCKS; d++) {
+        for (int c = 0; c < BUS_CLASSES; c++) {
+            s.busy_us[d][c] = bus_counters(d, (BusClass)c).busy_us;
+        }
+    }
+}
+
+void BusLoad::Sample(uint32_t now) {
+    if (sample_count > 0) {
+        int last = (sample_next + BUS_WINDOW - 1) % BUS_WINDOW;
+        if (now - samples[last].time < BUS_SAMPLE_US) {
+            return;
+        }
+    }
+    take(samples[sample_next], now);
+    sample_next = (sample_next + 1) % BUS_WINDOW;
+    if (sample_count < BUS_WINDOW) {
+        ++sample_count;
+    }
+}
+
+void BusLoad::print(bool counts) {
+    static BusSample now;  // Core1のスタックに置かない
+    take(now, time_us_32());
+    if (sample_count == 0) {
+        return;
+    }
+    // 最も古い記録から現在までの区間
+    const BusSample& old = samples[(sample_next + BUS_WINDOW - sample_count) % BUS_WINDOW];
+    uint32_t window      = now.time - old.time;
+    if (window == 0) {
+        return;
+    }
+
+    printf("Bus utilization(%%) last %ums\n      ", window / 1000);
+    for (int c = 0; c < BUS_CLASSES; c++) {
+        printf("%7s", class_names[c]);
+    }
+    printf("  TOTAL\n");
+    uint32_t bus_total = 0;
+    for (int d = 0; d < BUS_DOCKS; d++) {
+        uint32_t dock_total = 0;
+        printf("DOCK%d ", d);
+        for (int c = 0; c < BUS_CLASSES; c++) {
+            uint32_t busy = now.busy_us[d][c] - old.busy_us[d][c];
+            dock_total += busy;
+            printf("%7.1f", 100.0f * busy / window);
+        }
+        printf("%7.1f\n", 100.0f * dock_total / window);
+        bus_total += dock_total;
+    }
+    printf("Bus total: %.1f%%\n", 100.0f * bus_total / window);
+
+    if (counts) {
+        printf("Bus access         writes      reads     busy(us)\n");
+        for (int d = 0; d < BUS_DOCKS; d++) {
+            for (int c = 0; c < BUS_CLASSES; c++) {
+                BusCounters bc = bus_counters(d, (BusClass)c);
+                if (bc.writes || bc.reads) {
+                    printf("DOCK%d %-8s %10u %10u %12u\n", d, class_names[c], bc.writes, bc.reads,
+                           bc.busy_us);
+                }
+            }
+        }
+    }
+}
+#endif
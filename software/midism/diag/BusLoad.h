@@ -0,0 +1,35 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include <cstdint>
+
+#include "RP2040.h"
+#include "config.h"
+
+#if ENABLE_BUS_STATS == 1
+/**
+ * @brief FM音源モジュールのバスの使用率(Core1)
+ * @details
+ * HAL(RP2040)が数えるDock・レジスタ分類ごとの占有時間を一定周期で記録し、
+ * 直近BUS_WINDOWサンプル分の区間の増分から使用率を求める。
+ * 音切れがバスの飽和によるものか、Voiceの不足によるものかの切り分けに使う。
+ */
+namespace BusLoad {
+/**
+ * @brief 占有時間を記録する
+ * @param now 現在時刻(us)
+ * @details 頻繁に呼び出してよい。前回の記録からBUS_SAMPLE_US経過した場合だけ記録する
+ */
+extern void Sample(uint32_t now);
+
+/**
+ * @brief 使用率を表示する
+ * @param counts true:アクセス回数と占有時間の累計も表示する
+ */
+extern void print(bool counts);
+};  // namespace BusLoad
+#endif
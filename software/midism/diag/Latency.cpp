@@ -0,0 +1,84 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#include "Latency.h"
+
+#include <cstdio>
+#include <cstring>
+
+uint32_t LatencyHistogram::Percentile(int percent) const {
+    if (count == 0) {
+        return 0;
+    }
+    // count * percent / 100 番目(切り上げ)の値を含むバケットを探す
+    uint32_t rank = ((uint64_t)count * percent + 99) / 100;
+    uint32_t sum  = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        sum += bucket[i];
+        if (sum >= rank) {
+            uint32_t us = (i < BUCKETS - 1) ? upper(i) : max;  // 最後のバケットは上限なし
+            return (us < max) ? us : max;
+        }
+    }
+    return max;
+}
+
+#if ENABLE_LATENCY == 1
+Latency::Pending Latency::gPending = {0, 0, 0, -1, false, false};
+
+static Latency::Histograms histograms;  // Core0だけが更新する
+
+void Latency::End() {
+    if (gPending.type < 0) {
+        return;
+    }
+    int type = gPending.type;
+    if (type == NOTE_ON && gPending.loaded) {
+        type = NOTE_ON_LOAD;
+    }
+    LatencyHistogram* h = histograms.h[type];
+    h[DISPATCH].Add(gPending.dispatch - gPending.arrival);
+    if (gPending.keyed) {
+        h[KEY_ON].Add(gPending.key_on - gPending.arrival);
+    }
+    h[DONE].Add(time_us_32() - gPending.arrival);
+    gPending.type = -1;
+}
+
+void Latency::Take(Histograms& out) {
+    memcpy(&out, &histograms, sizeof(Histograms));
+    memset(&histograms, 0, sizeof(Histograms));
+}
+
+const Latency::Histograms& Latency::Get() {
+    return histograms;
+}
+
+void Latency::print(const Histograms& hist, bool buckets) {
+    static const char* const type_names[TYPES]   = {"NoteOn", "NoteOn+load", "NoteOff",
+                                                    "Control", "Program", "Other"};
+    static const char* const stage_names[STAGES] = {"dispatch", "key on", "done"};
+
+    printf("Latency(us)           count    p50    p99    max\n");
+    for (int type = 0; type < TYPES; type++) {
+        for (int stage = 0; stage < STAGES; stage++) {
+            const LatencyHistogram& h = hist.h[type][stage];
+            if (h.count == 0) {
+                continue;
+            }
+            printf("%-11s %-8s %7u %6u %6u %6u\n", type_names[type], stage_names[stage], h.count,
+                   h.Percentile(50), h.Percentile(99), h.max);
+            if (buckets) {
+                for (int i = 0; i < LatencyHistogram::BUCKETS; i++) {
+                    if (h.bucket[i]) {
+                        printf("    <=%5u: %u\n", LatencyHistogram::upper(i), h.bucket[i]);
+                    }
+                }
+            }
+        }
+    }
+}
+#endif
@@ -0,0 +1,219 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include <cstdint>
+
+#include "config.h"
+#include "hardware/timer.h"
+
+/**
+ * @brief レイテンシのヒストグラム
+ * @details
+ * 2のべき乗の区間をさらに2つに分けた対数バケットで数える(バケットの幅は値の1/2以下)。
+ * パーセンタイルはバケットの上限で近似し、最大値は別に保持する。
+ */
+struct LatencyHistogram {
+    static constexpr int BUCKETS = 32;  // 0us - 65535us(それ以上は最後のバケット)
+
+    uint32_t bucket[BUCKETS];  // バケットごとの回数
+    uint32_t count;            // 回数
+    uint32_t max;              // 最大値(us)
+
+    /**
+     * @brief 値を追加する
+     * @param us レイテンシ(us)
+     */
+    void Add(uint32_t us) {
+        ++bucket[index(us)];
+        ++count;
+        if (us > max) {
+            max = us;
+        }
+    }
+
+    /**
+     * @brief パーセンタイルを返す
+     * @param percent パーセント(1-100)
+     * @return 該当するバケットの上限(us, 最大値を超えない)
+     */
+    uint32_t Percentile(int percent) const;
+
+    /**
+     * @brief 値からバケットの番号を求める
+     */
+    static int index(uint32_t us) {
+        if (us < 2) {
+            return us;
+        }
+        int e = 31 - __builtin_clz(us);
+        int i = 2 * e + ((us >> (e - 1)) & 1);
+        return (i < BUCKETS) ? i : BUCKETS - 1;
+    }
+
+    /**
+     * @brief バケットの上限(us)を返す
+     */
+    static uint32_t upper(int index) {
+        if (index < 2) {
+            return index;
+        }
+        int e = index / 2;
+        return ((2u + (index & 1)) << (e - 1)) + (1u << (e - 1)) - 1;
+    }
+};
+
+/**
+ * @brief MIDIメッセージのレイテンシの計測(Core0)
+ * @details
+ * 受信(USB MIDIのパケットやDIN MIDIのバイトを読み出した時刻)を起点として、
+ * 以下の経過時間をメッセージの種類ごとのヒストグラムに記録する。
+ * - DISPATCH: MidiProcessor::process_event()で処理を始めるまで(バッチ内の待ち)
+ * - KEY_ON  : 最後のキーオン(fm_turnon_key/rtm_turnon_key)のレジスタ書き込みまで
+ * - DONE    : メッセージの処理を終えるまで
+ * 音色の設定を伴ったNote Onは、音色の転送時間がわかるようNOTE_ON_LOADに分けて数える。
+ * System Common/Realtime Message、SysEx、無効なチャンネルのメッセージは記録しない。
+ */
+namespace Latency {
+/**
+ * @brief メッセージの種類
+ */
+enum Type {
+    NOTE_ON,       // Note On
+    NOTE_ON_LOAD,  // Note On(音色の設定あり)
+    NOTE_OFF,      // Note Off(ベロシティ0のNote Onを含む)
+    CONTROL,       // Control Change
+    PROGRAM,       // Program Change
+    OTHER,         // その他のChannel Voice Message
+    TYPES,
+};
+
+/**
+ * @brief 計測区間
+ */
+enum Stage {
+    DISPATCH,  // 受信 → 処理開始
+    KEY_ON,    // 受信 → キーオン
+    DONE,      // 受信 → 処理終了
+    STAGES,
+};
+
+/**
+ * @brief 全種類のヒストグラム
+ */
+struct Histograms {
+    LatencyHistogram h[TYPES][STAGES];
+};
+};  // namespace Latency
+
+#if ENABLE_LATENCY == 1
+namespace Latency {
+/**
+ * @brief 処理中のメッセージの時刻
+ */
+struct Pending {
+    uint32_t arrival;   // 受信した時刻(us)
+    uint32_t dispatch;  // 処理を始めた時刻(us)
+    uint32_t key_on;    // 最後にキーオンした時刻(us)
+    int8_t type;        // Type(-1:記録しない)
+    bool keyed;         // キーオンした
+    bool loaded;        // 音色を設定した
+};
+extern Pending gPending;
+
+/**
+ * @brief メッセージの処理を始める
+ * @param arrival 受信した時刻(us)
+ */
+inline void Begin(uint32_t arrival) {
+    gPending.arrival = arrival;
+    gPending.type    = -1;
+    gPending.keyed   = false;
+    gPending.loaded  = false;
+}
+
+/**
+ * @brief メッセージの種類を判定し、処理開始の時刻を記録する
+ * @param msg MIDIメッセージ(ランニングステータスを展開済み)
+ */
+inline void Dispatch(const uint8_t msg[3]) {
+    gPending.dispatch = time_us_32();
+    switch (msg[0] & 0xf0) {
+    case 0x90:
+        gPending.type = (msg[2] != 0) ? NOTE_ON : NOTE_OFF;
+        break;
+    case 0x80:
+        gPending.type = NOTE_OFF;
+        break;
+    case 0xb0:
+        gPending.type = CONTROL;
+        break;
+    case 0xc0:
+        gPending.type = PROGRAM;
+        break;
+    case 0xf0:
+        gPending.type = -1;
+        break;
+    default:
+        gPending.type = OTHER;
+        break;
+    }
+}
+
+/**
+ * @brief キーオンの時刻を記録する
+ * @details メッセージの処理中でなければ何もしない(CSM Voiceのフレーム更新など)
+ */
+inline void KeyOn() {
+    if (gPending.type >= 0) {
+        gPending.key_on = time_us_32();
+        gPending.keyed  = true;
+    }
+}
+
+/**
+ * @brief 音色を設定したことを記録する
+ */
+inline void ToneLoad() {
+    gPending.loaded = true;
+}
+
+/**
+ * @brief メッセージの処理を終え、ヒストグラムに記録する
+ */
+extern void End();
+
+/**
+ * @brief ヒストグラムをコピーしてリセットする
+ * @param out コピー先
+ */
+extern void Take(Histograms& out);
+
+/**
+ * @brief ヒストグラムを参照する(Core0)
+ */
+extern const Histograms& Get();
+
+/**
+ * @brief ヒストグラムを表示する
+ * @param hist    ヒストグラム
+ * @param buckets true:バケットごとの回数も表示する
+ */
+extern void print(const Histograms& hist, bool buckets);
+};  // namespace Latency
+
+#define LATENCY_BEGIN(arrival) Latency::Begin(arrival)
+#define LATENCY_DISPATCH(msg)  Latency::Dispatch(msg)
+#define LATENCY_KEY_ON()       Latency::KeyOn()
+#define LATENCY_TONE_LOAD()    Latency::ToneLoad()
+#define LATENCY_END()          Latency::End()
+#else
+#define LATENCY_BEGIN(arrival)
+#define LATENCY_DISPATCH(msg)
+#define LATENCY_KEY_ON()
+#define LATENCY_TONE_LOAD()
+#define LATENCY_END()
+#endif
@@ -0,0 +1,206 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#include "Memory.h"
+
+#include <malloc.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "pico/stdlib.h"
+
+#if ENABLE_MEMORY_STATS == 1
+// リンカスクリプトで定義されるシンボル
+extern char __end__;           // ヒープの先頭(.bssの後ろ)
+extern char __StackLimit;      // ヒープの上限(sbrkはこれを超えない)
+extern char __StackBottom;     // Core0のスタックの下端
+extern char __StackTop;        // Core0のスタックの上端
+extern char __StackOneBottom;  // Core1のスタックの下端
+extern char __StackOneTop;     // Core1のスタックの上端
+
+MemoryTag Memory::gTag = MemoryTag::UNTAGGED;
+
+static constexpr uint32_t STACK_PATTERN = 0xdeadbeef;  // 未使用のスタックを埋める値
+static constexpr int STACK_MARGIN       = 64;          // 塗らずに残す現在のSPの下の領域(byte)
+
+/**
+ * @brief 確保したブロックの先頭に置くヘッダ
+ * @details mallocのアラインメント(8byte)を保つため8byteにする
+ */
+struct alignas(8) BlockHeader {
+    uint32_t size;  // 要求されたバイト数
+    MemoryTag tag;  // 確保したときのタグ
+};
+
+static HeapCounter counters[MEMORY_TAG_NUM];  // タグごとの集計
+static HeapCounter total;                     // 全タグの合計
+
+// 表示名
+static const char* const labels[] = {
+#define MEMORY_LABEL(name, label) label,
+    MEMORY_TAGS(MEMORY_LABEL)
+#undef MEMORY_LABEL
+};
+
+static void count_alloc(HeapCounter& c, uint32_t size) {
+    c.bytes += size;
+    ++c.allocs;
+    if (c.bytes > c.peak) {
+        c.peak = c.bytes;
+    }
+}
+
+static void count_free(HeapCounter& c, uint32_t size) {
+    c.bytes -= size;
+    ++c.frees;
+}
+
+static void* heap_alloc(size_t size) {
+    auto* h = (BlockHeader*)malloc(sizeof(BlockHeader) + size);
+    if (h == nullptr) {
+        return nullptr;
+    }
+    h->size = size;
+    h->tag  = (get_core_num() == 0) ? Memory::gTag : MemoryTag::CORE1;
+    count_alloc(counters[(int)h->tag], size);
+    count_alloc(total, size);
+    return h + 1;
+}
+
+static void heap_free(void* p) {
+    if (p == nullptr) {
+        return;
+    }
+    auto* h = (BlockHeader*)p - 1;
+    count_free(counters[(int)h->tag], h->size);
+    count_free(total, h->size);
+    free(h);
+}
+
+//
+// operator new/deleteの置き換え
+//
+void* operator new(size_t size) {
+    void* p = heap_alloc(size);
+    if (p == nullptr) {
+        panic("out of memory (%u bytes)", size);
+    }
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return heap_alloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return heap_alloc(size);
+}
+
+void operator delete(void* p) noexcept {
+    heap_free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    heap_free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    heap_free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    heap_free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    heap_free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    heap_free(p);
+}
+
+//
+// スタック
+//
+static void paint(uint32_t* bottom, uint32_t* top) {
+    for (uint32_t* p = bottom; p < top; p++) {
+        *p = STACK_PATTERN;
+    }
+}
+
+static uint32_t stack_used(const char* bottom, const char* top) {
+    // 下端から書き換えられていない領域を数える
+    const uint32_t* p = (const uint32_t*)bottom;
+    while (p < (const uint32_t*)top && *p == STACK_PATTERN) {
+        ++p;
+    }
+    return top - (const char*)p;
+}
+
+void __attribute__((noinline)) Memory::PaintStacks() {
+    // Core0: 呼び出し元のフレームを壊さないよう、現在のSPより下だけを塗る
+    char* sp = (char*)__builtin_frame_address(0) - STACK_MARGIN;
+    paint((uint32_t*)&__StackBottom, (uint32_t*)sp);
+    // Core1: 起動前なので全体を塗る
+    paint((uint32_t*)&__StackOneBottom, (uint32_t*)&__StackOneTop);
+}
+
+//
+// 集計
+//
+void Memory::Take(MemoryStats& out, bool reset) {
+    for (int i = 0; i < MEMORY_TAG_NUM; i++) {
+        out.tag[i] = counters[i];
+    }
+    out.total = total;
+
+    struct mallinfo mi = mallinfo();
+    out.heap_size      = &__StackLimit - &__end__;
+    out.arena          = mi.arena;
+    out.in_use         = mi.uordblks;
+    out.free           = mi.fordblks;
+    out.free_chunks    = mi.ordblks;
+    out.top            = out.heap_size - mi.arena + mi.keepcost;
+
+    out.stack_size[0] = &__StackTop - &__StackBottom;
+    out.stack_used[0] = stack_used(&__StackBottom, &__StackTop);
+    out.stack_size[1] = &__StackOneTop - &__StackOneBottom;
+    out.stack_used[1] = stack_used(&__StackOneBottom, &__StackOneTop);
+
+    if (reset) {
+        for (auto& c : counters) {
+            c.allocs = 0;
+            c.frees  = 0;
+            c.peak   = c.bytes;
+        }
+        total.allocs = 0;
+        total.frees  = 0;
+        total.peak   = total.bytes;
+    }
+}
+
+void Memory::print(const MemoryStats& s) {
+    printf("Heap: size=%u arena=%u in use=%u free=%u (chunks=%u, top=%u)\n", s.heap_size,
+           s.arena, s.in_use, s.free, s.free_chunks, s.top);
+    printf("%-10s %8s %8s %8s %8s\n", "new/delete", "bytes", "peak", "allocs", "frees");
+    for (int i = 0; i < MEMORY_TAG_NUM; i++) {
+        const HeapCounter& c = s.tag[i];
+        printf("%-10s %8u %8u %8u %8u\n", labels[i], c.bytes, c.peak, c.allocs, c.frees);
+    }
+    printf("%-10s %8u %8u %8u %8u\n", "total", s.total.bytes, s.total.peak, s.total.allocs,
+           s.total.frees);
+    for (int core = 0; core < 2; core++) {
+        printf("Stack core%d: used=%u/%u\n", core, s.stack_used[core], s.stack_size[core]);
+    }
+}
+#endif
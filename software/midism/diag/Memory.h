@@ -0,0 +1,112 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include <cstdint>
+
+#include "config.h"
+
+/**
+ * @brief ヒープの確保元のタグ
+ * @details X(識別子, 表示名)
+ *          UNTAGGED:タグなし(Core0), FACTORY:MidiFactory::Create()の中, CORE1:Core1での確保
+ */
+#define MEMORY_TAGS(X)      \
+    X(UNTAGGED, "untagged") \
+    X(FACTORY, "factory")   \
+    X(CORE1, "core1")
+
+/**
+ * @brief タグ
+ */
+enum class MemoryTag : uint8_t {
+#define MEMORY_ENUM(name, label) name,
+    MEMORY_TAGS(MEMORY_ENUM)
+#undef MEMORY_ENUM
+    NUM,
+};
+constexpr int MEMORY_TAG_NUM = (int)MemoryTag::NUM;
+
+/**
+ * @brief タグごとのヒープの使用量
+ */
+struct HeapCounter {
+    uint32_t bytes;   // 使用中のバイト数
+    uint32_t peak;    // 使用中のバイト数の最大値
+    uint32_t allocs;  // 確保した回数
+    uint32_t frees;   // 解放した回数
+};
+
+/**
+ * @brief メモリの使用状況
+ */
+struct MemoryStats {
+    HeapCounter tag[MEMORY_TAG_NUM];  // タグごとのnew/deleteの集計
+    HeapCounter total;                // 全タグの合計
+    uint32_t heap_size;               // ヒープ領域のサイズ(.bssの後ろからCore0のスタックまで)
+    uint32_t arena;                   // mallocがsbrkで確保した領域
+    uint32_t in_use;                  // arenaのうち使用中(mallocの管理領域とCの確保を含む)
+    uint32_t free;                    // arenaのうち空き
+    uint32_t free_chunks;             // arenaの空きブロック数(断片化の目安)
+    uint32_t top;                     // 連続して確保できる末尾の空き(arenaの末尾+未使用領域)
+    uint32_t stack_size[2];           // コアごとのスタックのサイズ
+    uint32_t stack_used[2];           // コアごとのスタックの最大使用量
+};
+
+#if ENABLE_MEMORY_STATS == 1
+/**
+ * @brief ヒープとスタックの使用量の計測
+ * @details
+ * - operator new/deleteを置き換え、確保したブロックの先頭にサイズとタグを置いて、
+ *   タグごとに使用中のバイト数・最大値・確保/解放の回数を集計する。
+ *   タグはHEAP_TAG()を置いたスコープで切り替わる(入れ子にできる)。
+ *   C++の動的確保はCore0だけで行う前提で、Core1で確保したものはCORE1として数える。
+ * - PaintStacks()で両コアのスタックをパターンで埋めておき、書き換えられていない
+ *   領域を数えて最大使用量を求める。
+ * - 集計の確保/解放の回数をリセットしてから演奏すると、定常状態でのヒープの使用が
+ *   確認できる(回数が増えなければホットパスでの確保はない)。
+ */
+namespace Memory {
+extern MemoryTag gTag;  // 現在のタグ(Core0)
+
+/**
+ * @brief 両コアのスタックをパターンで埋める
+ * @details Core1の起動前に、Core0のmain()の先頭で呼び出す
+ */
+extern void PaintStacks();
+
+/**
+ * @brief 使用状況を取得する(Core0)
+ * @param out   取得先
+ * @param reset true:取得した後に確保/解放の回数をリセットし、最大値を現在値に戻す
+ */
+extern void Take(MemoryStats& out, bool reset);
+
+/**
+ * @brief 使用状況を表示する
+ * @param stats 使用状況
+ */
+extern void print(const MemoryStats& stats);
+};  // namespace Memory
+
+/**
+ * @brief スコープの中のnewをタグ付けする
+ */
+class HeapTagScope {
+private:
+    MemoryTag prev;  // 元のタグ
+
+public:
+    explicit HeapTagScope(MemoryTag tag) : prev(Memory::gTag) { Memory::gTag = tag; }
+    ~HeapTagScope() { Memory::gTag = prev; }
+    HeapTagScope(const HeapTagScope&)            = delete;
+    HeapTagScope& operator=(const HeapTagScope&) = delete;
+};
+
+#define HEAP_TAG(tag) HeapTagScope heap_tag_(MemoryTag::tag)
+#else
+#define HEAP_TAG(tag)
+#endif
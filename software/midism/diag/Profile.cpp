@@ -0,0 +1,62 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#include "Profile.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "hardware/clocks.h"
+
+#if ENABLE_PROFILE == 1
+ProfileEntry Profile::gTable[PROFILE_POINT_NUM];
+
+// 計測点ごとの表示名
+static const char* const labels[] = {
+#define PROFILE_LABEL(name, label) label,
+    PROFILE_POINTS(PROFILE_LABEL)
+#undef PROFILE_LABEL
+};
+
+void Profile::Init() {
+    systick_hw->csr = 0;
+    systick_hw->rvr = 0x00ffffff;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 0x5;  // CPUクロック, 割り込みなし, 有効
+}
+
+void Profile::Take(ProfileEntry* out, bool reset) {
+    memcpy(out, gTable, sizeof(gTable));
+    if (reset) {
+        memset(gTable, 0, sizeof(gTable));
+    }
+}
+
+void Profile::print(const ProfileEntry* table) {
+    // 合計サイクル数の多い順に並べる
+    int order[PROFILE_POINT_NUM];
+    for (int i = 0; i < PROFILE_POINT_NUM; i++) {
+        int j = i;
+        while (j > 0 && table[order[j - 1]].total < table[i].total) {
+            order[j] = order[j - 1];
+            --j;
+        }
+        order[j] = i;
+    }
+
+    uint32_t mhz = clock_get_hz(clk_sys) / 1000000;
+    printf("Profile @%uMHz\n%-30s %10s %14s %6s %6s\n", mhz, "(cycles)", "count", "total(us)",
+           "avg", "max");
+    for (int i = 0; i < PROFILE_POINT_NUM; i++) {
+        const ProfileEntry& e = table[order[i]];
+        if (e.count == 0) {
+            continue;
+        }
+        printf("%-30s %10u %14llu %6u %6u\n", labels[order[i]], e.count,
+               (unsigned long long)(e.total / mhz), (uint32_t)(e.total / e.count), e.max);
+    }
+}
+#endif
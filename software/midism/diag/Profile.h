@@ -0,0 +1,104 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include <cstdint>
+
+#include "config.h"
+#include "hardware/structs/systick.h"
+
+/**
+ * @brief 計測する関数
+ * @details X(識別子, 表示名)
+ */
+#define PROFILE_POINTS(X)                              \
+    X(EXEC, "MidiProcessor::Exec")                     \
+    X(NOTE_ON, "NoteChannel::NoteOn")                  \
+    X(NOTE_OFF, "NoteChannel::NoteOff")                \
+    X(ALLOCATE_VOICE, "VoiceAllocator::AllocateVoice") \
+    X(SET_PROGRAM, "NoteVoice::SetProgram")            \
+    X(SET_PITCH, "NoteVoice::SetPitch")                \
+    X(CSM_UPDATE, "CsmVoice::update")
+
+/**
+ * @brief 計測点ID
+ */
+enum class ProfilePoint : uint8_t {
+#define PROFILE_ENUM(name, label) name,
+    PROFILE_POINTS(PROFILE_ENUM)
+#undef PROFILE_ENUM
+    NUM,
+};
+constexpr int PROFILE_POINT_NUM = (int)ProfilePoint::NUM;
+
+/**
+ * @brief 計測点ごとの集計
+ */
+struct ProfileEntry {
+    uint32_t count;  // 呼び出し回数
+    uint32_t max;    // 最大サイクル数
+    uint64_t total;  // 合計サイクル数
+};
+
+#if ENABLE_PROFILE == 1
+/**
+ * @brief 関数の実行サイクル数の計測(Core0)
+ * @details
+ * SysTick(24bitのダウンカウンタ, CPUクロック)で、PROFILE_SCOPE()を置いたスコープの
+ * 開始から終了までのサイクル数を計測し、計測点ごとに回数・合計・最大を集計する。
+ * - SysTickはコアごとにあるので、計測はProfile::Init()を呼んだCore0で行う。
+ * - 1回の計測は2^24サイクル(150MHzで約110ms)未満であること。
+ * - 計測点の中で別の計測点を呼び出した場合、その時間も含めて数える。
+ */
+namespace Profile {
+extern ProfileEntry gTable[PROFILE_POINT_NUM];  // Core0だけが更新する
+
+/**
+ * @brief 計測を開始する(呼び出したコアのSysTickを起動する)
+ */
+extern void Init();
+
+/**
+ * @brief 集計をコピーする
+ * @param out   コピー先(PROFILE_POINT_NUM個)
+ * @param reset true:コピーした後にリセットする
+ */
+extern void Take(ProfileEntry* out, bool reset);
+
+/**
+ * @brief 集計を合計サイクル数の多い順に表示する
+ * @param table 集計(PROFILE_POINT_NUM個)
+ */
+extern void print(const ProfileEntry* table);
+};  // namespace Profile
+
+/**
+ * @brief スコープの実行サイクル数を計測する
+ */
+class ProfileScope {
+private:
+    ProfilePoint point;  // 計測点
+    uint32_t start;      // 開始時のSysTickの値
+
+public:
+    explicit ProfileScope(ProfilePoint point) : point(point), start(systick_hw->cvr) {}
+    ~ProfileScope() {
+        uint32_t cycles = (start - systick_hw->cvr) & 0x00ffffff;  // ダウンカウンタ
+        ProfileEntry& e = Profile::gTable[(int)point];
+        ++e.count;
+        e.total += cycles;
+        if (cycles > e.max) {
+            e.max = cycles;
+        }
+    }
+    ProfileScope(const ProfileScope&)            = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+#define PROFILE_SCOPE(point) ProfileScope profile_scope_(ProfilePoint::point)
+#else
+#define PROFILE_SCOPE(point)
+#endif
@@ -0,0 +1,296 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#include "Telemetry.h"
+
+#include "CsmPhraseBank.h"
+#include "NoteVoice.h"
+#include "ToneBank.h"
+#include "Trace.h"
+#include "pico/stdlib.h"
+#include "tusb.h"
+
+#if ENABLE_TELEMETRY == 1
+Telemetry::Telemetry(Channels& channels, const MidiBatch* batches, int sources)
+    : channels(channels),
+      batches(batches),
+      sources(sources),
+      pending{},
+      rx_section(ALL),
+      sending(false),
+      tx_cable(0),
+      header{0xf0, RESPONSE_ID[0], RESPONSE_ID[1], RESPONSE_ID[2], 0, FORMAT_VERSION},
+      header_pos(0),
+      raw_len(0),
+      raw_pos(0),
+      group_left(0),
+      end_sent(false),
+      packet_ready(false) {
+}
+
+//
+// 要求の受信
+//
+void Telemetry::SysExBegin(int tag) {
+    if (!rx_owner.Acquire(tag)) {
+        return;  // 他の入力元が受信中
+    }
+    rx_section = ALL;  // セクションの指定がなければ全セクション
+}
+
+int Telemetry::SysExData(int tag, const uint8_t* data, int len) {
+    if (len > 0 && rx_owner.Owns(tag)) {
+        rx_section = data[0];
+    }
+    return len;
+}
+
+void Telemetry::SysExEnd(int tag, bool complete) {
+    if (!rx_owner.Release(tag)) {
+        return;
+    }
+    int cable = sysex_tag_value(tag);
+    if (!complete || cable >= MIDI_CABLES) {
+        return;
+    }
+    if (rx_section == ALL) {
+        pending[cable] |= (1 << SECTIONS) - 1;
+    } else if (rx_section < SECTIONS) {
+        pending[cable] |= 1 << rx_section;
+    }
+}
+
+//
+// 応答の送信
+//
+void Telemetry::Service() {
+    if (!tud_midi_n_mounted(0)) {
+        return;
+    }
+    for (int n = 0; n < MAX_PACKETS; n++) {
+        if (!packet_ready && !build_packet()) {
+            return;  // 送信するものがない
+        }
+        if (!tud_midi_n_packet_write(0, packet)) {
+            return;  // 送信バッファが満杯なので次回に送る
+        }
+        packet_ready = false;
+    }
+}
+
+bool Telemetry::start_next() {
+    for (int cable = 0; cable < MIDI_CABLES; cable++) {
+        if (pending[cable] == 0) {
+            continue;
+        }
+        int section = __builtin_ctz(pending[cable]);
+        pending[cable] &= ~(1 << section);
+        capture((Section)section);
+        tx_cable   = cable;
+        header[4]  = section;
+        header_pos = 0;
+        raw_pos    = 0;
+        group_left = 0;
+        end_sent   = false;
+        sending    = true;
+        return true;
+    }
+    return false;
+}
+
+bool Telemetry::build_packet() {
+    if (!sending && !start_next()) {
+        return false;
+    }
+    // SysExを3byteずつUSB MIDIイベントパケットにする
+    uint8_t data[3] = {0, 0, 0};
+    int num         = 0;
+    bool end        = false;
+    while (num < 3 && !end) {
+        int b = next_byte();
+        if (b < 0) {
+            break;
+        }
+        data[num++] = b;
+        end         = (b == 0xf7);
+    }
+    if (end || num == 0) {
+        sending = false;
+    }
+    if (num == 0) {
+        return false;
+    }
+    // CIN 0x4:SysEx開始/継続, 0x5-0x7:1-3byteでSysEx終了
+    packet[0]    = (tx_cable << 4) | (end ? 0x4 + num : 0x4);
+    packet[1]    = data[0];
+    packet[2]    = data[1];
+    packet[3]    = data[2];
+    packet_ready = true;
+    return true;
+}
+
+int Telemetry::next_byte() {
+    if (header_pos < (int)sizeof(header)) {
+        return header[header_pos++];
+    }
+    if (raw_pos < raw_len) {
+        if (group_left == 0) {
+            // 7byteのグループの先頭に、各byteのbit7を集めた1byteを置く
+            group_left  = (raw_len - raw_pos < 7) ? raw_len - raw_pos : 7;
+            uint8_t msb = 0;
+            for (int i = 0; i < group_left; i++) {
+                msb |= (raw[raw_pos + i] >> 7) << i;
+            }
+            return msb;
+        }
+        --group_left;
+        return raw[raw_pos++] & 0x7f;
+    }
+    if (!end_sent) {
+        end_sent = true;
+        return 0xf7;
+    }
+    return -1;
+}
+
+//
+// 統計情報の取得
+//
+void Telemetry::put(uint32_t value) {
+    if (raw_len + 4 > (int)sizeof(raw)) {
+        return;
+    }
+    for (int i = 0; i < 4; i++) {
+        raw[raw_len++] = value >> (8 * i);
+    }
+}
+
+void Telemetry::capture(Section section) {
+    raw_len = 0;
+    switch (section) {
+    case SUMMARY: {
+        const AllocStats& a = VoiceAllocator::GetInstance().GetStats();
+        put(time_us_64() / 1000);  // 起動からの時間(ms)
+        put(a.path[AllocStats::FAILED]);
+        put(a.path[AllocStats::STEAL]);
+        put(NoteVoice::GetToneLoadCount());
+        put(a.revoke);
+        put(a.revoke_cut);
+#if ENABLE_TRACE == 1
+        put(Trace::gRing[0].GetDrops());
+        put(Trace::gRing[1].GetDrops());
+#else
+        put(0);
+        put(0);
+#endif
+        put(sources);
+        for (int i = 0; i < sources; i++) {
+            put(batches[i].GetHighWater());
+        }
+        break;
+    }
+    case CHANNELS: {
+        static ChannelState s;  // スタックに置かない
+        put(MIDI_CABLES * MIDI_CHANNELS);
+        for (auto& cable : channels) {
+            for (auto* ch : cable) {
+                ch->snapshot(s);
+                put(s.rel_success_count);
+                put(s.rel_fail_count);
+                put(s.queue_max[ChannelState::ACTIVE]);  // -1:キューを持たない
+                put(s.queue_max[ChannelState::HOLD]);
+            }
+        }
+        break;
+    }
+    case BUS:
+        put(BUS_DOCKS);
+        put(BUS_CLASSES);
+        for (int d = 0; d < BUS_DOCKS; d++) {
+            for (int c = 0; c < BUS_CLASSES; c++) {
+                BusCounters bc = bus_counters(d, (BusClass)c);
+                put(bc.writes);
+                put(bc.reads);
+                put(bc.busy_us);
+            }
+        }
+        for (int core = 0; core < 2; core++) {
+            BusWaitStats ws = bus_wait_stats(core);
+            put(ws.count);
+            put(ws.contended);
+            put(ws.wait_us);
+            put(ws.max_wait);
+        }
+        break;
+    case LATENCY:
+#if ENABLE_LATENCY == 1
+        put(Latency::TYPES);
+        put(Latency::STAGES);
+        put(LatencyHistogram::BUCKETS);
+        for (auto& type : Latency::Get().h) {
+            for (auto& h : type) {
+                put(h.count);
+                put(h.max);
+                for (auto b : h.bucket) {
+                    put(b);
+                }
+            }
+        }
+#else
+        put(0);
+        put(0);
+        put(0);
+#endif
+        break;
+    case ALLOC: {
+        VoiceAllocator& allocator = VoiceAllocator::GetInstance();
+        const AllocStats& a       = allocator.GetStats();
+        put(AllocStats::PATHS);
+        for (auto n : a.path) {
+            put(n);
+        }
+        for (auto n : a.tone_load) {
+            put(n);
+        }
+        put(a.hint);
+        put(a.hint_hit);
+        put(time_us_64() / 1000 - a.start_ms);  // 集計期間(ms)
+        static uint32_t busy[MAX_VOICES];        // スタックに置かない
+        int n = allocator.GetBusyTimes(busy, MAX_VOICES);
+        put(n);
+        for (int i = 0; i < n; i++) {
+            put(busy[i]);
+        }
+        break;
+    }
+    case BANKS: {
+        ToneBankState tone;
+        ToneBank::GetInstance().snapshot(tone);
+        put(USER_TONE_BANKS);
+        put(tone.revision);
+        for (auto msb : tone.msb) {
+            put(msb);  // -1:未使用
+        }
+#if ENABLE_CSM != 0
+        PhraseBankState phrase;
+        CsmPhraseBank::GetInstance().snapshot(phrase);
+        put(USER_PHRASE_BANKS);
+        put(phrase.revision);
+        for (int i = 0; i < USER_PHRASE_BANKS; i++) {
+            put(phrase.lsb[i]);  // -1:未使用
+            put(phrase.phrases[i]);
+        }
+#else
+        put(0);
+        put(0);
+#endif
+        break;
+    }
+    default:
+        break;
+    }
+}
+#endif
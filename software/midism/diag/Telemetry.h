@@ -0,0 +1,118 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include "Latency.h"
+#include "MidiBatch.h"
+#include "MidiChannel.h"
+#include "RP2040.h"
+#include "SysExParser.h"
+#include "VoiceAllocator.h"
+#include "config.h"
+
+#if ENABLE_TELEMETRY == 1
+/**
+ * @brief SysExによる統計情報の送信
+ * @details
+ * UARTのコンソールを接続しない環境で、USB MIDI経由で統計情報を取得する。
+ * 要求(F0 7D 46 10 ss F7)を受け取ると、セクションssの統計情報をCore0で取得して、
+ * 応答(F0 7D 46 11 ss [データ] F7)をUSB MIDIのIN Endpointから送信する。
+ * - データはリトルエンディアンの32bit値の並びを、7byteごとに上位ビットを集めた1byteを
+ *   先頭に付けた8byteに変換したもの(7bitパッキング)。
+ * - 送信はメインループのService()で、USBの送信バッファの空きの分だけ少しずつ行うので、
+ *   Note処理を待たせない。送信中の要求はセクションごとに保留し、送信が終わってから応答する。
+ */
+class Telemetry : public SysExHandler {
+public:
+    /**
+     * @brief セクション
+     */
+    enum Section : uint8_t {
+        SUMMARY,   // Voiceの割り当て, MidiBatchの最大蓄積数など
+        CHANNELS,  // MIDIチャンネルごとのVoice解放の成否とキューの最大長
+        BUS,       // バスのアクセス回数と占有時間, 調停の待ち時間
+        LATENCY,   // レイテンシのヒストグラム
+        ALLOC,     // Voiceの割り当ての経路, moduleの一致率, Voiceごとのキーオン時間
+        BANKS,     // ユーザー音色/フレーズバンクの割り当て
+        SECTIONS,
+        ALL = 0x7f,  // 全セクション
+    };
+    static constexpr uint8_t FORMAT_VERSION = 1;  // データ形式の版(ヘッダのセクションの次に置く)
+
+    // $F0に続くID (非営利ID $7D, モデルID $46, コマンド)
+    static constexpr uint8_t REQUEST_ID[]  = {0x7d, 0x46, 0x10};
+    static constexpr uint8_t RESPONSE_ID[] = {0x7d, 0x46, 0x11};
+
+    using Channels = std::array<std::array<MidiChannel*, MIDI_CHANNELS>, MIDI_CABLES>;
+
+private:
+    static constexpr int MAX_PACKETS = 8;  // 1回のService()で送信する最大パケット数
+
+    // セクションごとのデータの語数(最大値)
+    static constexpr int SUMMARY_WORDS  = 9 + (MIDI_CABLES + 1);
+    static constexpr int CHANNELS_WORDS = 1 + MIDI_CABLES * MIDI_CHANNELS * 4;
+    static constexpr int BUS_WORDS      = 2 + BUS_DOCKS * BUS_CLASSES * 3 + 2 * 4;
+    static constexpr int LATENCY_WORDS =
+        3 + Latency::TYPES * Latency::STAGES * (2 + LatencyHistogram::BUCKETS);
+    static constexpr int ALLOC_WORDS = 1 + AllocStats::PATHS * 2 + 3 + 1 + MAX_VOICES;
+    static constexpr int BANKS_WORDS = 2 + USER_TONE_BANKS + 2 + USER_PHRASE_BANKS * 2;
+    static constexpr int MAX_WORDS   = std::max(
+        {SUMMARY_WORDS, CHANNELS_WORDS, BUS_WORDS, LATENCY_WORDS, ALLOC_WORDS, BANKS_WORDS});
+
+    Channels& channels;        // MIDIチャンネル
+    const MidiBatch* batches;  // 入力元ごとの受信メッセージ
+    int sources;               // 入力元の数
+
+    uint8_t pending[MIDI_CABLES];  // ケーブルごとの要求されたセクションのビットマップ
+    uint8_t rx_section;            // 受信中の要求のセクション
+    SysExOwner rx_owner;           // 受信中の入力元
+
+    // 送信中の応答
+    bool sending;                // 送信中
+    int tx_cable;                // 送信先のケーブル
+    uint8_t header[6];           // $F0, RESPONSE_ID, セクション, FORMAT_VERSION
+    int header_pos;              // 送信したヘッダのバイト数
+    uint8_t raw[MAX_WORDS * 4];  // パッキング前のデータ
+    int raw_len;                 // rawのバイト数
+    int raw_pos;                 // パッキング済みのrawのバイト数
+    int group_left;              // 7byteのグループの残りのバイト数
+    bool end_sent;               // $F7を送信した
+    uint8_t packet[4];           // 送信待ちのUSB MIDIパケット
+    bool packet_ready;           // packetが送信待ち
+
+public:
+    /**
+     * @brief コンストラクタ
+     * @param channels MIDIチャンネル
+     * @param batches  入力元ごとの受信メッセージ
+     * @param sources  入力元の数
+     */
+    Telemetry(Channels& channels, const MidiBatch* batches, int sources);
+    Telemetry() = delete;
+
+    /**
+     * @brief 応答を送信する
+     * @details メインループから頻繁に呼び出す(Core0)
+     */
+    void Service();
+
+    // SysExHandler (tagはsysex_tag(入力元, 応答を送信するケーブル番号))
+    void SysExBegin(int tag) override;
+    int SysExData(int tag, const uint8_t* data, int len) override;
+    void SysExEnd(int tag, bool complete) override;
+
+private:
+    bool start_next();
+    void capture(Section section);
+    void put(uint32_t value);
+    int next_byte();
+    bool build_packet();
+};
+#endif
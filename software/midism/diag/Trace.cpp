@@ -0,0 +1,41 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#include "Trace.h"
+
+#include <cstdio>
+
+#if ENABLE_TRACE == 1
+TraceRing Trace::gRing[2];
+volatile bool Trace::gRawMode = false;
+
+// イベントごとの書式
+static const char* const formats[] = {
+#define TRACE_FORMAT(name, level, format) format,
+    TRACE_EVENTS(TRACE_FORMAT)
+#undef TRACE_FORMAT
+};
+
+int Trace::Drain(int max) {
+    int n = 0;
+    TraceRecord r;
+    for (int core = 0; core < 2; core++) {
+        while (n < max && gRing[core].Read(r)) {
+            if (gRawMode) {
+                // tools/trace_decode.py用
+                printf("@T %d %u %u %d %d %d\n", core, r.time, r.event, r.arg[0], r.arg[1],
+                       r.arg[2]);
+            } else if (r.event < (uint16_t)TraceEvent::NUM) {
+                printf("%10u %d| ", r.time, core);
+                printf(formats[r.event], r.arg[0], r.arg[1], r.arg[2]);
+                putchar('\n');
+            }
+            ++n;
+        }
+    }
+    return n;
+}
+#endif
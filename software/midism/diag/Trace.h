@@ -0,0 +1,143 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+#include "Debugger.h"
+#include "TraceEvents.h"
+#include "config.h"
+#include "hardware/timer.h"
+#include "pico/platform.h"
+
+/**
+ * @brief トレースイベントID
+ */
+enum class TraceEvent : uint16_t {
+#define TRACE_ENUM(name, level, format) name,
+    TRACE_EVENTS(TRACE_ENUM)
+#undef TRACE_ENUM
+    NUM,
+};
+
+/**
+ * @brief トレースのレコード(12byte)
+ */
+struct TraceRecord {
+    uint32_t time;   // 時刻(us)
+    uint16_t event;  // TraceEvent
+    int16_t arg[3];  // 引数
+};
+
+#if ENABLE_TRACE == 1
+/**
+ * @brief トレースのリングバッファ
+ * @details
+ * 書き込み側と読み出し側がそれぞれ1つのロックフリーのリングバッファ。
+ * 書き込み側はレコードを書いてから書き込み数を更新し、読み出し側はレコードを読んでから
+ * 読み出し数を更新する。満杯の場合は新しいレコードを捨てて数える。
+ */
+class TraceRing {
+private:
+    TraceRecord records[TRACE_RING_SIZE];  // リングバッファ
+    std::atomic<uint32_t> head;            // 書き込んだレコード数(書き込み側が更新)
+    std::atomic<uint32_t> tail;            // 読み出したレコード数(読み出し側が更新)
+    uint32_t drops;                        // 満杯で捨てたレコード数(書き込み側が更新)
+
+    static_assert((TRACE_RING_SIZE & (TRACE_RING_SIZE - 1)) == 0,
+                  "TRACE_RING_SIZE must be a power of 2");
+
+public:
+    TraceRing() : head(0), tail(0), drops(0) {}
+
+    /**
+     * @brief レコードを書き込む
+     * @param event イベントID
+     * @param a0    引数0
+     * @param a1    引数1
+     * @param a2    引数2
+     */
+    void Write(TraceEvent event, int a0, int a1, int a2) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= TRACE_RING_SIZE) {
+            ++drops;
+            return;
+        }
+        TraceRecord& r = records[h & (TRACE_RING_SIZE - 1)];
+        r.time         = time_us_32();
+        r.event        = (uint16_t)event;
+        r.arg[0]       = a0;
+        r.arg[1]       = a1;
+        r.arg[2]       = a2;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief レコードを読み出す
+     * @param r 読み出し先
+     * @return true:読み出した, false:空
+     */
+    bool Read(TraceRecord& r) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        r = records[t & (TRACE_RING_SIZE - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 満杯で捨てたレコード数を返す
+     */
+    uint32_t GetDrops() const { return drops; }
+};
+
+/**
+ * @brief トレース
+ * @details
+ * MIDI処理の経過を、printfの代わりにコアごとのリングバッファにバイナリで記録する。
+ * 記録は数回のストアで済むので、デバッグレベルを上げてもMIDI処理のタイミングがほとんど変わらない。
+ * Core1がリングバッファを読み出して、テキスト(またはtools/trace_decode.py用の生データ)で表示する。
+ */
+namespace Trace {
+extern TraceRing gRing[2];      // コアごとのリングバッファ
+extern volatile bool gRawMode;  // true:生データで表示する
+
+// イベントごとのデバッグレベル
+constexpr uint8_t LEVEL[] = {
+#define TRACE_LEVEL(name, level, format) level,
+    TRACE_EVENTS(TRACE_LEVEL)
+#undef TRACE_LEVEL
+};
+
+/**
+ * @brief イベントを記録する
+ * @param event イベントID
+ * @param a0    引数0
+ * @param a1    引数1
+ * @param a2    引数2
+ * @details イベントのデバッグレベルがgDEBUG_LEVEL以下の場合に、呼び出したコアのリングバッファに記録する
+ */
+inline void Write(TraceEvent event, int a0 = 0, int a1 = 0, int a2 = 0) {
+    if (LEVEL[(int)event] <= Debugger::gDEBUG_LEVEL) {
+        gRing[get_core_num()].Write(event, a0, a1, a2);
+    }
+}
+
+/**
+ * @brief 記録したイベントを表示する(Core1)
+ * @param max 一度に表示する最大レコード数
+ * @return 表示したレコード数
+ */
+extern int Drain(int max);
+};  // namespace Trace
+
+#define TRACE(event, ...) Trace::Write(TraceEvent::event, ##__VA_ARGS__)
+#else
+#define TRACE(event, ...)
+#endif
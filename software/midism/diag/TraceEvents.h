@@ -0,0 +1,35 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+
+/**
+ * @brief トレースイベントの定義
+ * @details X(イベント名, デバッグレベル, 書式)
+ * - デバッグレベルがgDEBUG_LEVEL以下の場合に記録する。
+ * - 書式はprintf形式で、引数(int16_t)は最大3つ。
+ * - tools/trace_decode.pyもこの定義を読み込むので、1行に1イベントずつ書き、
+ *   既存のイベントの途中に追加した場合はデコーダと同じ版を使うこと。
+ */
+#define TRACE_EVENTS(X)                                                     \
+    X(MIDI_IN,    1, "IN    %02x %02x %02x")                                \
+    X(SYSEX,      1, "SysEx %02x %02x %02x")                                \
+    X(NOTE_ON,    1, "CH:%02d | ON : k=%3d v=%3d")                          \
+    X(NOTE_OFF,   1, "CH:%02d | OFF: k=%d v=%d")                            \
+    X(PROGRAM,    1, "CH:%02d | PROG: %d")                                  \
+    X(CONTROL,    3, "CH:%02d | CC: #%d/%d")                                \
+    X(POLY_PRESS, 3, "CH:%02d | PolyPress: key=%d velocity=%d")             \
+    X(CH_PRESS,   3, "CH:%02d | ChPress: %d")                               \
+    X(PITCH_BEND, 3, "CH:%02d | PB: %d")                                    \
+    X(SYSTEM,     3, "System| %02x %02x %02x")                              \
+    X(REALTIME,   4, "System| %02x")                                        \
+    X(VOICE_ON,   1, "CH=%02d %c%02d")                                      \
+    X(VOICE_OFF,  1, "CH=%02d %c%02d")                                      \
+    X(VOICE_FAIL, 1, "CH=%02d !!!!!!!!!! k=%d")                             \
+    X(VOICE_MISS, 1, "CH=%02d -?? k=%d")                                    \
+    X(RHYTHM,     1, "CH=%02d %c%02d")                                      \
+    X(TONE_LOAD,  2, "ID=%02d P%04x:%d")                                    \
+    X(PITCH,      1, "ID=%02d PB k=%d, diff=%d")
@@ -0,0 +1,58 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#include "MidiUart.h"
+
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/uart.h"
+
+static constexpr uint32_t MIDI_BAUDRATE = 31250;
+#define MIDI_UART uart1
+
+MidiUart::MidiUart() : dma_ch(-1), armed_count(0) {
+}
+
+MidiUart::~MidiUart() {
+    if (dma_ch >= 0) {
+        dma_channel_abort(dma_ch);
+        dma_channel_unclaim(dma_ch);
+    }
+}
+
+void MidiUart::Init() {
+    uart_init(MIDI_UART, MIDI_BAUDRATE);
+    uart_set_format(MIDI_UART, 8, 1, UART_PARITY_NONE);
+    uart_set_hw_flow(MIDI_UART, false, false);
+    uart_set_fifo_enabled(MIDI_UART, true);
+    gpio_set_function(MIDI_UART_RX, GPIO_FUNC_UART);
+
+    // UART RX -> リングバッファ
+    dma_ch                 = dma_claim_unused_channel(true);
+    dma_channel_config cfg = dma_channel_get_default_config(dma_ch);
+    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_8);
+    channel_config_set_read_increment(&cfg, false);
+    channel_config_set_write_increment(&cfg, true);
+    channel_config_set_ring(&cfg, true, RING_BITS);  // 書き込みアドレスを周回させる
+    channel_config_set_dreq(&cfg, uart_get_dreq(MIDI_UART, false));
+    dma_channel_configure(dma_ch, &cfg, ring, &uart_get_hw(MIDI_UART)->dr, TRANSFER_COUNT, true);
+    armed_count = 0;
+}
+
+uint32_t MidiUart::GetWriteCount() {
+    uint32_t remain = dma_channel_hw_addr(dma_ch)->transfer_count & TRANSFER_COUNT;
+    if (remain < TRANSFER_COUNT / 2) {
+        // 転送回数を使い切る前に再設定する
+        // 停止中に受信したデータはUARTのFIFOに残るので失われない
+        // (書き込みアドレスはそのまま引き継がれる)
+        dma_channel_abort(dma_ch);
+        remain = dma_channel_hw_addr(dma_ch)->transfer_count & TRANSFER_COUNT;
+        armed_count += TRANSFER_COUNT - remain;
+        dma_channel_set_trans_count(dma_ch, TRANSFER_COUNT, true);
+        remain = TRANSFER_COUNT;
+    }
+    return armed_count + (TRANSFER_COUNT - remain);
+}
@@ -0,0 +1,61 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include <cstdint>
+
+//
+//   DIN MIDI IN
+//   UART1 RX (GPIO5), 31250bps
+//
+#define MIDI_UART_RX 5
+
+/**
+ * @brief DIN MIDI入力(UART)
+ * @details
+ * UARTの受信データをDMAでリングバッファに転送する。
+ * CPUは割り込みを使わないので、RP2040::write()などで割り込み禁止の区間が
+ * 長く続いても、バッファが一周するまでは受信データを取りこぼさない。
+ * 受信データの読み出しはDmaRingReaderで行う。
+ */
+class MidiUart {
+public:
+    static constexpr int RING_BITS = 8;  // リングバッファサイズ(2^n)
+    static constexpr int RING_SIZE = 1 << RING_BITS;
+
+private:
+    // DMAのリングモードはバッファサイズでアラインされている必要がある
+    alignas(RING_SIZE) volatile uint8_t ring[RING_SIZE];
+    int dma_ch;            // DMAチャンネル
+    uint32_t armed_count;  // DMAを設定した時点での受信バイト数
+
+    // DMAの転送回数(RP2350のTRANS_COUNTは28bit)
+    static constexpr uint32_t TRANSFER_COUNT = 0x0fffffff;
+
+public:
+    MidiUart();
+    ~MidiUart();
+
+    MidiUart(const MidiUart&)            = delete;
+    MidiUart& operator=(const MidiUart&) = delete;
+
+    /**
+     * @brief UARTとDMAの初期化
+     */
+    void Init();
+
+    /**
+     * @brief リングバッファを返す
+     */
+    const volatile uint8_t* GetBuffer() const { return ring; }
+
+    /**
+     * @brief 受信したバイト数を返す
+     * @return 起動時からの受信バイト数(単調増加)
+     * @details DMAの転送回数の残りが半分を切ったら、転送を再設定する
+     */
+    uint32_t GetWriteCount();
+};
@@ -6,6 +6,8 @@
 //
 #include "OpnBase.h"
 
+#include "Latency.h"
+
 OpnBase::OpnBase(HAL& hal, float clock, int id)
     : hal(hal),
       ext_clock(clock),
@@ -103,6 +105,7 @@ void OpnBase::fm_set_pitch(uint8_t ch, uint8_t p, uint8_t oct, int16_t diff) {
 void OpnBase::fm_turnon_key(uint8_t ch, uint8_t op) {
     if (ch >= 3) ch = ++ch & 0x07;
     hal.write(0x28, ch | (op << 4), 0, WAIT_83);
+    LATENCY_KEY_ON();
 }
 
 void OpnBase::fm_turnoff_key(uint8_t ch) {
@@ -163,7 +166,11 @@ void OpnBase::fm_set_volume(uint8_t ch, uint8_t no, uint8_t vl) {
     if (no > sizeof(fm_tone_table) / sizeof(fm_tone_table[0])) {
         return;
     }
-    int alg = fm_tone_table[no][28] & 0x07;
+    fm_set_volume(ch, &fm_tone_table[no][0], vl);
+}
+
+void OpnBase::fm_set_volume(uint8_t ch, const uint8_t* tone, uint8_t vl) {
+    int alg = tone[FM_TONE_SIZE - 1] & 0x07;
     switch (alg) {
     case 4:  // Carrier: 2,4
         fm_set_total_level(ch, 1, vl);
@@ -297,6 +304,13 @@ void OpnBase::fm_set_fnumber_ch3(uint8_t op, uint8_t fnum2, uint8_t fnum1) {
     hal.write(adr1, fnum1, 0, WAIT_47);
 }
 
+void OpnBase::write_registers(const uint8_t* adrs, const uint8_t* data, int n) {
+    for (int i = 0; i < n; i++) {
+        uint8_t wait = (adrs[i] >= 0xa0 && adrs[i] <= 0xae) ? WAIT_47 : WAIT_83;
+        hal.write(adrs[i], data[i], 0, wait);
+    }
+}
+
 /////////////////////////////////////////////////////////
 // SSG
 /////////////////////////////////////////////////////////
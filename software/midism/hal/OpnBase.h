@@ -132,6 +132,14 @@ public:
      */
     void fm_set_volume(uint8_t ch, uint8_t no, uint8_t tl);
 
+    /**
+     * @brief Set channel volume by binary tone data
+     * @param [in] ch   : Channel number (0- )
+     * @param [in] tone : Tone data (29bytes array) to refer the algorithm
+     * @param [in] vl   : volume (0-127) (equal to Total Level)
+     */
+    void fm_set_volume(uint8_t ch, const uint8_t* tone, uint8_t tl);
+
     /**
      * @brief Set Envelope of Channel's Operator
      * @param [in] ch : Channel number (0- )
@@ -173,6 +181,15 @@ public:
      */
     void fm_set_fnumber_ch3(uint8_t op, uint8_t fnum2, uint8_t fnum1);
 
+    /**
+     * @brief Write registers in sequence
+     * @param [in] adrs : Register addresses (A1=0)
+     * @param [in] data : Data for each address
+     * @param [in] n    : Number of registers
+     * @details Wait cycles are the same as each setter ($A0-$AE: WAIT_47, others: WAIT_83)
+     */
+    void write_registers(const uint8_t* adrs, const uint8_t* data, int n);
+
     /////////////////////////////////////////////////////////
     // SSG
     /////////////////////////////////////////////////////////
@@ -366,4 +383,5 @@ public:
 /* FM tone parameter table */
 #include "tone/tone_table.inc"
     static constexpr int MAXNUM_FM_TONE = sizeof(fm_tone_table) / sizeof(fm_tone_table[0]);
+    static constexpr int FM_TONE_SIZE   = sizeof(fm_tone_table[0]);
 };
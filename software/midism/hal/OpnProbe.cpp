@@ -0,0 +1,66 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#include "OpnProbe.h"
+
+// SSGのレジスタ書き込み後の待ち時間(us)
+// クロックが分からないので、遅い方(YM2203@4MHz)の83サイクルに合わせる
+static constexpr uint8_t PROBE_WAIT = 83 * 1000 / 4000 + 1;
+
+static constexpr uint8_t SSG_FINE_A   = 0x00;  // SSG チャンネルAの周波数(下位8bit)
+static constexpr uint8_t SSG_COARSE_A = 0x01;  // SSG チャンネルAの周波数(上位4bit)
+static constexpr uint8_t OPNA_ID_REG  = 0xff;  // YM2608のID
+static constexpr uint8_t OPNA_ID      = 0x01;
+
+/**
+ * @brief SSGのレジスタに書き込んだ値を読み出せるか調べる
+ */
+static bool ssg_readback(HAL& hal, uint8_t adrs, uint8_t data) {
+    hal.write(adrs, data, 0, PROBE_WAIT);
+    return hal.read(adrs, 0) == data;
+}
+
+OpnType opn_probe(HAL& hal) {
+    // 接続の確認
+    bool found = ssg_readback(hal, SSG_FINE_A, 0x55) && ssg_readback(hal, SSG_FINE_A, 0xaa);
+    hal.write(SSG_FINE_A, 0x00, 0, PROBE_WAIT);
+    if (!found) {
+        return OPN_NONE;
+    }
+
+    // IDの確認
+    bool id = (hal.read(OPNA_ID_REG, 0) == OPNA_ID);
+
+    // A1の確認(YM2608では$101はADPCMのコントロール2で、0はリセット後の値)
+    hal.write(SSG_COARSE_A, 0x0a, 0, PROBE_WAIT);
+    hal.write(SSG_COARSE_A, 0x00, 1, PROBE_WAIT);
+    bool a1 = (hal.read(SSG_COARSE_A, 0) & 0x0f) == 0x0a;
+    hal.write(SSG_COARSE_A, 0x00, 0, PROBE_WAIT);
+
+    return (id && a1) ? OPN_YM2608 : OPN_YM2203;
+}
+
+uint32_t opn_scan(HAL* const hals[], OpnType types[], int docks) {
+    uint32_t found = 0;
+    for (int d = 0; d < docks; d++) {
+        types[d] = hals[d] ? opn_probe(*hals[d]) : OPN_NONE;
+        if (types[d] != OPN_NONE) {
+            found |= 1u << d;
+        }
+    }
+    return found;
+}
+
+const char* opn_type_name(OpnType type) {
+    switch (type) {
+    case OPN_YM2203:
+        return "YM2203";
+    case OPN_YM2608:
+        return "YM2608";
+    default:
+        return "none";
+    }
+}
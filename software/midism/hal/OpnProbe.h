@@ -0,0 +1,49 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include <cstdint>
+
+#include "HAL.h"
+
+/**
+ * @brief Dockに接続されたFM音源LSIの種類
+ */
+enum OpnType : uint8_t {
+    OPN_NONE,    // 未接続
+    OPN_YM2203,  // OPN
+    OPN_YM2608,  // OPNA
+};
+
+/**
+ * @brief Dockに接続されたFM音源LSIを調べる
+ * @param hal Dockのバス
+ * @return FM音源LSIの種類
+ * @details
+ * - SSGのレジスタ$00(チャンネルAの周波数の下位8bit)に2つのパターンを書き込み、読み出した値が
+ *   一致すれば接続されているとみなす。未接続のDockではデータバスが浮いているので一致しない。
+ * - YM2608はレジスタ$FFの読み出しでID(0x01)を返す。またA1=1のレジスタは別の空間になる。
+ *   YM2203はA1を持たないので、A1=1で書き込むとA1=0のSSGのレジスタが書き換わる。
+ *   両方がYM2608の振る舞いの場合にYM2608とする。
+ * - 書き換えたSSGのレジスタは0に戻す。リセット(/IC)の後、init()の前に呼び出すこと。
+ */
+extern OpnType opn_probe(HAL& hal);
+
+/**
+ * @brief 全Dockを調べる
+ * @param hals  Dockごとのバス(nullptrのDockは調べない)
+ * @param types Dockごとの種類の格納先
+ * @param docks Dock数
+ * @return FM音源LSIが接続されているDockのビットマップ
+ */
+extern uint32_t opn_scan(HAL* const hals[], OpnType types[], int docks);
+
+/**
+ * @brief 種類の表示名を返す
+ * @param type FM音源LSIの種類
+ * @return 表示名
+ */
+extern const char* opn_type_name(OpnType type);
@@ -6,9 +6,13 @@
 //
 #include "RP2040.h"
 
+#include <cstring>
+
+#include "hardware/flash.h"
 #include "hardware/gpio.h"
 #include "hardware/irq.h"
 #include "hardware/sync.h"
+#include "pico/flash.h"
 #include "pico/stdlib.h"
 
 /**
@@ -44,22 +48,32 @@ static void reset_fmchip() {
 
 /**
  * @brief GPIO割り込みハンドラ
+ * @details /IRQ(FM_IRQ0-FM_IRQ3)ごとにコールバックを呼び分ける
  */
-static std::function<void()> cb_func;
+static struct {
+    isr_callback_t func;  // コールバック関数
+    void* ctx;            // コールバック関数に渡すコンテキスト
+} isr_table[FM_IRQ3 - FM_IRQ0 + 1];
 static void isr(uint gpio, uint32_t events) {
     // コールバック
-    cb_func();
+    uint n = gpio - FM_IRQ0;
+    if (n < sizeof(isr_table) / sizeof(isr_table[0]) && isr_table[n].func) {
+        isr_table[n].func(isr_table[n].ctx);
+    }
     // 割り込みイベントのクリア
     gpio_acknowledge_irq(gpio, GPIO_IRQ_EDGE_FALL);
 }
 
 /**
  * @brief 割り込み時のコールバックの登録
- * @param gpio  GPIO pin
+ * @param gpio  GPIO pin (FM_IRQ0-FM_IRQ3)
  * @param func  callback function
+ * @param ctx   callback functionに渡すコンテキスト
  */
-void attach_isr_callback(int gpio, std::function<void()> func) {
-    cb_func = func;                                         // isr()内で呼び出すコールバック登録
+void attach_isr_callback(int gpio, isr_callback_t func, void* ctx) {
+    disable_isr_callback(gpio);                             // 登録中に割り込まれないようにする
+    isr_table[gpio - FM_IRQ0].func = func;                  // isr()内で呼び出すコールバック
+    isr_table[gpio - FM_IRQ0].ctx  = ctx;                   // コールバックに渡すコンテキスト
     gpio_set_irq_enabled_with_callback(gpio,                // モニタするGPIO
                                        GPIO_IRQ_EDGE_FALL,  // 立ち下がりエッジ
                                        true,                // 割り込みは無効のまま
@@ -83,10 +97,160 @@ void disable_isr_callback(int gpio) {
     gpio_set_irq_enabled(gpio, GPIO_IRQ_EDGE_FALL, false);
 }
 
+/**
+ * @brief バスの調停
+ * @details ロックを取得できるまでの待ち時間をコアごとに計測する
+ */
+static spin_lock_t* bus_lock;       // バスのハードウェアスピンロック
+static BusWaitStats bus_stats[2];  // コアごとの統計(各コアが自分の分だけ更新する)
+
+static uint32_t bus_acquire() {
+    uint32_t save   = save_and_disable_interrupts();
+    BusWaitStats& s = bus_stats[get_core_num()];
+    if (!spin_try_lock_unsafe(bus_lock)) {
+        // もう一方のコアがバスを使用中
+        uint32_t start = time_us_32();
+        spin_lock_unsafe_blocking(bus_lock);
+        uint32_t wait = time_us_32() - start;
+        ++s.contended;
+        s.wait_us += wait;
+        if (wait > s.max_wait) {
+            s.max_wait = wait;
+        }
+    }
+    ++s.count;
+    return save;
+}
+
+static void bus_release(uint32_t save) {
+    spin_unlock(bus_lock, save);
+}
+
+BusWaitStats bus_wait_stats(int core) {
+    return bus_stats[core & 1];
+}
+
+#if ENABLE_BUS_STATS == 1
+static BusCounters bus_count[BUS_DOCKS][BUS_CLASSES];  // バスのロック取得中に更新する
+
+/**
+ * @brief レジスタ分類を求める
+ * @param adrs レジスタアドレス
+ * @param a1   1:YM2608の拡張レジスタ
+ */
+static BusClass bus_class(uint8_t adrs, uint8_t a1) {
+    if (adrs >= 0x30) {
+        return (adrs < 0xa0) ? BUS_FM_OP : (adrs < 0xb8) ? BUS_FM_CH : BUS_OTHER;
+    }
+    if (a1) {
+        return BUS_OTHER;  // ADPCM
+    }
+    if (adrs < 0x0e) {
+        return BUS_SSG;
+    }
+    if (adrs < 0x10) {
+        return BUS_PORT;
+    }
+    if (adrs < 0x1e) {
+        return BUS_RHYTHM;
+    }
+    if (adrs == 0x28) {
+        return BUS_KEY_ON;
+    }
+    if (adrs >= 0x24 && adrs <= 0x27) {
+        return BUS_TIMER;
+    }
+    return BUS_OTHER;
+}
+
+/**
+ * @brief バスアクセスを数える(バスのロック取得中に呼び出す)
+ */
+static void bus_account(int dock, BusClass cls, bool read, uint32_t start) {
+    if (dock >= BUS_DOCKS) {
+        return;
+    }
+    BusCounters& c = bus_count[dock][cls];
+    if (read) {
+        ++c.reads;
+    } else {
+        ++c.writes;
+    }
+    c.busy_us += time_us_32() - start;
+}
+
+BusCounters bus_counters(int dock, BusClass cls) {
+    return bus_count[dock % BUS_DOCKS][cls];
+}
+#else
+BusCounters bus_counters(int dock, BusClass cls) {
+    return BusCounters{0, 0, 0};
+}
+#endif
+
+/**
+ * @brief 不揮発データ領域の先頭オフセット(Flash先頭から)
+ */
+static constexpr uint32_t FLASH_STORAGE_OFFSET =
+    PICO_FLASH_SIZE_BYTES - FLASH_STORAGE_SIZE * FLASH_AREA_NUM;
+
+/**
+ * @brief 不揮発データ領域の読み出し用アドレスを返す
+ * @param area 用途
+ * @return XIP経由で参照できるアドレス
+ */
+const uint8_t* flash_storage_ptr(FlashArea area) {
+    return (const uint8_t*)(XIP_BASE + FLASH_STORAGE_OFFSET + FLASH_STORAGE_SIZE * area);
+}
+
+struct flash_storage_param {
+    uint32_t offset;
+    const uint8_t* data;
+    uint32_t len;
+};
+
+// Flashの消去・書き込み中はXIPが使えないのでRAMに配置する
+static void __not_in_flash_func(flash_storage_program)(void* p) {
+    const flash_storage_param* param = (const flash_storage_param*)p;
+
+    uint32_t erase = (param->len + FLASH_SECTOR_SIZE - 1) & ~(FLASH_SECTOR_SIZE - 1);
+    flash_range_erase(param->offset, erase);
+
+    // ページ単位で書き込み、端数は0xffで埋める
+    uint32_t whole = param->len & ~(FLASH_PAGE_SIZE - 1);
+    if (whole) {
+        flash_range_program(param->offset, param->data, whole);
+    }
+    if (whole < param->len) {
+        uint8_t page[FLASH_PAGE_SIZE];
+        memset(page, 0xff, sizeof(page));
+        memcpy(page, param->data + whole, param->len - whole);
+        flash_range_program(param->offset + whole, page, FLASH_PAGE_SIZE);
+    }
+}
+
+/**
+ * @brief 不揮発データ領域に書き込む
+ * @param area 用途
+ * @param data 書き込むデータ(RAM上にあること)
+ * @param len  書き込むバイト数 (<= FLASH_STORAGE_SIZE)
+ * @return true:成功
+ * @details 消去と書き込みの間はもう一方のコアも停止させるので、数十msの間処理が止まる。
+ *          もう一方のコアではflash_safe_execute_core_init()を呼んでおくこと。
+ */
+bool flash_storage_write(FlashArea area, const void* data, uint32_t len) {
+    if (len > FLASH_STORAGE_SIZE || area >= FLASH_AREA_NUM) {
+        return false;
+    }
+    flash_storage_param param = {FLASH_STORAGE_OFFSET + FLASH_STORAGE_SIZE * area,
+                                 (const uint8_t*)data, len};
+    return flash_safe_execute(flash_storage_program, &param, 1000) == PICO_OK;
+}
+
 //
 // RP2040
 //
-RP2040::RP2040(int dock) : cs((uint32_t)(dock & 7) << FM_CS0) {
+RP2040::RP2040(int dock) : cs((uint32_t)(dock & 7) << FM_CS0), dock(dock & 7) {
 }
 
 RP2040::~RP2040() {
@@ -94,10 +258,13 @@ RP2040::~RP2040() {
 
 void RP2040::init() {
     stdio_init_all();  // デバッグ用シリアル出力の初期化
+    bus_lock = spin_lock_init(spin_lock_claim_unused(true));
     init_gpio();
     reset_fmchip();
 }
 
+// /CS2-0はDock番号のコードで、アクセスしていない間は7にする(デコーダではDock7が選択される)。
+// /WR,/RDは/CSを確定してから下げ、/CSを戻す前に上げるので、Dock7にも余分なストローブは出ない
 __inline void RP2040::enable_cs() {
     gpio_put_masked((uint32_t)7 << FM_CS0, cs);
 }
@@ -109,14 +276,17 @@ __inline void RP2040::disable_cs() {
 uint8_t RP2040::read(uint8_t adrs, uint8_t a1) {
     //wait_until_ready();
 
-    // Disable interrupt to avoid I/O overlapping
-    interrupts = save_and_disable_interrupts();
+    // Lock the bus and disable interrupt to avoid I/O overlapping
+    uint32_t interrupts = bus_acquire();
+#if ENABLE_BUS_STATS == 1
+    uint32_t start = time_us_32();
+#endif
 
     // Set address to READ
     gpio_put(FM_A1, a1);  // 1: Status1,ADPCM
     gpio_put(FM_A0, 0);   // for address write
-    gpio_put(FM_WR, 0);
     enable_cs();
+    gpio_put(FM_WR, 0);
     gpio_put_masked(0x0000ff00, (uint32_t)adrs << 8);
     sleep_us(2);  // Hold time for /CS, /WR > 200ns
                   // Note: sleep_us(1) is insufficient
@@ -127,8 +297,8 @@ uint8_t RP2040::read(uint8_t adrs, uint8_t a1) {
     // Read register
     gpio_set_dir_in_masked(0x0000ff00);  // Set D7-0 IN;
     gpio_put(FM_A0, 1);                  // for register read
-    gpio_put(FM_RD, 0);
     enable_cs();
+    gpio_put(FM_RD, 0);
     sleep_us(2);  // Hold time for /CS, /RD > 250ns
                   // Note: sleep_us(1) is insufficient
     uint8_t data = gpio_get_all() >> 8 & 0xff;
@@ -136,21 +306,27 @@ uint8_t RP2040::read(uint8_t adrs, uint8_t a1) {
     disable_cs();
     gpio_set_dir_out_masked(0x0000ff00);  // Set D7-0 OUT
 
-    restore_interrupts(interrupts);
+#if ENABLE_BUS_STATS == 1
+    bus_account(dock, bus_class(adrs, a1), true, start);
+#endif
+    bus_release(interrupts);
     return data;
 }
 
 void RP2040::write(uint8_t adrs, uint8_t data, uint8_t a1, uint8_t wait) {
     //wait_until_ready();
 
-    // Disable interrupt to avoid I/O overlapping
-    interrupts = save_and_disable_interrupts();
+    // Lock the bus and disable interrupt to avoid I/O overlapping
+    uint32_t interrupts = bus_acquire();
+#if ENABLE_BUS_STATS == 1
+    uint32_t start = time_us_32();
+#endif
 
     // Set address to WRITE
     gpio_put(FM_A1, a1);  // 0:ch1-3 / 1: ch4-6
     gpio_put(FM_A0, 0);   // for address write
-    gpio_put(FM_WR, 0);
     enable_cs();
+    gpio_put(FM_WR, 0);
     gpio_put_masked(0x0000ff00, (uint32_t)adrs << 8);
     sleep_us(2);  // Hold time for /CS, /WR > 200ns
                   // Note: sleep_us(1) is insufficient
@@ -160,8 +336,8 @@ void RP2040::write(uint8_t adrs, uint8_t data, uint8_t a1, uint8_t wait) {
 
     // Set data
     gpio_put(FM_A0, 1);  // for register write
-    gpio_put(FM_WR, 0);
     enable_cs();
+    gpio_put(FM_WR, 0);
     gpio_put_masked(0x0000ff00, (uint32_t)data << 8);
     sleep_us(2);  // Hold time for /CS, /WR > 200ns
                   // Note: sleep_us(1) is insufficient
@@ -170,21 +346,24 @@ void RP2040::write(uint8_t adrs, uint8_t data, uint8_t a1, uint8_t wait) {
 
     sleep_us(wait);
 
-    restore_interrupts(interrupts);
+#if ENABLE_BUS_STATS == 1
+    bus_account(dock, bus_class(adrs, a1), false, start);
+#endif
+    bus_release(interrupts);
 }
 
 #if 0
 void RP2040::wait_until_ready()
 {
-    // Disable interrupt to avoid I/O overlapping
-    interrupts = save_and_disable_interrupts();
+    // Lock the bus and disable interrupt to avoid I/O overlapping
+    uint32_t interrupts = bus_acquire();
 
     bool isBusy;
     gpio_put(FM_A0, 0);
     gpio_set_dir_in_masked(0x0000ff00); // Set D7-0 IN
     do {
-        gpio_put(FM_RD, 0);
         enable_cs();
+        gpio_put(FM_RD, 0);
         sleep_us(2);          // Hold time for /CS, /RD > 250ns
                             // Note: sleep_us(1) is insufficient
         isBusy = gpio_get(15);
@@ -193,19 +372,22 @@ void RP2040::wait_until_ready()
     } while (isBusy);
     gpio_set_dir_out_masked(0x0000ff00); // Set D7-0 OUT
 
-    restore_interrupts(interrupts);
+    bus_release(interrupts);
 }
 #endif
 
 uint8_t RP2040::read_status(uint8_t a1) {
-    // Disable interrupt to avoid I/O overlapping
-    interrupts = save_and_disable_interrupts();
+    // Lock the bus and disable interrupt to avoid I/O overlapping
+    uint32_t interrupts = bus_acquire();
+#if ENABLE_BUS_STATS == 1
+    uint32_t start = time_us_32();
+#endif
 
     gpio_put(FM_A1, a1);
     gpio_put(FM_A0, 0);
     gpio_set_dir_in_masked(0x0000ff00);  // Set D7-0 IN
-    gpio_put(FM_RD, 0);
     enable_cs();
+    gpio_put(FM_RD, 0);
     sleep_us(2);  // Hold time for /CS, /RD > 250ns
                   // Note: sleep_us(1) is insufficient
     uint8_t data = (gpio_get_all() >> 8) & 0xff;
@@ -213,6 +395,9 @@ uint8_t RP2040::read_status(uint8_t a1) {
     disable_cs();
     gpio_set_dir_out_masked(0x0000ff00);  // Set D7-0 OUT
 
-    restore_interrupts(interrupts);
+#if ENABLE_BUS_STATS == 1
+    bus_account(dock, BUS_STATUS, true, start);
+#endif
+    bus_release(interrupts);
     return data;
 }
@@ -5,9 +5,10 @@
 // See LICENSE file for details.
 //
 #pragma once
-#include <functional>
+#include <cstdint>
 
 #include "HAL.h"
+#include "config.h"
 
 //
 //   GPIO signal Assignment
@@ -44,13 +45,15 @@
 #define FM_CS1  27
 #define FM_CS2  28
 
+constexpr int FM_IRQ_DOCKS = FM_IRQ3 - FM_IRQ0 + 1;  // /IRQを接続しているDock数(Dock0から)
+
 /**
  * @brief RP2040 adapter class
  */
 class RP2040 : public HAL {
 private:
     uint32_t cs;
-    uint32_t interrupts;
+    int dock;  // Dock番号(バスの統計用)
 
 public:
     /**
@@ -69,10 +72,12 @@ public:
 
     /**
      * @brief RP2040含めたハードウェアの初期化
-     * @details 静的メンバ関数なので、RP2040::init()で呼び出す
+     * @details 静的メンバ関数なので、RP2040::init()で呼び出す。
+     *          バスの調停に使うハードウェアスピンロックもここで確保する
      */
     static void init();
 
+    // バスへのアクセスは2つのコアの間で排他する(スピンロック取得中は自コアの割り込みも禁止)
     uint8_t read(uint8_t adrs, uint8_t a1) override;
     void write(uint8_t adrs, uint8_t data, uint8_t a1, uint8_t wait) override;
     uint8_t read_status(uint8_t a1) override;
@@ -83,9 +88,68 @@ private:
     //void wait_until_ready();
 };
 
+/**
+ * @brief 不揮発データ領域
+ * @details Flash末尾のFLASH_STORAGE_SIZE * FLASH_AREA_NUM分をプログラム領域と重ならない
+ *          予約領域とし、用途ごとにFLASH_STORAGE_SIZEずつ割り当てる
+ */
+constexpr uint32_t FLASH_STORAGE_SIZE = 16 * 1024;  // 1領域の予約サイズ(4KBセクタの倍数)
+enum FlashArea {
+    FLASH_AREA_TONE_BANK,    // ユーザー音色
+    FLASH_AREA_PHRASE_BANK,  // CSMフレーズバンク
+    FLASH_AREA_NUM,
+};
+extern const uint8_t* flash_storage_ptr(FlashArea area);
+extern bool flash_storage_write(FlashArea area, const void* data, uint32_t len);
+
 /**
  * @brief 割り込み処理
+ * @details /IRQ(FM_IRQ0-FM_IRQ3)ごとに、関数とコンテキストの組を1つずつ登録する。
+ *          割り込みハンドラ内で呼び出すので、処理は最小限にすること
  */
-extern void attach_isr_callback(int module, std::function<void()> func);
+typedef void (*isr_callback_t)(void* ctx);
+extern void attach_isr_callback(int gpio, isr_callback_t func, void* ctx);
 extern void enable_isr_callback(int gpio);
 extern void disable_isr_callback(int gpio);
+
+/**
+ * @brief バスの調停の統計
+ * @details FM音源モジュールのバスは2つのコアで共有し、ハードウェアスピンロックで排他する。
+ *          コアごとに、アクセス回数ともう一方のコアの使用中に待った時間を数える
+ */
+struct BusWaitStats {
+    uint32_t count;      // バスアクセス回数
+    uint32_t contended;  // もう一方のコアの使用中で待った回数
+    uint32_t wait_us;    // 待ち時間の合計(us)
+    uint32_t max_wait;   // 最大の待ち時間(us)
+};
+extern BusWaitStats bus_wait_stats(int core);
+
+/**
+ * @brief バスアクセスのレジスタ分類
+ */
+enum BusClass {
+    BUS_FM_OP,   // FMオペレータ($30-$9F)
+    BUS_FM_CH,   // FMチャンネル($A0-$B6)
+    BUS_KEY_ON,  // キーオン($28)
+    BUS_RHYTHM,  // リズム($10-$1D)
+    BUS_SSG,     // SSG($00-$0D)
+    BUS_TIMER,   // タイマー($24-$27)
+    BUS_PORT,    // SSGのI/Oポート($0E-$0F, MidiPanel)
+    BUS_STATUS,  // ステータスの読み出し
+    BUS_OTHER,   // その他(ADPCM, LFO, プリスケーラなど)
+    BUS_CLASSES,
+};
+constexpr int BUS_DOCKS = MAX_DOCKS;  // 計測するDock数
+
+/**
+ * @brief バスアクセスの統計
+ * @details Dock・レジスタ分類ごとに、アクセス回数と、バスを占有した時間(WAIT_xxの待ちを含み、
+ *          ロックの取得待ちは含まない)を数える。ロック取得中に更新するので、両コアの分を合算する
+ */
+struct BusCounters {
+    uint32_t writes;   // 書き込み回数
+    uint32_t reads;    // 読み出し回数
+    uint32_t busy_us;  // 占有時間の合計(us, 周回する)
+};
+extern BusCounters bus_counters(int dock, BusClass cls);
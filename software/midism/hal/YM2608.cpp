@@ -6,6 +6,8 @@
 //
 #include "YM2608.h"
 
+#include "Latency.h"
+
 YM2608::YM2608(HAL& hal, float clock, int id) : OpnBase(hal, clock, id) {
 }
 
@@ -14,6 +16,7 @@ YM2608::~YM2608() {
 
 void YM2608::rtm_turnon_key(int rtm) {
     hal.write(0x10, rtm & 0x3f, 0, WAIT_576);
+    LATENCY_KEY_ON();
 }
 
 void YM2608::rtm_damp_key(int rtm) {
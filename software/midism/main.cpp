@@ -7,107 +7,269 @@
 #include <cstdint>
 #include <cstdio>
 
+#include "BusLoad.h"
+#include "DebugSnapshot.h"
 #include "Debugger.h"
+#include "DmaRingReader.h"
+#include "Latency.h"
+#include "Memory.h"
+#include "MidiBatch.h"
 #include "MidiFactory.h"
 #include "MidiPanel.h"
 #include "MidiProcessor.h"
+#include "MidiStreamParser.h"
+#include "MidiUart.h"
+#include "OpnProbe.h"
+#include "Profile.h"
 #include "RP2040.h"
+#include "StaticArena.h"
+#include "Telemetry.h"
+#include "Trace.h"
 #include "VoiceAllocator.h"
+#include "YM2203.h"
 #include "YM2608.h"
-//#include "YM2203.h"
 #include "bsp/board.h"
 #include "config.h"
+#include "pico/flash.h"
 #include "pico/multicore.h"
 #include "pico/stdlib.h"
 #include "tusb.h"
 
+/**
+ * @brief MIDIメッセージの入力元
+ * @details USB MIDIのケーブル0 - MIDI_CABLES-1と、DIN MIDI入力(MIDI_CABLES)
+ */
+#if ENABLE_DIN_MIDI == 1
+static constexpr int MIDI_SOURCES  = MIDI_CABLES + 1;
+static constexpr int DIN_SOURCE    = MIDI_CABLES;
+static constexpr int DIN_DRAIN_MAX = 32;  // 1回のループで処理するDIN MIDIの最大バイト数
+#else
+static constexpr int MIDI_SOURCES = MIDI_CABLES;
+#endif
+
+#if ENABLE_NOTEOFF_REORDER == 1
+static uint32_t reorder_count = 0;  // 並べ替えたNote Offの数(統計用)
+#endif
+static OpnType dock_types[MAX_DOCKS];  // Dockに接続されたFM音源LSI(起動時に調べる)
+static uint32_t create_us = 0;         // MidiFactory::Create()の処理時間(統計用)
+static uint32_t ready_ms  = 0;         // 起動からMIDIメッセージの処理を開始するまでの時間(統計用)
+
+#if ENABLE_DEUGGER == 1 || ENABLE_MIDI_PANEL == 1
+static void core1_entry();
+#endif
+#if ENABLE_MIDI_PANEL == 1
+static MidiPanel* core1_panel = nullptr;  // Core1で走査するMIDIパネル(nullptr:パネルなし)
+#endif
+
 #if ENABLE_DEUGGER == 1
 using namespace Debugger;
-static void core1_entry();
-static void debug_command(std::array<MidiChannel*, MIDI_CHANNELS>& channels, MidiProcessor& mp);
+static void debug_command(
+    std::array<std::array<MidiChannel*, MIDI_CHANNELS>, MIDI_CABLES>& channels,
+    std::array<MidiProcessor*, MIDI_SOURCES>& mp);
 #endif
 
+/**
+ * @brief USB MIDIイベントパケットのCIN(Code Index Number)ごとのMIDIメッセージ長
+ */
+static constexpr uint8_t cin_length[16] = {
+    0, 0,        // 0x0-0x1: Reserved
+    2,           // 0x2: 2バイトのSystem Common
+    3,           // 0x3: 3バイトのSystem Common
+    3,           // 0x4: SysEx開始/継続
+    1,           // 0x5: 1バイトのSystem Common / SysEx終了(1バイト)
+    2,           // 0x6: SysEx終了(2バイト)
+    3,           // 0x7: SysEx終了(3バイト)
+    3, 3, 3, 3,  // 0x8-0xb: Note Off, Note On, Poly Key Pressure, Control Change
+    2, 2,        // 0xc-0xd: Program Change, Channel Pressure
+    3,           // 0xe: Pitch Bend
+    1,           // 0xf: 1バイト
+};
+
 /*********************************************************
  * Main (Core0)
  *********************************************************/
 int main(int argc, char** argv) {
-    // HAL adapterの生成と初期化
-    RP2040 hal0(0), hal1(1), hal2(2), hal3(3);
-    RP2040::init();
+#if ENABLE_MEMORY_STATS == 1
+    Memory::PaintStacks();  // スタックの最大使用量の計測用(Core1の起動前に行う)
+#endif
 
-    // FM音源モジュールのインスタンス生成と、HAL adapterの紐付け
-    //    YM2203 module_0(hal0, 4000.0, 0);
-    //    YM2203 module_1(hal1, 4000.0, 1);
-    YM2608 module_0(hal0, 8000.0, 0);
-    YM2608 module_1(hal1, 8000.0, 1);
-    YM2608 module_2(hal2, 8000.0, 2);
-    YM2608 module_3(hal3, 8000.0, 3);
+    // HAL adapterの生成と初期化(Dockごと)
+    static StaticArena<RP2040, MAX_DOCKS> buses;
+    HAL* hals[MAX_DOCKS];
+    for (int d = 0; d < MAX_DOCKS; d++) {
+        hals[d] = buses.Create(d);
+    }
+    RP2040::init();
+#if ENABLE_PROFILE == 1
+    Profile::Init();  // Core0のSysTickで計測する
+#endif
 
-    // FM音源モジュールのDockへの接続
+    // 全Dockを調べて、接続されているFM音源モジュールのインスタンスを生成する
     // 未接続のDockにはnullptrをセットする
-    std::array<OpnBase*, 4> modules{
-        &module_0,  // Dock0
-        &module_1,  // Dock1
-        &module_2,  // Dock2
-        &module_3   // Dock3
-    };
+    static StaticArena<YM2608, MAX_DOCKS> opna;
+    static StaticArena<YM2203, MAX_DOCKS> opn;
+    std::array<OpnBase*, MAX_DOCKS> modules{};
+    OpnBase* rhythm_module = nullptr;  // リズム音源(最上位のDockのYM2608)
+    opn_scan(hals, dock_types, MAX_DOCKS);
+    for (int d = 0; d < MAX_DOCKS; d++) {
+        if (dock_types[d] == OPN_YM2608) {
+            modules[d]    = opna.Create(*hals[d], YM2608_CLOCK, d);
+            rhythm_module = modules[d];
+        } else if (dock_types[d] == OPN_YM2203) {
+            modules[d] = opn.Create(*hals[d], YM2203_CLOCK, d);
+        }
+    }
 
     // MIDIチャンネルのインスタンス生成とリズムチャンネルの設定
-    // (ここではmodule_3のYM2608をリズム用に使用している)
     MidiFactory factory(modules);
-    auto midi_channels = factory.Create(&module_3);
+    uint32_t start      = time_us_32();
+    auto& midi_channels = factory.Create(rhythm_module);
+    create_us           = time_us_32() - start;
 
-    // MIDI processorの生成
-    MidiProcessor mp(midi_channels);
+    // MIDI processorの生成(入力元ごと)
+    // ランニングステータスとSysExの受信状態は入力元ごとに持つ
+    static StaticArena<MidiProcessor, MIDI_SOURCES> processors;
+    std::array<MidiProcessor*, MIDI_SOURCES> mp;
+    for (int cable = 0; cable < MIDI_CABLES; cable++) {
+        mp[cable] = processors.Create(midi_channels[cable], cable);
+    }
+#if ENABLE_DIN_MIDI == 1
+    // DIN MIDI入力はDIN_MIDI_CABLEのMIDIチャンネルに合流させる
+    mp[DIN_SOURCE] = processors.Create(midi_channels[DIN_MIDI_CABLE], DIN_SOURCE);
+    static MidiUart din_uart;  // リングバッファのアラインメントのためスタックに置かない
+    din_uart.Init();
+    DmaRingReader din_ring(din_uart.GetBuffer(), MidiUart::RING_SIZE);
+    MidiStreamParser din_parser;
+#endif
 
 #if ENABLE_MIDI_PANEL == 1
-    // MIDI状態表示パネルのインスタンス生成 (module_0で制御する)
-    MidiPanel panel(module_0);
-    // パネルのMIDIチャンネルのON/OFF設定を反映
-    mp.EnableChannels(panel.GetMidiSwState());
+    // MIDI状態表示パネルのインスタンス生成 (Dock0のモジュールで制御する)
+    // Dock0にモジュールがない場合はパネルを使わず、全MIDIチャンネルをONとする
+    static StaticArena<MidiPanel, 1> panels;
+    MidiPanel* panel = modules[0] ? panels.Create(*modules[0]) : nullptr;
+    core1_panel      = panel;  // 以後の走査はCore1で行う
+    // パネルのMIDIチャンネルのON/OFF設定を反映(全ケーブル共通)
+    uint16_t sw_state = panel ? panel->GetMidiSwState() : 0xffff;
+    for (auto* p : mp) {
+        p->EnableChannels(sw_state);
+    }
+    std::array<uint16_t, MIDI_SOURCES> keyOn{0};  // 入力元ごとのKeyOn状態
+#endif
+
+    // 入力元ごとの受信メッセージ
+    static std::array<MidiBatch, MIDI_SOURCES> batch;
+#if ENABLE_DIN_MIDI == 1
+    static_assert(DIN_DRAIN_MAX <= MidiBatch::MAX_MESSAGES, "DIN_DRAIN_MAX is too large");
 #endif
 
+#if ENABLE_TELEMETRY == 1
+    // 統計情報の要求は入力元のケーブルに応答する(DIN MIDIはDIN_MIDI_CABLE)
+    static Telemetry telemetry(midi_channels, batch.data(), MIDI_SOURCES);
+    for (int src = 0; src < MIDI_SOURCES; src++) {
+        int cable = (src < MIDI_CABLES) ? src : DIN_MIDI_CABLE;
+        mp[src]->RegisterSysEx(Telemetry::REQUEST_ID, sizeof(Telemetry::REQUEST_ID), &telemetry,
+                               sysex_tag(src, cable));
+    }
+#endif
+
+    // MIDIメッセージの実行
+    auto exec = [&](int src, MidiBatch::Message& m) {
+        LATENCY_BEGIN(m.time);
+#if ENABLE_MIDI_PANEL == 1
+        keyOn[src] = mp[src]->Exec(m.data, m.num);
+        if (panel) {
+            uint16_t led = 0;
+            for (auto k : keyOn) {
+                led |= k;
+            }
+            panel->SetLed(led);  // CH毎のKeyOn状態表示(全入力元の合成)
+        }
+#else
+        mp[src]->Exec(m.data, m.num);
+#endif
+        LATENCY_END();
+        factory.Service();  // バッチ処理中もCSMのフレーム更新を遅らせない
+    };
+
     // TinyUSB MIDIの初期化
     board_init();
     tusb_init();
     sleep_ms(500);
 
-#if ENABLE_DEUGGER == 1
-    // Debuggerの起動(Core1)
+#if ENABLE_DEUGGER == 1 || ENABLE_MIDI_PANEL == 1
+    // DebuggerとMIDIパネルの走査の起動(Core1)
     multicore_launch_core1(core1_entry);
 #endif
 
     // MIDIメッセージ処理の開始
     Debugger::gMidiMode = true;  // MIDIモードで起動(以後Deubugerで制御される)
+    ready_ms            = time_us_64() / 1000;
     do {
         tud_task();
-        // MIDIメッセージの待機
-        if (tud_midi_n_available(0, 0)) {
-            uint8_t msg[3]{0};
-            int num = tud_midi_n_stream_read(0, 0, msg, sizeof(msg));
-            // MIDIメッセージの実行
-            if (num && Debugger::gMidiMode) {
-#if ENABLE_MIDI_PANEL == 1
-                uint16_t keyOn = mp.Exec(msg, num);
-                panel.SetLed(keyOn);  // CH毎のKeyOn状態表示
-                                      //printf("%04x\n", keyOn);
-#else
-                mp.Exec(msg, num);
+        factory.Service();  // CSMのフレーム更新
+        // 受信済みのMIDIメッセージを入力元ごとにまとめる
+        // (ケーブル番号を得るため、ストリームではなくイベントパケット単位で読み出す)
+        uint8_t packet[4];
+        uint32_t now = time_us_32();  // 受信時刻(レイテンシの起点)
+        while (tud_midi_n_packet_read(0, packet)) {
+            int cable = packet[0] >> 4;
+            int num   = cin_length[packet[0] & 0x0f];
+            if (cable < MIDI_CABLES && num) {
+                batch[cable].Push(&packet[1], num, now);
+                if (batch[cable].IsFull()) {
+                    break;
+                }
+            }
+        }
+#if ENABLE_DIN_MIDI == 1
+        din_ring.Drain(din_uart.GetWriteCount(), DIN_DRAIN_MAX, [&](uint8_t data) {
+            uint8_t msg[3];
+            int num = din_parser.Push(data, msg);
+            if (num) {
+                batch[DIN_SOURCE].Push(msg, num, now);
+            }
+        });
 #endif
+        // MIDIメッセージの実行
+        for (int src = 0; src < MIDI_SOURCES; src++) {
+            MidiBatch& b = batch[src];
+            if (Debugger::gMidiMode) {
+#if ENABLE_NOTEOFF_REORDER == 1
+                reorder_count += b.Reorder();
+#endif
+                for (int i = 0; i < b.Count(); i++) {
+                    exec(src, b[i]);
+                }
             }
+            b.Clear();
         }
+#if ENABLE_TELEMETRY == 1
+        telemetry.Service();  // 統計情報の応答の送信
+#endif
 #if ENABLE_MIDI_PANEL == 1
-        // MIDIパネル状態の更新
-        panel.Update();
-        // MIDIチャンネルのON/OFF設定更新
-        mp.EnableChannels(panel.GetMidiSwState());
-        // MIDIリセットボタンの処理
-        if (panel.IsMidiReset()) {
-            panel.SetLed(0);
-            mp.Reset();
-            printf("MIDI RESET!\n");
+        if (panel) {
+            // MIDI入力の処理待ちがある間はCore1のパネルの走査を保留させる
+            bool pending = tud_midi_n_available(0, 0) > 0;
+#if ENABLE_DIN_MIDI == 1
+            pending = pending || din_ring.IsPending(din_uart.GetWriteCount());
+#endif
+            panel->SetPending(pending);
+            // MIDIチャンネルのON/OFF設定更新
+            uint16_t sw = panel->GetMidiSwState();
+            if (sw != sw_state) {
+                sw_state = sw;
+                for (auto* p : mp) {
+                    p->EnableChannels(sw_state);
+                }
+            }
+            // MIDIリセットボタンの処理
+            if (panel->IsMidiReset()) {
+                panel->SetLed(0);
+                keyOn.fill(0);
+                MidiProcessor::ResetAll(mp.data(), MIDI_SOURCES);
+                printf("MIDI RESET!\n");
+            }
         }
-
 #endif
 #if ENABLE_DEUGGER == 1
         // Debuggerからのコマンド処理
@@ -118,40 +280,100 @@ int main(int argc, char** argv) {
     } while (1);
 }
 
-#if ENABLE_DEUGGER == 1
+#if ENABLE_DEUGGER == 1 || ENABLE_MIDI_PANEL == 1
 /*********************************************************
- * Debugger (Core1)
+ * Debugger, MidiPanel (Core1)
  *********************************************************/
+static void core1_idle() {
+    uint32_t now = time_us_32();
+#if ENABLE_MIDI_PANEL == 1
+    if (core1_panel) {
+        core1_panel->Update(now);
+    }
+#endif
+#if ENABLE_BUS_STATS == 1
+    BusLoad::Sample(now);  // バスの使用率の記録
+#endif
+#if ENABLE_TRACE == 1
+    Trace::Drain(8);  // トレースの表示(1回あたり最大8レコード)
+#endif
+}
+
 static void core1_entry() {
+#if ENABLE_TONE_BANK_FLASH == 1 || ENABLE_PHRASE_BANK_FLASH == 1
+    // Core0からのFlash書き込み中はCore1を停止させる
+    flash_safe_execute_core_init();
+#endif
+#if ENABLE_MIDI_PANEL == 1
+    if (core1_panel == nullptr) {
+        printf("WARNING: MIDI panel is disabled (no module in Dock0)\n");
+    }
+#endif
+#if ENABLE_DEUGGER == 1
     printf("\nFMSynthEnsmble\n");
-    Debugger::main();
-    while (1);
+    Debugger::main(core1_idle);  // コマンド入力待ちの間にcore1_idle()を呼び出す
+#endif
+    while (1) {
+        core1_idle();
+    }
 }
+#endif
 
-static void debug_command(std::array<MidiChannel*, MIDI_CHANNELS>& channels, MidiProcessor& mp) {
+#if ENABLE_DEUGGER == 1
+/*********************************************************
+ * Debuggerからのコマンド処理 (Core0)
+ *********************************************************/
+static void debug_command(
+    std::array<std::array<MidiChannel*, MIDI_CHANNELS>, MIDI_CABLES>& channels,
+    std::array<MidiProcessor*, MIDI_SOURCES>& mp) {
     uint32_t cmd = multicore_fifo_pop_blocking();
     switch (cmd & 0xff) {
     case DEBUGGER_MIDI_RESET:  // MIDIリセット
-        mp.Reset();
+        MidiProcessor::ResetAll(mp.data(), MIDI_SOURCES);
         break;
-    case DEBUGGER_DUMP_CHANNEL:  // MIDI Channelのダンプ
-        if (((cmd >> 8) & 0xff) == 0xff) {
-            for (auto& ch : channels) {
-                ch->dump();
+    case DEBUGGER_SNAPSHOT:  // MIDI Channel/Voiceの状態の取得(表示はCore1で行う)
+        gSnapshot.Write([&](DebugSnapshot& s) {
+            int n = 0;
+            for (auto& cable : channels) {
+                for (auto& ch : cable) {
+                    ch->snapshot(s.channels[n++]);
+                }
             }
-        } else {
-            channels[(cmd >> 8) & 0xff]->dump();
-        }
+            VoiceAllocator& allocator = VoiceAllocator::GetInstance();
+            s.voice_count             = allocator.snapshot(s.voices, MAX_VOICES);
+            s.time_ms                 = time_us_64() / 1000;
+            s.alloc                   = allocator.GetStats();
+            s.tone_load_count         = NoteVoice::GetToneLoadCount();
+            s.create_us               = create_us;
+            s.ready_ms                = ready_ms;
+            s.reset                   = MidiProcessor::GetResetTime();
+            for (int d = 0; d < MAX_DOCKS; d++) {
+                s.dock_type[d] = dock_types[d];
+            }
+#if ENABLE_NOTEOFF_REORDER == 1
+            s.reorder_count = reorder_count;
+#endif
+            ToneBank::GetInstance().snapshot(s.tone_bank);
+#if ENABLE_CSM != 0
+            CsmPhraseBank::GetInstance().snapshot(s.phrase_bank);
+#endif
+        });
         break;
-    case DEBUGGER_DUMP_VOICE:  // MIDI Voiceのダンプ
-        VoiceAllocator::GetInstance().dump();
+#if ENABLE_LATENCY == 1
+    case DEBUGGER_LATENCY:  // レイテンシのヒストグラムの取得とリセット
+        gSnapshot.Write([](DebugSnapshot& s) { Latency::Take(s.latency); });
         break;
-    case DEBUGGER_STATS:  // Voiceアロケーションの統計情報
-        printf("\nVoice allocation failure: %d\n", VoiceAllocator::GetInstance().GetFailedCount());
-        for (auto& ch : channels) {
-            ch->stats();
-        }
+#endif
+#if ENABLE_PROFILE == 1
+    case DEBUGGER_PROFILE:  // 実行サイクル数の集計の取得(bit8:取得後にリセット)
+        gSnapshot.Write([=](DebugSnapshot& s) { Profile::Take(s.profile, (cmd >> 8) & 1); });
+        break;
+#endif
+#if ENABLE_MEMORY_STATS == 1
+    case DEBUGGER_MEMORY:  // ヒープとスタックの使用状況の取得(bit8:取得後に回数をリセット)
+        gSnapshot.Write([=](DebugSnapshot& s) { Memory::Take(s.memory, (cmd >> 8) & 1); });
         break;
+#endif
     default:
         break;
     }
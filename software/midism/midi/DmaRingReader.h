@@ -0,0 +1,76 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include <cstdint>
+
+/**
+ * @brief DMAが書き込むリングバッファの読み出し
+ * @details
+ * 書き込み側(DMA)は割り込みを使わずにバッファを周回するので、書き込み位置は
+ * 呼び出し元が単調増加する受信バイト数として与える。読み出し位置も単調増加させ、
+ * 参照時にバッファサイズ-1でマスクする。
+ * 書き込み側が読み出し位置を追い越した場合(オーバーラン)は、上書きされていない
+ * 最新のバッファサイズ分から読み出しを再開する。
+ */
+class DmaRingReader {
+private:
+    const volatile uint8_t* buffer;  // リングバッファ
+    uint32_t mask;                   // バッファサイズ-1
+    uint32_t read;                   // 読み出したバイト数
+    uint32_t overruns;               // オーバーランの回数
+
+public:
+    /**
+     * @brief コンストラクタ
+     * @param buffer リングバッファ
+     * @param size   バッファサイズ(2のべき乗)
+     */
+    DmaRingReader(const volatile uint8_t* buffer, uint32_t size)
+        : buffer(buffer), mask(size - 1), read(0), overruns(0) {}
+
+    /**
+     * @brief 読み出し位置を書き込み位置に合わせる(未読データを破棄する)
+     * @param write 書き込んだバイト数
+     */
+    void Reset(uint32_t write) { read = write; }
+
+    /**
+     * @brief 未読データを取り出す
+     * @param write 書き込んだバイト数(単調増加、uint32_tでの桁あふれは許容する)
+     * @param max   一度に取り出す最大バイト数
+     * @param func  1バイトごとに呼び出す関数 void(uint8_t)
+     * @return 取り出したバイト数
+     */
+    template <typename Func>
+    int Drain(uint32_t write, int max, Func&& func) {
+        uint32_t n = write - read;
+        if (n > mask + 1) {
+            // オーバーラン
+            ++overruns;
+            read = write - (mask + 1);
+            n    = mask + 1;
+        }
+        if (n > (uint32_t)max) {
+            n = max;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            func(buffer[read++ & mask]);
+        }
+        return n;
+    }
+
+    /**
+     * @brief 未読データがあるかどうか
+     * @param write 書き込んだバイト数
+     */
+    bool IsPending(uint32_t write) const { return write != read; }
+
+    /**
+     * @brief オーバーランの回数を返す
+     */
+    uint32_t GetOverruns() const { return overruns; }
+};
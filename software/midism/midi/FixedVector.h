@@ -0,0 +1,66 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include <iterator>
+
+/**
+ * @brief 固定長の配列
+ * @tparam T 要素の型
+ * @tparam N 最大要素数
+ * @details std::vectorの代わりに使う。動的メモリ確保は行わない。
+ *          範囲for文と逆順の走査に対応する。
+ */
+template <typename T, int N>
+class FixedVector {
+    static_assert(N > 0, "N must be positive");
+
+private:
+    T items[N];
+    int count;
+
+public:
+    constexpr FixedVector() : items{}, count(0) {}
+
+    /**
+     * @brief 末尾に要素を追加する
+     * @param item 追加する要素
+     * @return true:成功, false:満杯
+     */
+    bool Push(const T& item) {
+        if (count >= N) {
+            return false;
+        }
+        items[count++] = item;
+        return true;
+    }
+
+    /**
+     * @brief 要素をすべて削除する
+     */
+    void Clear() { count = 0; }
+
+    /**
+     * @brief 要素数を返す
+     */
+    int Count() const { return count; }
+
+    /**
+     * @brief 最大要素数を返す
+     */
+    static constexpr int Capacity() { return N; }
+
+    T& operator[](int i) { return items[i]; }
+    const T& operator[](int i) const { return items[i]; }
+
+    // 範囲for文と逆順の走査用
+    T* begin() { return items; }
+    T* end() { return items + count; }
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
+    std::reverse_iterator<T*> rbegin() { return std::reverse_iterator<T*>(end()); }
+    std::reverse_iterator<T*> rend() { return std::reverse_iterator<T*>(begin()); }
+};
@@ -0,0 +1,80 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#include "MidiBatch.h"
+
+bool MidiBatch::Push(const uint8_t* msg, int num, uint32_t time) {
+    if (IsFull()) {
+        return false;
+    }
+    Message& m = messages[count++];
+    for (int i = 0; i < 3; i++) {
+        m.data[i] = (i < num) ? msg[i] : 0;
+    }
+    m.num  = num;
+    m.time = time;
+    if (count > high_water) {
+        high_water = count;
+    }
+    return true;
+}
+
+bool MidiBatch::is_note_off(const Message& m) {
+    uint8_t ev = m.data[0] & 0xf0;
+    return m.num == 3 && (ev == 0x80 || (ev == 0x90 && m.data[2] == 0));
+}
+
+bool MidiBatch::is_barrier(const Message& m, const Message& off) {
+    uint8_t status = m.data[0];
+    if (status >= 0xf8) {
+        return false;  // リアルタイムメッセージは無関係
+    }
+    if (status < 0x80 || status >= 0xf0) {
+        return true;  // SysEx(継続中のデータを含む), System Common Message
+    }
+    if ((status & 0x0f) != (off.data[0] & 0x0f)) {
+        return false;  // 他のチャンネル
+    }
+    switch (status & 0xf0) {
+    case 0x80:
+    case 0x90:
+        // 同一キーのNote On/Offとは順序を入れ替えない
+        return m.data[1] == off.data[1];
+    case 0xb0:
+        switch (m.data[1]) {
+        case 64:   // Hold1
+        case 120:  // All Sound Off
+        case 121:  // Reset All Controllers
+        case 123:  // All Notes Off
+            return true;
+        default:
+            return false;
+        }
+    default:
+        return false;
+    }
+}
+
+int MidiBatch::Reorder() {
+    int moved = 0;
+    // Note Offを、障壁か他のNote Offに当たるまで前方に移動する(挿入ソート)
+    for (int i = 1; i < count; i++) {
+        if (!is_note_off(messages[i])) {
+            continue;
+        }
+        Message off = messages[i];
+        int j       = i;
+        while (j > 0 && !is_note_off(messages[j - 1]) && !is_barrier(messages[j - 1], off)) {
+            messages[j] = messages[j - 1];
+            --j;
+        }
+        if (j != i) {
+            messages[j] = off;
+            ++moved;
+        }
+    }
+    return moved;
+}
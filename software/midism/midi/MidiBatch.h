@@ -0,0 +1,65 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include <cstdint>
+
+/**
+ * @brief 1回の受信でまとめて処理するMIDIメッセージ
+ * @details
+ * 入力元ごとに受信したメッセージを蓄積し、まとめてMidiProcessorに渡す。
+ * 渡す前にReorder()でNote Offを先に処理するよう並べ替えることができる。
+ */
+class MidiBatch {
+public:
+    static constexpr int MAX_MESSAGES = 32;  // 蓄積できるメッセージ数
+
+    struct Message {
+        uint8_t data[3];  // MIDIメッセージ
+        uint8_t num;      // バイト数
+        uint32_t time;    // 受信した時刻(us)
+    };
+
+private:
+    Message messages[MAX_MESSAGES];
+    int count;
+    int high_water;  // DEBUG: 蓄積したメッセージ数の最大値
+
+public:
+    MidiBatch() : count(0), high_water(0) {}
+
+    /**
+     * @brief メッセージを追加する
+     * @param msg MIDIメッセージ
+     * @param num  バイト数(1-3)
+     * @param time 受信した時刻(us)
+     * @return false:満杯
+     */
+    bool Push(const uint8_t* msg, int num, uint32_t time = 0);
+
+    void Clear() { count = 0; }
+    int Count() const { return count; }
+    bool IsFull() const { return count == MAX_MESSAGES; }
+    Message& operator[](int i) { return messages[i]; }
+    int GetHighWater() const { return high_water; }
+
+    /**
+     * @brief Note Offを先に処理するよう並べ替える
+     * @return 並べ替えたNote Offの数
+     * @details
+     * Note Offを、キーの異なるNote Onより前に移動する。
+     * 同一チャンネル・同一キーのNote On/Offと、他のNote Offとの順序は変えない。
+     * 以下は移動の障壁とし、これを越えては移動しない。
+     * - 同一チャンネルのHold1(CC#64), All Sound Off(CC#120), Reset All Controllers(CC#121),
+     *   All Notes Off(CC#123)
+     * - System Exclusive, System Common Message(全チャンネル共通)
+     */
+    int Reorder();
+
+private:
+    static bool is_note_off(const Message& m);
+    static bool is_barrier(const Message& m, const Message& off);
+};
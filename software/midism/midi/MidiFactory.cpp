@@ -7,67 +7,160 @@
 #include "MidiFactory.h"
 
 #include "CsmVoice.h"
+#include "Memory.h"
 #include "NoteChannel.h"
 #include "NoteVoice.h"
+#include "RP2040.h"
 #include "RhythmChannel.h"
+#include "StaticArena.h"
 #include "config.h"
 
 //#define ENABLE_CSM
 
-MidiFactory::MidiFactory(std::array<OpnBase*, 4>& modules) : modules(modules) {
+static_assert(MIDI_CABLES >= 1 && MIDI_CABLES <= 4, "MIDI_CABLES is out of range");
+
+/**
+ * @brief MIDI_CABLE_DOCKSの全ケーブルにDockが指定されているか調べる
+ * @details 初期化子が足りないケーブルは0になり、Voiceを割り当てられないので検出する
+ */
+static constexpr bool has_cable_docks() {
+    for (uint8_t mask : MIDI_CABLE_DOCKS) {
+        if (mask == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(has_cable_docks(), "MIDI_CABLE_DOCKS must give every cable a dock");
+
+#if ENABLE_CSM != 0
+/**
+ * @brief CSM_VOICE_DOCKSのDockが重複していないか調べる
+ */
+static constexpr bool is_disjoint_csm_docks() {
+    uint8_t used = 0;
+    for (uint8_t mask : CSM_VOICE_DOCKS) {
+        if (used & mask) {
+            return false;
+        }
+        used |= mask;
+    }
+    return true;
+}
+static_assert(is_disjoint_csm_docks(), "CSM_VOICE_DOCKS must not share a dock");
+
+/**
+ * @brief CSM_VOICE_DOCKSの最下位のDockが/IRQを持つか調べる
+ */
+static constexpr bool has_csm_irq() {
+    for (uint8_t mask : CSM_VOICE_DOCKS) {
+        if ((mask & ((1 << FM_IRQ_DOCKS) - 1)) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(has_csm_irq(), "The lowest dock of CSM_VOICE_DOCKS must have /IRQ");
+#endif
+
+// VoiceとMIDIチャンネルの領域(最大数はDockの構成から決まる)
+static StaticArena<NoteVoice, MAX_DOCKS * FM_CHANNELS_PER_DOCK> note_voices;
+static StaticArena<CsmVoice, CSM_VOICES> csm_voices;
+// (MIDI_CHANNELSがMIDI CH10を含まない場合は、リズムチャンネルを生成しない)
+static constexpr int RHYTHM_CHANNELS =
+    (MIDI_CHANNELS > RhythmChannel::MIDI_RHYTHM_CHANNEL) ? 1 : 0;  // ケーブルあたり
+static StaticArena<NoteChannel, MIDI_CABLES * (MIDI_CHANNELS - RHYTHM_CHANNELS)> note_channels;
+static StaticArena<RhythmChannel, MIDI_CABLES * RHYTHM_CHANNELS> rhythm_channels;
+
+MidiFactory::MidiFactory(std::array<OpnBase*, MAX_DOCKS>& modules) : modules(modules), csm{} {
 }
 
 MidiFactory::~MidiFactory() {
     VoiceAllocator::GetInstance().DeleteAllVoices();
     VoiceAllocator::GetInstance().DeleteAllObserver();
-    for (auto* channel : channels) {
-        delete channel;
-    }
+    rhythm_channels.Clear();
+    note_channels.Clear();
+    csm_voices.Clear();
+    note_voices.Clear();
 }
 
-std::array<MidiChannel*, MIDI_CHANNELS>& MidiFactory::Create(OpnBase* rhythm_module) {
+std::array<std::array<MidiChannel*, MIDI_CHANNELS>, MIDI_CABLES>& MidiFactory::Create(
+    OpnBase* rhythm_module) {
+    HEAP_TAG(FACTORY);  // 静的な領域に生成するので、コンストラクタが確保しない限り0になる
     VoiceAllocator& allocator = VoiceAllocator::GetInstance();
 
+    // CSM Voiceが使用するDock(CH3を音楽用に使わない)
+    uint8_t csm_docks = 0;
+#if ENABLE_CSM != 0
+    for (uint8_t mask : CSM_VOICE_DOCKS) {
+        csm_docks |= CsmVoice::SelectDocks(modules, mask);
+    }
+#endif
+
     // VoiceAllocatorにFM音源モジュールのチャンネルを登録
     // 音楽用
-    int vid = 0;  // voice id
-    for (auto* module : modules) {
+    int vid                               = 0;   // voice id
+    std::array<NoteVoice*, MAX_DOCKS> ch3 = {};  // CSM Voiceと共有するCH3
+    for (int d = 0; d < (int)modules.size(); d++) {
+        OpnBase* module = modules[d];
         if (module) {
             module->init();
             for (int ch = 0; ch < module->fm_get_channels(); ++ch) {
-#if ENABLE_CSM != 0
-                if (ch != 2) {
-                    allocator.AddVoice(new NoteVoice(*module, ch, vid++));
-                }
-#else
-                allocator.AddVoice(new NoteVoice(*module, ch, vid++));
+                if (ch != 2 || ((csm_docks >> d) & 1) == 0) {
+                    allocator.AddVoice(note_voices.Create(*module, ch, vid++));
+                } else {
+#if ENABLE_CSM_CH3_LENDING == 1
+                    ch3[d] = note_voices.Create(*module, ch, vid++, true);
+                    allocator.AddVoice(ch3[d]);
 #endif
+                }
             }
         }
     }
 
 #if ENABLE_CSM != 0
     // CSM音声合成用
-    CsmVoice* csm = new CsmVoice(modules, vid++);
-    csm->Init(true);  // CSMを割り込み駆動で動作させる
-    allocator.AddVoice(csm);
+    for (int i = 0; i < CSM_VOICES; i++) {
+        if (CsmVoice::SelectDocks(modules, CSM_VOICE_DOCKS[i]) == 0) {
+            continue;  // FM音源モジュールが実装されていない
+        }
+        csm[i] = csm_voices.Create(modules, CSM_VOICE_DOCKS[i], vid++);
+        for (int d = 0; d < (int)modules.size(); d++) {
+            if (((csm[i]->GetDockMask() >> d) & 1) && ch3[d]) {
+                csm[i]->AddLender(ch3[d]);
+            }
+        }
+        csm[i]->Init(true);  // CSMを割り込み駆動で動作させる(フレーム更新はService()で行う)
+        allocator.AddVoice(csm[i]);
+    }
 #endif
 
     // MIDIチャンネルのインスタンスを生成
-    for (int i = 0; i < channels.size(); i++) {
-        if (i == RhythmChannel::MIDI_RHYTHM_CHANNEL) {
-            // リズムチャンネル
-            RhythmChannel* rc = new RhythmChannel(rhythm_module);
-            channels[i]       = rc;
-            // VoiceAllocatorにオブザーバーを登録
-            allocator.AddObserver(i, rc);
-        } else {
-            // ノートチャンネル
-            NoteChannel* nc = new NoteChannel(i);
-            channels[i]     = nc;
-            // VoiceAllocatorにオブザーバーを登録
-            allocator.AddObserver(i, nc);
+    for (int cable = 0; cable < MIDI_CABLES; cable++) {
+        for (int i = 0; i < MIDI_CHANNELS; i++) {
+            int no = cable * MIDI_CHANNELS + i;  // システム全体でのチャンネル番号
+            if (i == RhythmChannel::MIDI_RHYTHM_CHANNEL) {
+                // リズムチャンネル
+                RhythmChannel* rc  = rhythm_channels.Create(rhythm_module, no);
+                channels[cable][i] = rc;
+                // VoiceAllocatorにオブザーバーを登録
+                allocator.AddObserver(no, rc);
+            } else {
+                // ノートチャンネル
+                NoteChannel* nc    = note_channels.Create(no);
+                channels[cable][i] = nc;
+                // VoiceAllocatorにオブザーバーを登録
+                allocator.AddObserver(no, nc);
+            }
         }
     }
     return channels;
 }
+
+void MidiFactory::Service() {
+    for (CsmVoice* voice : csm) {
+        if (voice) {
+            voice->Poll();
+        }
+    }
+}
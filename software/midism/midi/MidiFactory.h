@@ -11,19 +11,22 @@
 #include "OpnBase.h"
 #include "config.h"
 
+class CsmVoice;
+
 /**
  * @brief MidiFactory class
  */
 class MidiFactory {
-    std::array<OpnBase*, 4>& modules;
-    std::array<MidiChannel*, MIDI_CHANNELS> channels;
+    std::array<OpnBase*, MAX_DOCKS>& modules;
+    std::array<std::array<MidiChannel*, MIDI_CHANNELS>, MIDI_CABLES> channels;
+    std::array<CsmVoice*, CSM_VOICES> csm;  // CSM Voice(生成しない場合はnullptr)
 
 public:
     /**
      * @brief コンストラクタ
      * @param modules FM音源モジュールの配列
      */
-    MidiFactory(std::array<OpnBase*, 4>& modules);
+    MidiFactory(std::array<OpnBase*, MAX_DOCKS>& modules);
     MidiFactory() = delete;
 
     /**
@@ -34,7 +37,16 @@ public:
     /**
      * @brief MIDIチャンネルとMIDI Voiceの生成
      * @param rhythm_module 割り当てるリズム音源モジュール
-     * @return 生成したMIDIチャンネルの配列
+     * @return 生成したMIDIチャンネルの配列(USB MIDIのケーブルごと)
+     * @details チャンネル番号は、ケーブル番号 * MIDI_CHANNELS + チャンネル番号とする。
+     *          リズム音源モジュールは全ケーブルのリズムチャンネルで共有する。
+     */
+    std::array<std::array<MidiChannel*, MIDI_CHANNELS>, MIDI_CABLES>& Create(
+        OpnBase* rhythm_module = nullptr);
+
+    /**
+     * @brief Voiceの定期処理
+     * @details メインループから頻繁に呼び出す。全CSM Voiceの更新待ちのフレームを処理する。
      */
-    std::array<MidiChannel*, MIDI_CHANNELS>& Create(OpnBase* rhythm_module = nullptr);
+    void Service();
 };
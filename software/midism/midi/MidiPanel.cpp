@@ -7,6 +7,7 @@
 #include "MidiPanel.h"
 
 #include "config.h"
+#include "hardware/timer.h"
 
 #if ENABLE_CONNECTOR_WIRING_BUG_WORKAROUND == 1
 // 回路のバグ対策 : uin8_tのビット反転テーブル
@@ -36,69 +37,101 @@ static constexpr uint8_t reverseLookup[256] = {
 MidiPanel::MidiPanel(OpnBase& module)
     : module(module),
       row(0),
-      p_row(0),
       midi_sw_state(0),
       led_status(0x0000),
-      midi_reset_count(0),
-      bReset(false),
-      bShowKeyOn(false) {
+      reset_count(0),
+      bPending(false),
+      pa_last(0x0f),
+      sw_raw{},
+      sw_changed{},
+      last_scan(0),
+      reset_since(0),
+      bResetHeld(false),
+      bShowKeyOn(false),
+      reset_seen(0) {
     // PA:出力, PB:入力
     module.set_port_direction(true, false);
+    module.write_port_a(lookup(pa_last));  // 全列OFF
 
-    // 4回のコールで初期値を確定させる
+    // 4回の走査で初期値を確定させる(起動時はチャタリング除去しない)
+    last_scan = time_us_32();
     for (int i = 0; i < 4; i++) {
-        Update();
+        scan(last_scan, false);
     }
 }
 
 MidiPanel::~MidiPanel() {
 }
 
-void MidiPanel::Update() {
-    // ちらつき低減のため前回の列出力をOFFにする
-    module.write_port_a(lookup(PA3_0[p_row]));
+bool MidiPanel::Update(uint32_t now) {
+    uint32_t elapsed = now - last_scan;
+    if (elapsed < PANEL_SCAN_US || (bPending && elapsed < PANEL_MAX_YIELD_US)) {
+        return false;
+    }
+    last_scan = now;
+    scan(now, true);
+    return true;
+}
 
+void MidiPanel::scan(uint32_t now, bool debounce) {
     // 出力ポートPA bit0-3にLowをセット
     //   入力ポートPB bit0-3をリードして当該列のMIDIスイッチ状態を得る
     //   出力ポートPA bit4-7をセットして当該列のLEDを点灯させる
-    if (bShowKeyOn) {
-        uint8_t hi = ((led_status >> (row * 4)) & 0xf) << 4;
-        module.write_port_a(lookup(hi | PA3_0[row]));
-    } else {
-        // スイッチ状態をLEDに反映させる
-        module.write_port_a(lookup(PA7_4[row] | PA3_0[row]));
+    uint8_t hi   = bShowKeyOn ? ((led_status >> (row * 4)) & 0xf) << 4 : PA7_4[row];
+    uint8_t data = hi | PA3_0[row];
+
+    // ちらつき低減のため前回の列出力をOFFにする
+    // (前回の列か今回の列が消灯している場合は、列の切替で他の列に漏れないので省略する)
+    if ((pa_last & 0xf0) && hi) {
+        write_pa(pa_last & 0x0f);
     }
+    write_pa(data);
 
     // 入力ポートPBを読み取り正論理に変換
     uint8_t dat = ~lookup(module.read_port_b());
 
-    // 1列分のMIDIスイッチの状態(bit0-3)をcolに保持
-    // それを次のrow周期で表示するLEDの状態として保存
-    uint8_t col = dat & 0x0f;
-    PA7_4[row]  = col << 4;
-
-    // colをMIDIスイッチの状態に反映
-    midi_sw_state = (midi_sw_state & mask[row]) | ((uint16_t)col << (row * 4));
+    // 読み取り値がPANEL_DEBOUNCE_US以上変化しなかったら確定する
+    if (dat != sw_raw[row]) {
+        sw_raw[row]     = dat;
+        sw_changed[row] = now;
+    }
+    if (!debounce || now - sw_changed[row] >= PANEL_DEBOUNCE_US) {
+        // 1列分のMIDIスイッチの状態(bit0-3)をcolに保持
+        // それを次のrow周期で表示するLEDの状態として保存
+        uint8_t col = dat & 0x0f;
+        PA7_4[row]  = col << 4;
+
+        // colをMIDIスイッチの状態に反映
+        midi_sw_state = (midi_sw_state & mask[row]) | ((uint16_t)col << (row * 4));
+
+        // 表示モードの切替
+        if (dat & 0x40) {
+            bShowKeyOn = false;  // MIDI ON/OFF状態表示モード
+        } else {
+            bShowKeyOn = true;  // MIDI KeyOn状態表示モード
+        }
+        // MIDIリセットボタンの長押しの検出
+        if (dat & 0x80) {
+            if (!bResetHeld) {
+                bResetHeld  = true;
+                reset_since = now;
+            } else if (now - reset_since >= PANEL_RESET_HOLD_US) {
+                reset_since = now;  // 押し続けた場合はPANEL_RESET_HOLD_USごとに検出する
+                reset_count = reset_count + 1;
+            }
+        } else {
+            bResetHeld = false;
+        }
+    }
 
     // 次の列へ
-    p_row = row;
-    row   = (row + 1) % 4;
+    row = (row + 1) % 4;
+}
 
-    // 表示モードの切替
-    if (dat & 0x40) {
-        bShowKeyOn = false;  // MIDI ON/OFF状態表示モード
-    } else {
-        bShowKeyOn = true;  // MIDI KeyOn状態表示モード
-    }
-    // MIDIリセットボタンの長押しの検出
-    if (dat & 0x80) {
-        if (++midi_reset_count > 50000) {
-            midi_reset_count = 0;
-            bReset           = true;
-        }
-    } else {
-        midi_reset_count = 0;
-        bReset           = false;
+void MidiPanel::write_pa(uint8_t data) {
+    if (data != pa_last) {
+        module.write_port_a(lookup(data));
+        pa_last = data;
     }
 }
 
@@ -111,9 +144,9 @@ void MidiPanel::DisplayRow(uint8_t row, uint8_t col) {
 }
 
 bool MidiPanel::IsMidiReset() {
-    if (bReset) {
-        midi_reset_count = 0;
-        bReset           = false;
+    uint32_t count = reset_count;
+    if (count != reset_seen) {
+        reset_seen = count;
         return true;
     } else {
         return false;
@@ -9,26 +9,45 @@
 
 #include "OpnBase.h"
 
+/**
+ * @brief MIDIパネルの制御
+ * @details
+ * 走査(Update())はCore1、それ以外のAPIはMIDIを処理するCore0から呼び出す。
+ * コア間では、一方のコアだけが書き込むワードでスイッチとLEDの状態を受け渡すので、ロックは不要。
+ * バスへのアクセスはRP2040クラスで排他する。
+ */
 class MidiPanel {
 private:
     OpnBase& module;                                               // 使用するOPN
     uint8_t row;                                                   // 現在の列番号
-    uint8_t p_row;                                                 // 直前の列番号
     uint8_t PA7_4[4]                  = {0x00, 0x00, 0x00, 0x00};  // LEDの列状態(上位4bit)
     static constexpr uint8_t PA3_0[4] = {0b00001110, 0b00001101, 0b00001011,
                                          0b00000111};  // Row制御データ(下位4bit)
     static constexpr uint16_t mask[4] = {0xfff0, 0xff0f, 0xf0ff, 0x0fff};
 
-    uint16_t midi_sw_state;     // MIDI ChannelのON/OFF状態(正論理16bit分)
-    uint16_t led_status;        // LEDの状態(正論理16bit分)
-    uint16_t midi_reset_count;  // MIDIリセットボタン連続押下回数
-    bool bReset;                // MIDIリセットボタン押下状態
-    bool bShowKeyOn;            // LED表示モード
+    // Core0とCore1で共有する(それぞれ一方のコアだけが書き込む)
+    volatile uint16_t midi_sw_state;  // MIDI ChannelのON/OFF状態(正論理16bit分) Core1→Core0
+    volatile uint16_t led_status;     // LEDの状態(正論理16bit分) Core0→Core1
+    volatile uint32_t reset_count;    // MIDIリセットボタン長押しの検出回数 Core1→Core0
+    volatile bool bPending;           // MIDI入力の処理待ちがある Core0→Core1
+
+    // 走査するコアだけが使用する
+    uint8_t pa_last;         // 最後にPAに書き込んだ値(ビット反転前)
+    uint8_t sw_raw[4];       // 列ごとのPBの読み取り値(正論理)
+    uint32_t sw_changed[4];  // 列ごとのPBの読み取り値が変化した時刻(us)
+    uint32_t last_scan;      // 最後に列を走査した時刻(us)
+    uint32_t reset_since;    // MIDIリセットボタンの押下を確定した時刻(us)
+    bool bResetHeld;         // MIDIリセットボタン押下中
+    bool bShowKeyOn;         // LED表示モード
+
+    // MIDIを処理するコアだけが使用する
+    uint32_t reset_seen;  // IsMidiReset()で処理したMIDIリセットボタンの検出回数
 
 public:
     /**
      * @brief コンストラクタ
      * @param module    使用するOPN
+     * @details 4列分を走査して初期値を確定させるので、Core1で走査を始める前に生成すること
      */
     MidiPanel(OpnBase& module);
     MidiPanel() = delete;
@@ -36,20 +55,29 @@ public:
 
     /**
      * @brief 1列分のスイッチの状態とLEDの点灯状態の更新
-     * @details 1回の呼び出しで、1列分のスイッチの読み出しと、LEDの点灯を行う。
-     * CPUの空き時間に本APIを繰り返し呼び出すこと。
-     * bShowKeyOn=falseの場合、4サイクル前の当該列のMIDIスイッチの状態をLEDに反映する。
-     * midiswは4サイクル分の遅延あり。buttonはリアルタイムの値を返す。
-     * LEDのダイナミック点灯をかねているので、点灯光量やちらつきは呼び出し頻度に依存する。
+     * @param now 現在時刻(us)
+     * @return true:1列分を走査した
+     * @details 前回の走査からPANEL_SCAN_US以上経過した場合に限り、1列分のスイッチの読み出しと、
+     * LEDの点灯を行う。Core1のループから繰り返し呼び出すこと。
+     * SetPending(true)の間はMIDI入力の処理を優先して走査しない。ただし、走査の間隔が
+     * PANEL_MAX_YIELD_US以上空いた場合は走査する。
+     * bShowKeyOn=falseの場合、4周期前の当該列のMIDIスイッチの状態をLEDに反映する。
+     * スイッチの状態はPANEL_DEBOUNCE_US以上変化しなかった場合に確定する。
+     */
+    bool Update(uint32_t now);
+
+    /**
+     * @brief MIDI入力の処理待ちの有無を通知する
+     * @param pending true:MIDI入力の処理待ちがある
      */
-    void Update();
+    void SetPending(bool pending) { bPending = pending; }
 
     /**
      * @brief LEDの表示データをセットする
      * @param led 16bitのビットパターン(正論理)
-     * @details 次回のUpdate()の呼び出しでLEDに状態が反映される。
-     * Update()ごとに4bit分ずつ更新されるので、全データの表示には
-     * 4回のUpdate()の呼び出しが必要。
+     * @details 次回の走査でLEDに状態が反映される。
+     * 1回の走査ごとに4bit分ずつ更新されるので、全データの表示には
+     * 4回の走査(PANEL_SCAN_US * 4)が必要。
      */
     void SetLed(uint16_t led);
 
@@ -71,4 +99,19 @@ public:
      * @return 16bitのビットパターン(正論理) MSB:Ch16, LSB:Ch1
      */
     uint16_t GetMidiSwState();
+
+private:
+    /**
+     * @brief 1列分の走査
+     * @param now      現在時刻(us)
+     * @param debounce true:チャタリング除去を行う
+     */
+    void scan(uint32_t now, bool debounce);
+
+    /**
+     * @brief PAへの書き込み
+     * @param data 書き込む値(ビット反転前)
+     * @details 最後に書き込んだ値と同じ場合は書き込まない
+     */
+    void write_pa(uint8_t data);
 };
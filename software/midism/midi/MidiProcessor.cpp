@@ -10,21 +10,51 @@
 #include <cstdlib>
 #include <cstring>
 
-#include "Debugger.h"
+#include "CsmPhraseBank.h"
+#include "Latency.h"
+#include "Profile.h"
+#include "ToneBank.h"
+#include "Trace.h"
 #include "VoiceAllocator.h"
+#include "hardware/timer.h"
 
 // Debug
 #define DUMP_MESSAGE           0
 #define MIDIMSG_TIMING_CLOCK   0
 #define MIDIMSG_ACTIVE_SENSING 0
 
-MidiProcessor::MidiProcessor(std::array<MidiChannel*, MIDI_CHANNELS>& channels)
+ResetTime MidiProcessor::reset_time = {};
+
+MidiProcessor::MidiProcessor(std::array<MidiChannel*, MIDI_CHANNELS>& channels, int source)
     : channels(channels),
+      cable(channels[0]->GetNumber() / MIDI_CHANNELS),
       enabled_channels(0xffff),
       note_on_status(0),
-      status_byte(0),
-      isSysEx(false),
-      q_index(0) {
+      status_byte(0) {
+    // System Exclusive messageのハンドラ登録
+    sysex.Register(GM_SYSTEM_ON, sizeof(GM_SYSTEM_ON), this, SYSEX_RESET, true);
+    sysex.Register(XG_RESET, sizeof(XG_RESET), this, SYSEX_RESET, true);
+    sysex.Register(GS_RESET, sizeof(GS_RESET), this, SYSEX_RESET, true);
+
+    // 音色バンクのアップロード
+    ToneBank& bank = ToneBank::GetInstance();
+    sysex.Register(ToneBank::DUMP_ID, sizeof(ToneBank::DUMP_ID), &bank,
+                   sysex_tag(source, ToneBank::TONE_DUMP));
+    sysex.Register(ToneBank::STORE_ID, sizeof(ToneBank::STORE_ID), &bank,
+                   sysex_tag(source, ToneBank::TONE_STORE), true);
+    sysex.Register(ToneBank::CLEAR_ID, sizeof(ToneBank::CLEAR_ID), &bank,
+                   sysex_tag(source, ToneBank::TONE_CLEAR));
+
+#if ENABLE_CSM != 0
+    // CSMフレーズバンクのアップロード
+    CsmPhraseBank& phrase = CsmPhraseBank::GetInstance();
+    sysex.Register(CsmPhraseBank::DUMP_ID, sizeof(CsmPhraseBank::DUMP_ID), &phrase,
+                   sysex_tag(source, CsmPhraseBank::PHRASE_DUMP));
+    sysex.Register(CsmPhraseBank::STORE_ID, sizeof(CsmPhraseBank::STORE_ID), &phrase,
+                   sysex_tag(source, CsmPhraseBank::PHRASE_STORE), true);
+    sysex.Register(CsmPhraseBank::CLEAR_ID, sizeof(CsmPhraseBank::CLEAR_ID), &phrase,
+                   sysex_tag(source, CsmPhraseBank::PHRASE_CLEAR));
+#endif
 }
 
 MidiProcessor::~MidiProcessor() {
@@ -35,9 +65,36 @@ void MidiProcessor::EnableChannels(uint16_t states) {
 }
 
 void MidiProcessor::Reset() {
+    uint32_t start = time_us_32();
+
+    // ケーブルのVoicesリセット(MIDI Channelより先に行う)
+    VoiceAllocator::GetInstance().Reset(cable);
+    reset_channels();
+    record_reset(start);
+}
+
+void MidiProcessor::ResetAll(MidiProcessor* const processors[], int num) {
+    uint32_t start = time_us_32();
+
     // 全Voicesリセット(MIDI Channelより先に行う)
     VoiceAllocator::GetInstance().Reset();
 
+    for (int i = 0; i < num; i++) {
+        // MIDIチャンネルを共有する入力元(DIN MIDI)は1回だけリセットする
+        bool shared = false;
+        for (int j = 0; j < i; j++) {
+            shared = shared || (&processors[j]->channels == &processors[i]->channels);
+        }
+        if (shared) {
+            processors[i]->note_on_status = 0;
+        } else {
+            processors[i]->reset_channels();
+        }
+    }
+    record_reset(start);
+}
+
+void MidiProcessor::reset_channels() {
     // 全MIDI Channelsリセット
     for (auto& channel : channels) {
         channel->Reset();
@@ -47,78 +104,64 @@ void MidiProcessor::Reset() {
     note_on_status = 0;
 }
 
+void MidiProcessor::record_reset(uint32_t start) {
+    // 次のMIDIメッセージを処理できるまでの時間
+    uint32_t elapsed = time_us_32() - start;
+    ++reset_time.count;
+    reset_time.last_us = elapsed;
+    if (elapsed > reset_time.max_us) {
+        reset_time.max_us = elapsed;
+    }
+}
+
+bool MidiProcessor::RegisterSysEx(const uint8_t* id, int length, SysExHandler* handler, int tag) {
+    return sysex.Register(id, length, handler, tag);
+}
+
 // System Exclusive messageの処理
-void MidiProcessor::process_sysex_msg(int length) {
-    if (length <= 0) {
+void MidiProcessor::SysExEnd(int tag, bool complete) {
+    if (!complete) {
         return;
     }
 
-    if (memcmp(GM_SYSTEM_ON, msg_queue, length) == 0 || memcmp(XG_RESET, msg_queue, length) == 0 ||
-        memcmp(GS_RESET, msg_queue, length) == 0) {
+    switch (tag) {
+    case SYSEX_RESET:
         // MIDIリセット
         Reset();
-    } else if (msg_queue[0] == 0x00) {
-        // デバッグ用ダンプ
-        if (msg_queue[1] == 0x00) {
-            for (auto& ch : channels) {
-                ch->dump();   // Channel Parameters
-                ch->stats();  // Voice release statistics
-            }
-        }
-        // Voice allocation statistics
-        printf("Voice allocation failure: %d\n", VoiceAllocator::GetInstance().GetFailedCount());
-        VoiceAllocator::GetInstance().dump();  // Voice parameters
-    }
-}
-
-bool MidiProcessor::push(uint8_t msg) {
-    if (msg == 0xf0) {
-        q_index = 0;
-        isSysEx = true;
-    } else if (msg == 0xf7) {
-        process_sysex_msg(q_index - 1);
-        isSysEx = false;
-    } else if (isSysEx) {
-        if (q_index < sizeof(msg_queue)) {
-            msg_queue[q_index++] = msg;
-        }
+        break;
+    default:
+        break;
     }
-    return isSysEx;
 }
 
 //
 //  MIDI messageのパースと実行
 //
 uint16_t MidiProcessor::Exec(uint8_t msg[3], int num) {
+    PROFILE_SCOPE(EXEC);
 #if DUMP_MESSAGE
     dump_message(msg, num);
-    DPRINTF(1, " | ");
 #endif
-    if (isSysEx) {
+    if ((sysex.IsActive() || msg[0] == 0xf0) && sysex.Push(msg[0])) {
         // System exclusive message
-        DPRINTF(1, "      |      : ");
-        for (int i = 0; i < 3; i++) {
-            DPRINTF(1, "%02x ", msg[i]);
-            if ((isSysEx = push(msg[i])) == false) {
-                break;
-            }
+        // (受信中に他のステータスバイトが来た場合はSysExを中断し、以下で通常のメッセージとして処理する)
+        TRACE(SYSEX, msg[0], num > 1 ? msg[1] : 0, num > 2 ? msg[2] : 0);
+        for (int i = 1; i < num && sysex.IsActive(); i++) {
+            sysex.Push(msg[i]);
         }
-        DPRINTF(1, "\n");
+        return note_on_status;
+    }
+
+    if (msg[0] & 0x80) {
+        // Channel Voice Message
+        status_byte = msg[0];
     } else {
-        if (msg[0] & 0x80) {
-            // Channel Voice Message
-            status_byte = msg[0];
-            for (int i = 0; i < num; i++) {
-                isSysEx = push(msg[i]);
-            }
-        } else {
-            // running status
-            msg[1] = msg[0];
-            msg[2] = msg[1];
-            msg[0] = status_byte;
-        }
-        process_event(msg);
+        // running status
+        msg[2] = msg[1];
+        msg[1] = msg[0];
+        msg[0] = status_byte;
     }
+    process_event(msg);
     return note_on_status;
 }
 
@@ -134,14 +177,7 @@ void MidiProcessor::dump_message(const uint8_t msg[3], int num) {
     if (msg[0] == 0xfe) return;
 #endif
 
-    int i;
-    for (i = 0; i < num; i++) {
-        DPRINTF(1, "%02x", msg[i]);
-    }
-    for (; i < 3; i++) {
-        DPRINTF(1, "--");
-    }
-    DPRINTF(1, " |");
+    TRACE(MIDI_IN, msg[0], num > 1 ? msg[1] : 0, num > 2 ? msg[2] : 0);
 }
 #endif
 
@@ -156,12 +192,10 @@ void MidiProcessor::process_event(const uint8_t msg[3]) {
         return;
     }
     MidiChannel* channel = channels[ch];
+    LATENCY_DISPATCH(msg);
 
     int16_t val;
     int ev = (msg[0] >> 4) & 0xf;
-    if (ev != 0xf) {
-        DPRINTF(1, "CH:%02d | ", ch);
-    }
 
     switch (ev) {
     case NOTE_ON:
@@ -173,18 +207,18 @@ void MidiProcessor::process_event(const uint8_t msg[3]) {
             // NoteOff or NoteOn失敗
             note_on_status &= ~mask;
         }
-        DPRINTF(1, "ON : k=%3d v=%3d", msg[1], msg[2]);
+        TRACE(NOTE_ON, ch, msg[1], msg[2]);
         break;
     case NOTE_OFF:
         if (channel->NoteOff(msg[1]) != 1) {
             // NoteOffした
             note_on_status &= ~mask;
         }
-        DPRINTF(1, "OFF: k=%d v=%d", msg[1], msg[2]);
+        TRACE(NOTE_OFF, ch, msg[1], msg[2]);
         break;
     case PROGRAM_CHANGE:
         channel->SetProgram(msg[1]);
-        DPRINTF(1, "PROG: %d", msg[1]);
+        TRACE(PROGRAM, ch, msg[1]);
         break;
     case CONTROL_CHANGE:
         switch (msg[1]) {
@@ -230,51 +264,35 @@ void MidiProcessor::process_event(const uint8_t msg[3]) {
             channel->Reset();
             break;
         }
-        DPRINTF(3, "CC: #%d/%d", msg[1], msg[2]);
+        TRACE(CONTROL, ch, msg[1], msg[2]);
         break;
     case KEY_AFTER_TOUCH:
-        DPRINTF(3, "PolyPress: key=%d velocity=%d", msg[1], msg[2]);
+        TRACE(POLY_PRESS, ch, msg[1], msg[2]);
         break;
     case CH_AFTER_TOUCH:
-        DPRINTF(3, "ChPress: %d", msg[1]);
+        TRACE(CH_PRESS, ch, msg[1]);
         break;
     case PITCH_BEND:
         val = msg[1] + 128 * msg[2] - 8192;
         channel->PitchBend(val);
-        DPRINTF(3, "PB: %d", val);
+        TRACE(PITCH_BEND, ch, val);
         break;
     case SYSTEM_EXCLUSIVE:
-        if (ch == 0) {
-            DPRINTF(3, "System| SysEx: %02x %02x %02x\n", msg[0], msg[1], msg[2]);
-        } else if (ch == 1) {
-            DPRINTF(3, "System| MIDI TC: %d\n", msg[1]);
-        } else if (ch == 2) {
-            DPRINTF(3, "System| SongPos: %d\n", msg[1] + 128 * msg[2]);
-        } else if (ch == 3) {
-            DPRINTF(3, "System| SongSelect: %d\n", msg[1]);
-        } else if (ch == 6) {
-            DPRINTF(3, "System| TuneReqest\n");
-        } else if (ch == 8) {
+        // System Common / System Realtime
+        if (ch == 8) {
 #if MIDIMSG_TIMING_CLOCK
-            DPRINTF(4, "System| TimingClock\n");
+            TRACE(REALTIME, msg[0]);
 #endif
-        } else if (ch == 10) {
-            DPRINTF(3, "System| START\n");
-        } else if (ch == 11) {
-            DPRINTF(3, "System| CONTINUE\n");
-        } else if (ch == 12) {
-            DPRINTF(3, "System| STOP\n");
         } else if (ch == 14) {
 #if MIDIMSG_ACTIVE_SENSING
-            DPRINTF(4, "System| ActiveSensing\n");
+            TRACE(REALTIME, msg[0]);
 #endif
-        } else if (ch == 15) {
-            DPRINTF(3, "System| RESET\n");
+        } else {
+            TRACE(SYSTEM, msg[0], msg[1], msg[2]);
         }
         return;
     default:
         break;
     }
-    DPRINTF(1, "\n");
     return;
 }
@@ -8,13 +8,24 @@
 #include <array>
 
 #include "MidiFactory.h"
+#include "SysExParser.h"
+
+/**
+ * @brief MIDIリセットの処理時間(統計用)
+ */
+struct ResetTime {
+    uint32_t count;    // MIDIリセットの回数
+    uint32_t last_us;  // 最後のMIDIリセットの処理時間(us)
+    uint32_t max_us;   // MIDIリセットの最大処理時間(us)
+};
 
 /**
  * @brief MidiProcessor class
  */
-class MidiProcessor {
+class MidiProcessor : public SysExHandler {
 private:
     std::array<MidiChannel*, MIDI_CHANNELS>& channels;
+    int cable;  // channelsのケーブル番号
 
     enum MIDI_MESSAGE {
         NOTE_OFF         = 0x8,
@@ -32,16 +43,17 @@ private:
     uint8_t status_byte;        // ステータスバイトの保持用
 
     // System Exclusive message
-    bool isSysEx;
-    int q_index;            // index of msg_queue
-    uint8_t msg_queue[10];  // data buffer between 0xf0 and 0xf7.
+    SysExParser sysex;
+
+    static ResetTime reset_time;  // DEBUG: MIDIリセットの処理時間(全MidiProcessor)
 
 public:
     /**
      * @brief コンストラクタ
      * @param channels MIDIチャンネルの配列
+     * @param source   入力元の番号(共有するSysExのハンドラで入力元を区別する)
      */
-    MidiProcessor(std::array<MidiChannel*, MIDI_CHANNELS>& channels);
+    MidiProcessor(std::array<MidiChannel*, MIDI_CHANNELS>& channels, int source);
     MidiProcessor() = delete;
     ~MidiProcessor();
 
@@ -58,21 +70,56 @@ public:
     uint16_t Exec(uint8_t msg[3], int num);
 
     /**
-     * @brief MIDIチャンネルのリセット
+     * @brief MIDIチャンネルのリセット(GM/GS/XGリセット)
+     * @details このMidiProcessorのケーブルのMIDIチャンネルと、それらに割り当てたVoiceだけを
+     *          リセットする。他のケーブルの発音は止めない。音色は次のNoteOnで設定する。
      */
     void Reset();
 
+    /**
+     * @brief 全MIDIチャンネルのリセット(MIDIパネル、デバッガ)
+     * @param processors 全入力元のMidiProcessor
+     * @param num        processorsの数
+     * @details 全Voiceを1回だけリセットしてから、各MidiProcessorのMIDIチャンネルをリセットする。
+     *          処理時間は1回のリセットとして記録する。
+     */
+    static void ResetAll(MidiProcessor* const processors[], int num);
+
+    /**
+     * @brief MIDIリセットの処理時間を取得する
+     * @return MIDIリセットの処理時間
+     */
+    static const ResetTime& GetResetTime() { return reset_time; }
+
+    /**
+     * @brief System Exclusive messageのハンドラを追加登録する
+     * @param id      $F0に続くメーカーID/サブID
+     * @param length  idのバイト数
+     * @param handler ハンドラ
+     * @param tag     ハンドラに渡すタグ
+     * @return false:登録できなかった
+     */
+    bool RegisterSysEx(const uint8_t* id, int length, SysExHandler* handler, int tag = 0);
+
+    /**
+     * @brief System Exclusive messageの受信終了(SysExHandler)
+     * @details GM/GS/XGリセットを処理する
+     */
+    void SysExEnd(int tag, bool complete) override;
+
 private:
+    void reset_channels();
+    static void record_reset(uint32_t start);
     void process_event(const uint8_t msg[3]);
     void dump_message(const uint8_t msg[3], int num);
-    void process_sysex_msg(int length);
-    bool push(uint8_t msg);
 
     //
     //  System Exclusive message handling
     //
+    enum SysExTag {
+        SYSEX_RESET,  // GM/GS/XGリセット
+    };
     static constexpr uint8_t GM_SYSTEM_ON[] = {0x7e, 0x7f, 0x09, 0x01};
     static constexpr uint8_t XG_RESET[]     = {0x43, 0x10, 0x4c, 0x00, 0x00, 0x7e, 0x00};
     static constexpr uint8_t GS_RESET[] = {0x41, 0x10, 0x42, 0x12, 0x40, 0x00, 0x7f, 0x00, 0x41};
-    static constexpr uint8_t DEBUG_1[]  = {0x00, 0x00};  // デバック用独自定義
 };
@@ -0,0 +1,87 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#include "MidiStreamParser.h"
+
+MidiStreamParser::MidiStreamParser() {
+    Reset();
+}
+
+void MidiStreamParser::Reset() {
+    status   = 0;
+    count    = 0;
+    expected = 0;
+    sysex    = false;
+}
+
+int MidiStreamParser::emit(uint8_t out[3]) {
+    int num = count;
+    for (int i = 0; i < num; i++) {
+        out[i] = msg[i];
+    }
+    count = 0;
+    return num;
+}
+
+int MidiStreamParser::Push(uint8_t data, uint8_t out[3]) {
+    if (data >= 0xf8) {
+        // リアルタイムメッセージは受信中の状態に影響を与えない
+        out[0] = data;
+        return 1;
+    }
+
+    if (data & 0x80) {
+        if (data == 0xf7) {
+            // System Exclusiveの終了
+            if (!sysex) {
+                return 0;
+            }
+            sysex        = false;
+            msg[count++] = data;
+            return emit(out);
+        }
+
+        // 受信途中のメッセージは破棄する
+        // (SysExの途中の場合、MidiProcessor側で新しいステータスバイトにより中断される)
+        sysex  = false;
+        count  = 0;
+        msg[0] = data;
+        if (data == 0xf0) {
+            // System Exclusiveの開始
+            status = 0;
+            sysex  = true;
+            count  = 1;
+            return 0;
+        }
+        if (data >= 0xf0) {
+            // System Common Messageはランニングステータスを解除する
+            status   = 0;
+            expected = (data == 0xf2) ? 3 : (data == 0xf1 || data == 0xf3) ? 2 : 1;
+        } else {
+            status   = data;
+            expected = ((data & 0xe0) == 0xc0) ? 2 : 3;  // Program Change, Ch Pressureは2バイト
+        }
+        count = 1;
+        return (count == expected) ? emit(out) : 0;
+    }
+
+    // データバイト
+    if (sysex) {
+        msg[count++] = data;
+        return (count == 3) ? emit(out) : 0;
+    }
+    if (count == 0) {
+        if (status == 0) {
+            return 0;  // ステータスバイト未受信なので読み捨て
+        }
+        // ランニングステータス
+        msg[0]   = status;
+        expected = ((status & 0xe0) == 0xc0) ? 2 : 3;
+        count    = 1;
+    }
+    msg[count++] = data;
+    return (count == expected) ? emit(out) : 0;
+}
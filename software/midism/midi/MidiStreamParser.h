@@ -0,0 +1,46 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include <cstdint>
+
+/**
+ * @brief MIDIバイトストリームのパーサ
+ * @details
+ * DIN MIDIのようにバイト単位で届くストリームを、MidiProcessor::Exec()に渡せる
+ * 1-3バイトのメッセージに区切る。入力元ごとにインスタンスを用意することで、
+ * ランニングステータスを入力元ごとに保持する。
+ * - チャンネルメッセージは、ランニングステータスを補完して常にステータスバイト付きで出力する。
+ * - System Exclusiveは、$F0から$F7までを最大3バイトずつに区切って出力する。
+ * - リアルタイムメッセージ($F8-$FF)は、他のメッセージの途中でも1バイトで出力する。
+ */
+class MidiStreamParser {
+private:
+    uint8_t status;    // ランニングステータス (0:なし)
+    uint8_t msg[3];    // 受信中のメッセージ
+    uint8_t count;     // 受信済みのバイト数
+    uint8_t expected;  // メッセージ長
+    bool sysex;        // System Exclusive受信中
+
+public:
+    MidiStreamParser();
+
+    /**
+     * @brief 内部状態をリセットする
+     */
+    void Reset();
+
+    /**
+     * @brief 1バイト分の入力
+     * @param data 受信データ
+     * @param [out] out 完成したメッセージ
+     * @return outに格納したバイト数 (0:メッセージ未完成)
+     */
+    int Push(uint8_t data, uint8_t out[3]);
+
+private:
+    int emit(uint8_t out[3]);
+};
@@ -0,0 +1,122 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include <cstdint>
+
+/**
+ * @brief 固定長リングバッファ
+ * @tparam T 要素の型
+ * @tparam N 要素数(2のべき乗)
+ * @details 動的メモリ確保は行わない。
+ * head/tailは単調増加させ、参照時にN-1でマスクする。
+ */
+template <typename T, int N>
+class RingBuffer {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of 2");
+
+private:
+    T buffer[N];
+    uint32_t head;  // 書き込み位置
+    uint32_t tail;  // 読み出し位置
+
+public:
+    RingBuffer() : head(0), tail(0) {}
+
+    /**
+     * @brief バッファを空にする
+     */
+    void Clear() { head = tail = 0; }
+
+    /**
+     * @brief 格納されている要素数を返す
+     */
+    int Count() const { return (int)(head - tail); }
+
+    /**
+     * @brief バッファの容量を返す
+     */
+    static constexpr int Capacity() { return N; }
+
+    bool IsEmpty() const { return head == tail; }
+    bool IsFull() const { return Count() == N; }
+
+    /**
+     * @brief 末尾に要素を追加する
+     * @return false: バッファフル
+     */
+    bool Push(const T& data) {
+        if (IsFull()) {
+            return false;
+        }
+        buffer[head++ & (N - 1)] = data;
+        return true;
+    }
+
+    /**
+     * @brief 先頭の要素を取り出す
+     * @return false: バッファが空
+     */
+    bool Pop(T& data) {
+        if (IsEmpty()) {
+            return false;
+        }
+        data = buffer[tail++ & (N - 1)];
+        return true;
+    }
+
+    /**
+     * @brief 先頭からi番目の要素を参照する
+     * @param i インデックス (0 - Count()-1)
+     */
+    const T& Peek(int i) const { return buffer[(tail + i) & (N - 1)]; }
+
+    /**
+     * @brief 先頭から連続してアクセスできる領域を返す
+     * @param [out] len 連続した要素数
+     * @return 先頭要素へのポインタ
+     * @details バッファ終端で折り返している場合、lenはCount()より小さくなる
+     */
+    const T* Front(int& len) const {
+        uint32_t pos = tail & (N - 1);
+        len          = Count();
+        if (len > (int)(N - pos)) {
+            len = N - pos;
+        }
+        return &buffer[pos];
+    }
+
+    /**
+     * @brief 格納されている要素がバッファ先頭から連続するように並べ替える
+     * @details Front()で全要素を一度に参照したい場合に使用する
+     */
+    void Linearize() {
+        uint32_t pos = tail & (N - 1);
+        if (pos == 0) {
+            return;
+        }
+        T tmp[N];
+        int n = Count();
+        for (int i = 0; i < n; i++) {
+            tmp[i] = buffer[(pos + i) & (N - 1)];
+        }
+        for (int i = 0; i < n; i++) {
+            buffer[i] = tmp[i];
+        }
+        tail = 0;
+        head = n;
+    }
+
+    /**
+     * @brief 先頭からn個の要素を破棄する
+     */
+    void Drop(int n) {
+        if (n > Count()) {
+            n = Count();
+        }
+        tail += n;
+    }
+};
@@ -0,0 +1,64 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * @brief シーケンスロックによるデータの受け渡し
+ * @details
+ * 書き込み側(1つのコアに限る)は待たずに書き込み、読み出し側は書き込み中でなかったことを
+ * シーケンス番号で確認してコピーを取る。書き込みと重なった場合は読み出しをやり直す。
+ * 書き込み側はロックを取らないので、読み出し側の処理で書き込み側が止まることはない。
+ */
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+private:
+    std::atomic<uint32_t> seq;  // シーケンス番号(奇数:書き込み中)
+    T data;                     // 受け渡すデータ
+
+public:
+    SeqLock() : seq(0), data{} {}
+
+    /**
+     * @brief データを書き込む
+     * @param func 書き込む関数 void(T&)
+     */
+    template <typename Func>
+    void Write(Func&& func) {
+        uint32_t s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        func(data);
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+    /**
+     * @brief データのコピーを取る
+     * @param out コピー先
+     * @return true:成功, false:書き込みと重なった(やり直すこと)
+     */
+    bool TryRead(T& out) const {
+        uint32_t s = seq.load(std::memory_order_acquire);
+        if (s & 1) {
+            return false;
+        }
+        memcpy(&out, &data, sizeof(T));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return seq.load(std::memory_order_relaxed) == s;
+    }
+
+    /**
+     * @brief シーケンス番号を返す
+     * @details 書き込みごとに2ずつ増える。新しいデータが書き込まれたかどうかの判定に使う
+     */
+    uint32_t GetSequence() const { return seq.load(std::memory_order_acquire); }
+};
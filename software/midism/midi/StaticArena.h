@@ -0,0 +1,69 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include <cstdint>
+#include <new>
+#include <utility>
+
+#include "pico/stdlib.h"
+
+/**
+ * @brief 静的な領域へのオブジェクトの生成
+ * @tparam T 生成するクラス
+ * @tparam N 生成できる最大数(0の場合、Create()は常にpanicする)
+ * @details
+ * N個分の領域を静的に確保しておき、Create()で先頭から順にコンストラクタを呼び出す。
+ * ヒープを使わないので、使用するRAMの大きさはリンク時に決まる。
+ * 生成したオブジェクトは個別には破棄せず、Clear()でまとめて破棄する(デストラクタでは破棄しない)。
+ */
+template <typename T, int N>
+class StaticArena {
+    static_assert(N >= 0, "N must not be negative");
+
+private:
+    alignas(T) uint8_t storage[N > 0 ? N : 1][sizeof(T)];  // オブジェクトの領域
+    int count;                                             // 生成したオブジェクトの数
+
+public:
+    constexpr StaticArena() : storage{}, count(0) {}
+    StaticArena(const StaticArena&)            = delete;
+    StaticArena& operator=(const StaticArena&) = delete;
+
+    /**
+     * @brief オブジェクトを生成する
+     * @param args コンストラクタの引数
+     * @return 生成したオブジェクトへのポインタ
+     * @details 最大数を超えた場合はpanicする(最大数はDockの構成から決めること)
+     */
+    template <typename... Args>
+    T* Create(Args&&... args) {
+        if (count >= N) {
+            panic("StaticArena: capacity %d exceeded", N);
+        }
+        return new (storage[count++]) T(std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief 生成したオブジェクトをすべて破棄する
+     * @details 生成と逆の順に破棄する
+     */
+    void Clear() {
+        while (count > 0) {
+            std::launder(reinterpret_cast<T*>(storage[--count]))->~T();
+        }
+    }
+
+    /**
+     * @brief 生成したオブジェクトの数を返す
+     */
+    int Count() const { return count; }
+
+    /**
+     * @brief 生成できる最大数を返す
+     */
+    static constexpr int Capacity() { return N; }
+};
@@ -0,0 +1,193 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#include "SysExParser.h"
+
+#include <cstring>
+
+SysExParser::SysExParser()
+    : num_entries(0),
+      state(State::IDLE),
+      candidates(0),
+      matched(-1),
+      pos(0),
+      current(nullptr) {
+}
+
+SysExParser::~SysExParser() {
+}
+
+bool SysExParser::Register(const uint8_t* id, int length, SysExHandler* handler, int tag,
+                           bool exact) {
+    if (num_entries >= MAX_HANDLERS || length <= 0 || length > MAX_ID_LENGTH ||
+        handler == nullptr) {
+        return false;
+    }
+    Entry& e = entries[num_entries++];
+    memcpy(e.id, id, length);
+    e.length  = length;
+    e.exact   = exact;
+    e.tag     = tag;
+    e.handler = handler;
+    return true;
+}
+
+bool SysExParser::IsActive() {
+    return state != State::IDLE;
+}
+
+void SysExParser::Abort() {
+    if (state != State::IDLE) {
+        finish(false);
+    }
+}
+
+bool SysExParser::Push(uint8_t data) {
+    if (data >= 0xf8) {
+        // リアルタイムメッセージはSysExの途中にも挿入されるので読み飛ばす
+        return IsActive();
+    }
+    if (data == 0xf0) {
+        // 受信中のメッセージがあれば中断して、新しいメッセージを開始する
+        Abort();
+        buffer.Clear();
+        candidates = (num_entries >= 32) ? 0xffffffff : (1u << num_entries) - 1;
+        matched    = -1;
+        pos        = 0;
+        current    = nullptr;
+        state      = State::MATCHING;
+        return true;
+    }
+    if (state == State::IDLE) {
+        return false;
+    }
+    if (data == 0xf7) {
+        finish(true);
+        return true;
+    }
+    if (data & 0x80) {
+        // $F7以外のステータスバイトなのでSysExを中断
+        finish(false);
+        return false;
+    }
+
+    switch (state) {
+    case State::MATCHING:
+        match(data);
+        break;
+    case State::STREAMING:
+        if (current->exact) {
+            // データ部を持たないはずのメッセージ
+            discard();
+            break;
+        }
+        if (buffer.IsFull()) {
+            // ハンドラに消費させて空きを作る
+            flush();
+            if (buffer.IsFull()) {
+                // ハンドラが消費しないのでバッファ溢れ
+                discard();
+                break;
+            }
+        }
+        buffer.Push(data);
+        if (buffer.Count() >= CHUNK_SIZE) {
+            flush();
+        }
+        break;
+    default:
+        // DISCARD
+        break;
+    }
+    return true;
+}
+
+void SysExParser::match(uint8_t data) {
+    // 照合中のバイトもバッファに保持しておく
+    // (最長一致のエントリのID長を超えた分はデータ部として扱う)
+    buffer.Push(data);
+
+    uint32_t next = 0;
+    for (int i = 0; i < num_entries; i++) {
+        if ((candidates >> i) & 1) {
+            const Entry& e = entries[i];
+            if (e.id[pos] == data) {
+                if (e.length == pos + 1) {
+                    // IDの全体が一致した(同じ長さなら先に登録したものを優先)
+                    if (matched < 0 || entries[matched].length < e.length) {
+                        matched = i;
+                    }
+                } else {
+                    // まだ照合を継続するエントリ
+                    next |= 1u << i;
+                }
+            }
+        }
+    }
+    ++pos;
+    candidates = next;
+
+    if (candidates == 0) {
+        // より長いIDの候補がなくなったので確定
+        select();
+    }
+}
+
+void SysExParser::select() {
+    if (matched < 0) {
+        // 該当するハンドラなし
+        buffer.Clear();
+        state = State::DISCARD;
+        return;
+    }
+    current = &entries[matched];
+    buffer.Drop(current->length);  // ID部分を破棄し、残りをデータ部とする
+    state = State::STREAMING;
+    current->handler->SysExBegin(current->tag);
+    if (current->exact && !buffer.IsEmpty()) {
+        discard();
+    }
+}
+
+void SysExParser::flush() {
+    if (buffer.IsEmpty()) {
+        return;
+    }
+    int len;
+    const uint8_t* data = buffer.Front(len);
+    if (len < buffer.Count()) {
+        // 折り返している場合は連続領域に並べ替えてから渡す
+        buffer.Linearize();
+        data = buffer.Front(len);
+    }
+    int n = current->handler->SysExData(current->tag, data, len);
+    if (n > 0) {
+        buffer.Drop(n);
+    }
+}
+
+void SysExParser::discard() {
+    current->handler->SysExEnd(current->tag, false);
+    current = nullptr;
+    buffer.Clear();
+    state = State::DISCARD;
+}
+
+void SysExParser::finish(bool complete) {
+    if (state == State::MATCHING) {
+        // ID照合中に終了したので、それまでの最長一致で確定させる
+        select();
+    }
+    if (state == State::STREAMING) {
+        if (complete) {
+            flush();
+        }
+        current->handler->SysExEnd(current->tag, complete);
+    }
+    current = nullptr;
+    buffer.Clear();
+    state = State::IDLE;
+}
@@ -0,0 +1,187 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include <cstdint>
+
+#include "RingBuffer.h"
+
+/**
+ * @brief System Exclusive messageのハンドラインターフェース
+ * @details SysExParserに登録し、IDが一致したメッセージのデータ部を逐次受け取る。
+ */
+class SysExHandler {
+public:
+    /**
+     * @brief IDが一致したメッセージの受信開始
+     * @param tag 登録時に指定したタグ
+     */
+    virtual void SysExBegin(int /*tag*/) {}
+
+    /**
+     * @brief データ部の受信
+     * @param tag  登録時に指定したタグ
+     * @param data データ部(IDの直後から。$F0/$F7は含まない)
+     * @param len  dataのバイト数
+     * @return 消費したバイト数
+     * @details len未満を返した場合、残りはバッファに保持され、後続のデータとともに再度渡される。
+     *          レコード単位で処理するハンドラは、端数を残して返せばよい。
+     */
+    virtual int SysExData(int /*tag*/, const uint8_t* /*data*/, int len) { return len; }
+
+    /**
+     * @brief メッセージの受信終了
+     * @param tag      登録時に指定したタグ
+     * @param complete true:$F7で正常に終了, false:中断(バッファ溢れ、不正なステータスなど)
+     */
+    virtual void SysExEnd(int tag, bool complete) = 0;
+};
+
+/**
+ * @brief 複数の入力元のSysExParserに登録するハンドラのタグ
+ * @param source 入力元の番号
+ * @param value  ハンドラが使う値(コマンドなど, 0-255)
+ * @return タグ
+ */
+constexpr int sysex_tag(int source, int value) {
+    return (source << 8) | value;
+}
+constexpr int sysex_tag_source(int tag) {
+    return tag >> 8;
+}
+constexpr int sysex_tag_value(int tag) {
+    return tag & 0xff;
+}
+
+/**
+ * @brief 受信状態を1つしか持たないハンドラの受信権
+ * @details
+ * 入力元ごとのSysExParserは独立して動作するので、同じハンドラへのメッセージが
+ * 入力元をまたいで交互に届くことがある。受信中の入力元を記録し、それ以外の入力元からの
+ * メッセージは$F7まで無視させる。
+ */
+class SysExOwner {
+private:
+    int owner = -1;  // 受信中の入力元 (-1:なし)
+
+public:
+    /**
+     * @brief 受信権を取得する(SysExBegin()で呼び出す)
+     * @param tag sysex_tag()で生成したタグ
+     * @return false:他の入力元が受信中
+     */
+    bool Acquire(int tag) {
+        if (owner >= 0 && owner != sysex_tag_source(tag)) {
+            return false;
+        }
+        owner = sysex_tag_source(tag);
+        return true;
+    }
+
+    /**
+     * @brief 受信権を持っているか
+     * @param tag sysex_tag()で生成したタグ
+     */
+    bool Owns(int tag) const { return owner == sysex_tag_source(tag); }
+
+    /**
+     * @brief 受信権を解放する(SysExEnd()で呼び出す)
+     * @param tag sysex_tag()で生成したタグ
+     * @return false:受信権を持っていなかった(このメッセージは無視する)
+     */
+    bool Release(int tag) {
+        if (!Owns(tag)) {
+            return false;
+        }
+        owner = -1;
+        return true;
+    }
+};
+
+/**
+ * @brief System Exclusive messageのストリーミングパーサ
+ * @details
+ * 受信したバイトを固定長のリングバッファに蓄積し、登録されたハンドラに逐次渡す。
+ * メッセージ長に上限はなく、ハンドラがデータを消費する限り受信を継続できる。
+ * ハンドラの選択は、登録されたIDの前方一致オートマトンで行う。
+ * 複数のIDが前方一致する場合は、最長一致したものを選択する。
+ */
+class SysExParser {
+public:
+    static constexpr int MAX_HANDLERS  = 16;   // 登録可能なハンドラ数
+    static constexpr int MAX_ID_LENGTH = 12;   // IDの最大長
+    static constexpr int BUFFER_SIZE   = 128;  // 受信バッファサイズ(2のべき乗)
+    static constexpr int CHUNK_SIZE    = 32;   // ハンドラにデータを渡す単位
+
+private:
+    struct Entry {
+        uint8_t id[MAX_ID_LENGTH];  // メーカーID/サブID
+        int length;                 // IDの長さ
+        bool exact;                 // true:データ部を持たないメッセージ
+        int tag;                    // ハンドラに渡すタグ
+        SysExHandler* handler;
+    };
+    Entry entries[MAX_HANDLERS];
+    int num_entries;
+
+    enum class State {
+        IDLE,       // SysEx受信中ではない
+        MATCHING,   // ID照合中
+        STREAMING,  // ハンドラにデータを転送中
+        DISCARD,    // 該当ハンドラなし、または中断したので$F7まで読み捨て
+    };
+    State state;
+
+    uint32_t candidates;  // 照合中のエントリのビットマップ
+    int matched;          // 最長一致したエントリ (-1:なし)
+    int pos;              // 照合済みのバイト数
+    Entry* current;       // 転送先のエントリ
+
+    RingBuffer<uint8_t, BUFFER_SIZE> buffer;
+
+public:
+    SysExParser();
+    ~SysExParser();
+
+    /**
+     * @brief ハンドラの登録
+     * @param id      $F0に続くメーカーID/サブID
+     * @param length  idのバイト数 (1 - MAX_ID_LENGTH)
+     * @param handler ハンドラ
+     * @param tag     ハンドラに渡すタグ
+     * @param exact   true:idのみで構成されるメッセージ(データ部があれば一致とみなさない)
+     * @return false:登録できなかった
+     * @details 起動時に登録すること。
+     */
+    bool Register(const uint8_t* id, int length, SysExHandler* handler, int tag = 0,
+                  bool exact = false);
+
+    /**
+     * @brief 1バイト分の入力
+     * @param data 受信データ
+     * @return true:SysExとして処理した, false:SysExと無関係なバイト
+     * @details 受信中に$F7以外のステータスバイトを受け取った場合は中断してfalseを返す。
+     *          リアルタイムメッセージ($F8-$FF)は無視する。
+     */
+    bool Push(uint8_t data);
+
+    /**
+     * @brief SysEx受信中かどうか
+     */
+    bool IsActive();
+
+    /**
+     * @brief 受信中のメッセージを中断する
+     */
+    void Abort();
+
+private:
+    void match(uint8_t data);
+    void select();
+    void flush();
+    void discard();
+    void finish(bool complete);
+};
@@ -117,12 +117,46 @@ void MidiChannel::BankSelect_LSB(uint8_t val) {
 }
 
 // Debug
-void MidiChannel::dump() {
-    printf("\nCH=%02d PG=%04x %04x VOL=%03d LR=%02x hold=%d ct=%2d pbs=%2d pbv=%5d\n", channel,
-           bk_program >> 16, bk_program & 0xffff, volume, outputLR, hold1, effect.coarse_tune,
-           effect.pbs, effect.pbv);
+void MidiChannel::snapshot(ChannelState& s) {
+    s.channel           = channel;
+    s.type              = "";
+    s.bk_program        = bk_program;
+    s.volume            = volume;
+    s.outputLR          = outputLR;
+    s.hold1             = hold1;
+    s.effect            = effect;
+    s.rel_success_count = rel_success_count;
+    s.rel_fail_count    = rel_fail_count;
+    for (int q = 0; q < ChannelState::QUEUES; q++) {
+        s.queue_len[q] = -1;
+        s.queue_max[q] = -1;
+    }
 }
 
-void MidiChannel::stats() {
-    printf("CH=%02d Release Success=%d Failure=%d\n", channel, rel_success_count, rel_fail_count);
+void MidiChannel::print(const ChannelState& s) {
+    printf("\nCH=%02d PG=%04x %04x VOL=%03d LR=%02x hold=%d ct=%2d pbs=%2d pbv=%5d\n", s.channel,
+           s.bk_program >> 16, s.bk_program & 0xffff, s.volume, s.outputLR, s.hold1,
+           s.effect.coarse_tune, s.effect.pbs, s.effect.pbv);
+    printf("  TYPE=%s\n", s.type);
+    static const char* const names[ChannelState::QUEUES] = {"activeQ", "  holdQ", "  freeQ"};
+    for (int q = 0; q < ChannelState::QUEUES; q++) {
+        if (s.queue_len[q] < 0) {
+            continue;
+        }
+        printf("  %s=%2d :", names[q], s.queue_len[q]);
+        for (int i = 0; i < s.queue_len[q] && i < MAX_VOICES; i++) {
+            printf(" %2d", s.queue[q][i]);
+        }
+        printf("\n");
+    }
+}
+
+void MidiChannel::print_stats(const ChannelState& s) {
+    printf("CH=%02d Release Success=%d Failure=%d", s.channel, s.rel_success_count,
+           s.rel_fail_count);
+    if (s.queue_max[ChannelState::ACTIVE] >= 0) {
+        printf(" Max activeQ=%d holdQ=%d", s.queue_max[ChannelState::ACTIVE],
+               s.queue_max[ChannelState::HOLD]);
+    }
+    putchar('\n');
 }
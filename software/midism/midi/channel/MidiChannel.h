@@ -9,6 +9,31 @@
 
 #include "Voice.h"
 
+/**
+ * @brief MIDI Channelの状態のスナップショット(デバッグ表示用)
+ * @details Core0で取得し、Core1で表示する。ポインタを含まないのでそのままコピーできる
+ */
+struct ChannelState {
+    enum Queue {
+        ACTIVE,  // NoteON状態
+        HOLD,    // NoteOFF待ち状態
+        FREE,    // 未使用状態
+        QUEUES,
+    };
+    int channel;                        // MIDI Channel No.
+    const char* type;                   // チャンネル種別(文字列リテラル)
+    int32_t bk_program;                 // Bank/Program No.
+    int volume;                         // Volume
+    uint8_t outputLR;                   // Output L/R
+    bool hold1;                         // CC#64 Hold1
+    VoiceEffect effect;                 // Coarse tune, PitchBend
+    int rel_success_count;              // Voice解放の成功回数
+    int rel_fail_count;                 // Voice解放の失敗回数
+    int queue_len[QUEUES];              // キューのVoice数(-1:キューを持たない)
+    int queue_max[QUEUES];              // キューのVoice数の最大値(-1:キューを持たない)
+    uint8_t queue[QUEUES][MAX_VOICES];  // キューのVoice ID
+};
+
 /**
  * @brief MidiChannel class
  */
@@ -175,6 +200,22 @@ public:
     virtual void SetPan(uint8_t val);
 
     // Debug
-    virtual void dump();
-    virtual void stats();
+    /**
+     * @brief 内部状態のスナップショットを取得する
+     * @param s 取得先
+     */
+    virtual void snapshot(ChannelState& s);
+
+    /**
+     * @brief スナップショットのパラメータを表示する
+     * @param s スナップショット
+     * @details チャンネルにアクセスしないので、スナップショットを取得したコア以外から呼び出せる
+     */
+    static void print(const ChannelState& s);
+
+    /**
+     * @brief スナップショットのVoice解放の統計を表示する
+     * @param s スナップショット
+     */
+    static void print_stats(const ChannelState& s);
 };
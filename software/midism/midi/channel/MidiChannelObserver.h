@@ -5,6 +5,7 @@
 // See LICENSE file for details.
 //
 #pragma once
+#include <cstdint>
 
 class Voice;
 
@@ -15,14 +16,25 @@ class MidiChannelObserver {
 public:
     /**
      * @brief チャンネルに割り当てられたVoiceのうち未使用のものを解放する
+     * @param mid   優先するmodule id
+     * @param type  Voice Type true:CsmVoice, false:NoteVoice
+     * @param docks 解放してよいNoteVoiceのDockのビットマップ
      * @return 割り当てできない場合はnullptrを返す
      */
-    virtual Voice* Release(int mid, bool type) = 0;
+    virtual Voice* Release(int mid, bool type, uint32_t docks) = 0;
 
     /**
      * @brief 割り当てられたVoiceをすべて解放する
      */
     virtual void ReleaseAll() = 0;
+
+    /**
+     * @brief 割り当てられたVoiceを強制的に外す
+     * @param voice 外すVoice
+     * @return true:発音中(NoteOn/Hold)だった
+     * @details CSM VoiceがCH3を使う際に、CH3のNoteVoiceを回収するために使う
+     */
+    virtual bool Revoke(Voice* voice) = 0;
 };
 
 struct ObserverInfo {
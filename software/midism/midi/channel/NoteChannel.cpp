@@ -6,10 +6,11 @@
 //
 #include "NoteChannel.h"
 
-#include "Debugger.h"
+#include "Profile.h"
+#include "Trace.h"
 #include "config.h"
 
-NoteChannel::NoteChannel(int no) : MidiChannel(no), bCsmVoiceMode(false) {
+NoteChannel::NoteChannel(int no) : MidiChannel(no), bCsmVoiceMode(false), queue_max{} {
     allocator = &VoiceAllocator::GetInstance();
 }
 
@@ -18,27 +19,38 @@ NoteChannel::~NoteChannel() {
 
 void NoteChannel::Reset() {
     Hold1(0);
-    for (auto& voice : activeQueue) {
+    for (auto* voice : activeQueue) {
         voice->NoteOff();
     }
-    for (auto& voice : holdQueue) {
+    for (auto* voice : holdQueue) {
         voice->NoteOff();
     }
     MidiChannel::Reset();
     bCsmVoiceMode = false;
 }
 
-void NoteChannel::moveVoice(std::list<Voice*>& src, std::list<Voice*>::iterator it,
-                            std::list<Voice*>& dst) {
-    dst.splice(dst.end(), src, it);
-    // この時点で呼び出し元のitは無効になる
+void NoteChannel::moveVoice(VoiceQueue& src, Voice* voice, VoiceQueue& dst) {
+    src.remove(voice);
+    dst.push_back(voice);
+    update_queue_max();
 }
 
-void NoteChannel::moveAllVoices(std::list<Voice*>& src, std::list<Voice*>& dst) {
-    dst.splice(dst.end(), src);
+void NoteChannel::moveAllVoices(VoiceQueue& src, VoiceQueue& dst) {
+    dst.splice(src);
+    update_queue_max();
 }
 
-Voice* NoteChannel::getFreeVoice(int mid, bool type, bool fromFirst) {
+void NoteChannel::update_queue_max() {
+    const VoiceQueue* queues[ChannelState::QUEUES] = {&activeQueue, &holdQueue, &freeQueue};
+    for (int q = 0; q < ChannelState::QUEUES; q++) {
+        int len = queues[q]->size();
+        if (len > queue_max[q]) {
+            queue_max[q] = len;
+        }
+    }
+}
+
+Voice* NoteChannel::getFreeVoice(int mid, bool type, bool fromFirst, uint32_t docks) {
     // 最近使ったmoduleに属するVoiceを優先的に探す。
     // NoteVoiceをチャンネル内で再利用する場合は末尾から、解放する場合は先頭から探す。
     // CsmVoiceは頻度が少なく先頭に滞留する傾向がある前提で先頭から探す。
@@ -50,69 +62,62 @@ Voice* NoteChannel::getFreeVoice(int mid, bool type, bool fromFirst) {
     Voice* voice = nullptr;
     if (type == true) {
         // CsmVoiceを先頭から探す
-        for (auto it = freeQueue.begin(); it != freeQueue.end(); ++it) {
-            //if ((*it)->GetType() == type &&
-            //    (mid == -1 || (*it)->GetModuleId() == mid)) {
-            if ((*it)->GetType() == type) {
-                voice = *it;
-                freeQueue.erase(it);
-                return voice;
+        for (auto* v : freeQueue) {
+            //if (v->GetType() == type &&
+            //    (mid == -1 || v->GetModuleId() == mid)) {
+            if (v->GetType() == type) {
+                freeQueue.remove(v);
+                return v;
             }
         }
     } else if (fromFirst) {
         // 最近使ったmoduleに属するNoteVoiceを先頭から探す
-        auto it        = freeQueue.begin();
-        auto end       = freeQueue.end();
-        auto candidate = it;
-        for (; it != end; ++it) {
-            if ((*it)->GetType() == type) {
-                if (voice == nullptr) {
-                    candidate = it;  // 先頭に最も近いVoice候補
+        Voice* candidate = nullptr;  // 先頭に最も近いVoice候補
+        for (auto* v : freeQueue) {
+            if (v->GetType() == type && ((docks >> v->GetModuleId()) & 1)) {
+                if (candidate == nullptr) {
+                    candidate = v;
                 }
-                voice = *it;  // イテレータが失効する前にVoiceを保存
-                if (mid == -1 || voice->GetModuleId() == mid) {
-                    freeQueue.erase(it);
-                    return voice;
+                if (mid == -1 || v->GetModuleId() == mid) {
+                    voice = v;
+                    break;
                 }
             }
         }
         // なければ先頭に最も近い候補から取り出す
-        if (voice) {
-            voice = *candidate;
-            freeQueue.erase(candidate);
-            return voice;
+        if (voice == nullptr) {
+            voice = candidate;
         }
     } else {
         // 最近使ったmoduleに属するNoteVoiceを末尾から探す
-        auto it        = freeQueue.rbegin();
-        auto end       = freeQueue.rend();
-        auto candidate = it;
-        for (; it != end; ++it) {
-            if ((*it)->GetType() == type) {
-                if (voice == nullptr) {
-                    candidate = it;  // 末尾に最も近いVoice候補
+        Voice* candidate = nullptr;  // 末尾に最も近いVoice候補
+        for (Voice* v = freeQueue.back(); v; v = VoiceQueue::prev(v)) {
+            if (v->GetType() == type && ((docks >> v->GetModuleId()) & 1)) {
+                if (candidate == nullptr) {
+                    candidate = v;
                 }
-                voice = *it;  // イテレータが失効する前にVoiceを保存
-                if (mid == -1 || voice->GetModuleId() == mid) {
-                    freeQueue.erase(std::next(it).base());
-                    return voice;
+                if (mid == -1 || v->GetModuleId() == mid) {
+                    voice = v;
+                    break;
                 }
             }
         }
         // なければ末尾に最も近い候補から取り出す
-        if (voice) {
-            voice = *candidate;
-            freeQueue.erase(std::next(candidate).base());
-            return voice;
+        if (voice == nullptr) {
+            voice = candidate;
         }
     }
+    if (voice) {
+        freeQueue.remove(voice);
+        return voice;
+    }
     // 再利用可能なVoiceが存在しない
     return nullptr;
 }
 
-Voice* NoteChannel::Release(int mid, bool type) {
+Voice* NoteChannel::Release(int mid, bool type, uint32_t docks) {
     // freeQueueの先頭から未使用のVoiceを探す
-    auto voice = getFreeVoice(mid, type, true);
+    auto voice = getFreeVoice(mid, type, true, docks);
     if (voice) {
         ++rel_success_count;
     } else {
@@ -127,6 +132,15 @@ void NoteChannel::ReleaseAll() {
     freeQueue.clear();
 }
 
+bool NoteChannel::Revoke(Voice* voice) {
+    // 呼び出し元がキューを走査中の場合があるので、対象のVoice以外のイテレータは失効させない
+    if (activeQueue.remove(voice) || holdQueue.remove(voice)) {
+        return true;
+    }
+    freeQueue.remove(voice);
+    return false;
+}
+
 void NoteChannel::BankSelect_LSB(uint8_t val) {
     MidiChannel::BankSelect_LSB(val);
 #if ENABLE_CSM != 0
@@ -143,16 +157,17 @@ void NoteChannel::SetProgram(uint8_t no) {
 }
 
 void NoteChannel::SetVolume(int vol) {
-    for (auto& voice : activeQueue) {
+    for (auto* voice : activeQueue) {
         voice->SetVolume(vol);
     }
-    for (auto& voice : holdQueue) {
+    for (auto* voice : holdQueue) {
         voice->SetVolume(vol);
     }
     volume = vol;  // SetVolume()後に更新する
 }
 
 int NoteChannel::NoteOn(int key, int velocity) {
+    PROFILE_SCOPE(NOTE_ON);
     // Velocity=0なのでNoteOff処理
     if (velocity == 0) {
         return NoteOff(key);
@@ -161,24 +176,24 @@ int NoteChannel::NoteOn(int key, int velocity) {
     int mid = -1;  // 最近使ったmoduleが不明
 
     // holdQueue内の同一keyのVoiceを探して再利用
-    for (auto it = holdQueue.begin(); it != holdQueue.end(); ++it) {
-        if ((*it)->GetKey() == key) {
+    for (auto* voice : holdQueue) {
+        if (voice->GetKey() == key) {
             // 強制Damp & 再利用
-            (*it)->NoteOff();
-            (*it)->NoteOn(key, bk_program, volume, effect, outputLR);
-            DPRINTF(1, " H%02d ", (*it)->id);
-            moveVoice(holdQueue, it, activeQueue);  // activeQueueに移動
+            voice->NoteOff();
+            voice->NoteOn(key, bk_program, volume, effect, outputLR);
+            TRACE(VOICE_ON, channel, 'H', voice->id);
+            moveVoice(holdQueue, voice, activeQueue);  // activeQueueに移動
             return 1;
         }
-        mid = (*it)->GetModuleId();  // 最近使ったmodule
+        mid = voice->GetModuleId();  // 最近使ったmodule
     }
     // activeQueue内の同一keyのVoiceを探して再利用
-    for (auto& voice : activeQueue) {
+    for (auto* voice : activeQueue) {
         if (voice->GetKey() == key) {
             // 強制Damp & 再利用
             voice->NoteOff();
             voice->NoteOn(key, bk_program, volume, effect, outputLR);
-            DPRINTF(1, " A%02d ", voice->id);
+            TRACE(VOICE_ON, channel, 'A', voice->id);
             return 1;
         }
         mid = (voice)->GetModuleId();  // 最近使ったmodule
@@ -186,52 +201,55 @@ int NoteChannel::NoteOn(int key, int velocity) {
 
     // freeQueue内のVoiceを再利用
     //   なるべく最近使ったものから探す
-    Voice* voice = getFreeVoice(mid, bCsmVoiceMode, false);
+    AllocStats::Path path = AllocStats::LOCAL;
+    Voice* voice          = getFreeVoice(mid, bCsmVoiceMode, false);
     if (voice == nullptr) {
         // 使用可能なVoiceがないので新規にAllocate
-        voice = allocator->AllocateVoice(channel, mid, bCsmVoiceMode);
+        voice = allocator->AllocateVoice(channel, mid, bCsmVoiceMode, path);
         if (voice == nullptr) {
             // AllocateできなかったのでNoteOn失敗
             ++rel_fail_count;
-            DPRINTF(1, "!!!!!!!!!!");
+            TRACE(VOICE_FAIL, channel, key);
             return -1;
         }
         // 新規にAllocateできた
-        DPRINTF(1, " N%02d ", voice->id);
+        TRACE(VOICE_ON, channel, 'N', voice->id);
     } else {
         // 再利用
-        DPRINTF(1, " F%02d ", voice->id);
+        TRACE(VOICE_ON, channel, 'F', voice->id);
     }
     // 新規にAllocateしたVoiceをActiveキューに追加
+    uint32_t loads = NoteVoice::GetToneLoadCount();
     voice->NoteOn(key, bk_program, volume, effect, outputLR);
+    allocator->CountAllocation(path, mid, voice, NoteVoice::GetToneLoadCount() - loads);
     activeQueue.push_back(voice);
+    update_queue_max();
 
     return 1;
 }
 
 int NoteChannel::NoteOff(int key) {
-    for (auto it = activeQueue.begin(); it != activeQueue.end();) {
-        if ((*it)->GetKey() == key) {
-            if ((*it)->DecrementNoteOnCount() > 0) {
+    PROFILE_SCOPE(NOTE_OFF);
+    for (auto* voice : activeQueue) {
+        if (voice->GetKey() == key) {
+            if (voice->DecrementNoteOnCount() > 0) {
                 // オーバラップノートのため、まだNoteOffしない
-                DPRINTF(1, " K%02d ", (*it)->id);
+                TRACE(VOICE_OFF, channel, 'K', voice->id);
                 return 1;
             }
             if (hold1 == false) {
-                (*it)->NoteOff();
-                DPRINTF(1, " -%02d ", (*it)->id);       // itが無効になるのでここで出力
-                moveVoice(activeQueue, it, freeQueue);  // freeQueueに移動
+                voice->NoteOff();
+                TRACE(VOICE_OFF, channel, '-', voice->id);
+                moveVoice(activeQueue, voice, freeQueue);  // freeQueueに移動
             } else {
                 // Hold状態なのでNoteOffを保留する
-                DPRINTF(1, " H%02d ", (*it)->id);       // itが無効になるのでここで出力
-                moveVoice(activeQueue, it, holdQueue);  // holdQueueに移動
+                TRACE(VOICE_OFF, channel, 'H', voice->id);
+                moveVoice(activeQueue, voice, holdQueue);  // holdQueueに移動
             }
             return 0;
-        } else {
-            ++it;
         }
     }
-    DPRINTF(1, " -?? ");
+    TRACE(VOICE_MISS, channel, key);
     return -1;
 }
 
@@ -242,7 +260,7 @@ void NoteChannel::Hold1(int val) {
     } else {
         // Hold1 off
         hold1 = false;
-        for (auto& voice : holdQueue) {
+        for (auto* voice : holdQueue) {
             voice->NoteOff();
         }
         moveAllVoices(holdQueue, freeQueue);
@@ -275,7 +293,7 @@ void NoteChannel::DataEntry_MSB(uint8_t val) {
 void NoteChannel::PitchBend(int16_t val) {
     if (effect.pbv != val) {  // 変化があった時のみ適用
         effect.pbv = val;
-        for (auto& voice : activeQueue) {
+        for (auto* voice : activeQueue) {
             voice->SetPitch(effect);
         }
         // holdQueueのVoiceには効果が薄いため省略
@@ -285,7 +303,7 @@ void NoteChannel::PitchBend(int16_t val) {
 void NoteChannel::SetModulation(uint8_t val) {
     if (effect.vbdepth != val) {  // 変化があった時のみ適用
         effect.vbdepth = val;
-        for (auto& voice : activeQueue) {
+        for (auto* voice : activeQueue) {
             voice->SetModulation(effect, outputLR);
         }
     }
@@ -300,7 +318,7 @@ void NoteChannel::SetPan(uint8_t val) {
         } else {
             outputLR = MidiChannel::Output::R;
         }
-        for (auto& voice : activeQueue) {
+        for (auto* voice : activeQueue) {
             voice->SetModulation(effect, outputLR);
         }
         pan = val;
@@ -308,20 +326,19 @@ void NoteChannel::SetPan(uint8_t val) {
 }
 
 // Debug
-void NoteChannel::dump() {
-    MidiChannel::dump();
-    printf("  TYPE=%s\n", bCsmVoiceMode ? "CSM" : "Note");
-    printf("  activeQ=%2zu :", activeQueue.size());
-    for (auto& voice : activeQueue) {
-        printf(" %2d", voice->id);
-    }
-    printf("\n    holdQ=%2zu :", holdQueue.size());
-    for (auto& voice : holdQueue) {
-        printf(" %2d", voice->id);
-    }
-    printf("\n    freeQ=%2zu :", freeQueue.size());
-    for (auto& voice : freeQueue) {
-        printf(" %2d", voice->id);
+void NoteChannel::snapshot(ChannelState& s) {
+    MidiChannel::snapshot(s);
+    s.type = bCsmVoiceMode ? "CSM" : "Note";
+    const VoiceQueue* queues[ChannelState::QUEUES] = {&activeQueue, &holdQueue, &freeQueue};
+    for (int q = 0; q < ChannelState::QUEUES; q++) {
+        s.queue_len[q] = queues[q]->size();
+        s.queue_max[q] = queue_max[q];
+        int i          = 0;
+        for (auto* voice : *queues[q]) {
+            if (i >= MAX_VOICES) {
+                break;
+            }
+            s.queue[q][i++] = voice->id;
+        }
     }
-    printf("\n");
 }
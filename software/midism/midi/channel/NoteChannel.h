@@ -5,11 +5,10 @@
 // See LICENSE file for details.
 //
 #pragma once
-#include <list>
-
 #include "MidiChannel.h"
 #include "MidiChannelObserver.h"
 #include "VoiceAllocator.h"
+#include "VoiceQueue.h"
 
 /**
  * @brief NoteChannel class
@@ -17,28 +16,30 @@
 class NoteChannel : public MidiChannel, public MidiChannelObserver {
 private:
     VoiceAllocator* allocator;
-    std::list<Voice*> activeQueue;  // NoteON状態のVoiceキュー
-    std::list<Voice*> holdQueue;    // NoteOFF待ち状態のVoiceキュー
-    std::list<Voice*> freeQueue;    // 未使用状態のVoiceキュー
-    bool bCsmVoiceMode;             // true:CsmVoice, false:NoteType
+    VoiceQueue activeQueue;               // NoteON状態のVoiceキュー
+    VoiceQueue holdQueue;                 // NoteOFF待ち状態のVoiceキュー
+    VoiceQueue freeQueue;                 // 未使用状態のVoiceキュー
+    bool bCsmVoiceMode;                   // true:CsmVoice, false:NoteType
+    int queue_max[ChannelState::QUEUES];  // DEBUG: キューのVoice数の最大値
 
     /**
      * @brief freeQueueから未使用のVoiceを取得する
      * @param mid       最近使ったmodule id
      * @param type      true:CsmVoice, false:NoteVoice
      * @param fromFirst true:先頭から検索する / false:末尾から検索する
+     * @param docks     対象とするNoteVoiceのDockのビットマップ
      * @details 最近使ったmoduleに属するVoiceを優先的に探す。
      */
-    Voice* getFreeVoice(int mid, bool type, bool fromFirst);
+    Voice* getFreeVoice(int mid, bool type, bool fromFirst, uint32_t docks = 0xffffffff);
 
     /**
      * @brief Voiceをキュー間で移動する
-     * @param src 移動元キュー
-     * @param it  移動元キューのイテレータ
-     * @param dst 移動先キュー
-     * @details srcキューのitが指し示すVoice 1つ分を、dstキューに移動する
+     * @param src   移動元キュー
+     * @param voice 移動するVoice
+     * @param dst   移動先キュー
+     * @details srcキューのVoice 1つ分を、dstキューの末尾に移動する
      */
-    void moveVoice(std::list<Voice*>& src, std::list<Voice*>::iterator it, std::list<Voice*>& dst);
+    void moveVoice(VoiceQueue& src, Voice* voice, VoiceQueue& dst);
 
     /**
      * @brief Voiceをすべて移動する
@@ -46,7 +47,12 @@ private:
      * @param dst 移動先キュー
      * @details srcキューの内容をすべてdstキューに移動する
      */
-    void moveAllVoices(std::list<Voice*>& src, std::list<Voice*>& dst);
+    void moveAllVoices(VoiceQueue& src, VoiceQueue& dst);
+
+    /**
+     * @brief キューのVoice数の最大値を更新する
+     */
+    void update_queue_max();
 
 public:
     /**
@@ -65,16 +71,27 @@ public:
 
     /**
      * @brief 当該チャンネルに割り当てられたVoiceのうち未使用のものを解放する
+     * @param mid   優先するmodule id
+     * @param type  Voice Type true:CsmVoice, false:NoteVoice
+     * @param docks 解放してよいNoteVoiceのDockのビットマップ
      * @return 解放したVoiceへのポインタ
      * @details 未使用のVoiceがない場合はnullptrを返す
      */
-    Voice* Release(int mid, bool type) override;
+    Voice* Release(int mid, bool type, uint32_t docks) override;
 
     /**
      * @brief 当該チャンネルに割り当てられたVoiceをすべて解放する
      */
     void ReleaseAll() override;
 
+    /**
+     * @brief 割り当てられたVoiceを強制的に外す
+     * @param voice 外すVoice
+     * @return true:発音中(activeQueue/holdQueue)だった
+     * @details 発音の停止は呼び出し側で行う
+     */
+    bool Revoke(Voice* voice) override;
+
     /**
      * @brief CC#32 Bank select LSB
      * @details LSBをセットすると同時にProgramに反映する。
@@ -153,5 +170,5 @@ public:
     virtual void SetPan(uint8_t val) override;
 
     // Debug
-    void dump() override;
+    void snapshot(ChannelState& s) override;
 };
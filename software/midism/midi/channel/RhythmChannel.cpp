@@ -6,7 +6,7 @@
 //
 #include "RhythmChannel.h"
 
-#include "Debugger.h"
+#include "Trace.h"
 
 //
 // GM Percussion map
@@ -94,7 +94,7 @@ static constexpr uint8_t ILvolume[128] = {
     30, 30, 30, 30, 30, 30, 30, 30, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
 };
 
-RhythmChannel::RhythmChannel(OpnBase* module) : MidiChannel(MIDI_RHYTHM_CHANNEL), module(module) {
+RhythmChannel::RhythmChannel(OpnBase* module, int no) : MidiChannel(no), module(module) {
     SetOutputLR(LR);        // L/R両チャンネル出力に設定
     init_volume(100, 127);  // デフォルト音量
 }
@@ -110,6 +110,9 @@ void RhythmChannel::Reset() {
 
 void RhythmChannel::init_volume(uint8_t rtl, uint8_t il) {
     SetVolume(rtl);
+    if (module == nullptr) {
+        return;
+    }
     il = ILvolume[il];
     module->rtm_set_inst_level(YM2608::RtmInst::BD, il);
     module->rtm_set_inst_level(YM2608::RtmInst::SD, il);
@@ -122,11 +125,16 @@ void RhythmChannel::init_volume(uint8_t rtl, uint8_t il) {
 void RhythmChannel::SetVolume(int vol) {
     if (volume != vol) {
         volume = vol;
-        module->rtm_set_total_level(RTLvolume[vol]);
+        if (module) {
+            module->rtm_set_total_level(RTLvolume[vol]);
+        }
     }
 }
 
 int RhythmChannel::NoteOn(int key, int velocity) {
+    if (module == nullptr) {
+        return -1;  // リズム音源モジュールがない
+    }
     int st = 1;
     if (key >= 35 && key < sizeof(percussion_map) / sizeof(YM2608::RtmInst) + 35) {
         YM2608::RtmInst note = percussion_map[key - 35];
@@ -139,11 +147,11 @@ int RhythmChannel::NoteOn(int key, int velocity) {
                 module->rtm_set_inst_level(note, ILvolume[volume]);
                 module->rtm_turnon_key(note);
             }
-            DPRINTF(1, " *%02d ", key);
+            TRACE(RHYTHM, channel, '*', key);
             return st;
         }
     }
-    DPRINTF(1, " ?%02d ", key);
+    TRACE(RHYTHM, channel, '?', key);
     return -1;
 }
 
@@ -151,15 +159,19 @@ int RhythmChannel::NoteOff(int key) {
     return NoteOn(key, 0);
 }
 
-Voice* RhythmChannel::Release(int mid, bool type) {
+Voice* RhythmChannel::Release(int mid, bool type, uint32_t docks) {
     return nullptr;
 }
 
 void RhythmChannel::ReleaseAll() {
 }
 
+bool RhythmChannel::Revoke(Voice* voice) {
+    return false;
+}
+
 // Debug
-void RhythmChannel::dump() {
-    MidiChannel::dump();
-    printf("  TYPE=RTM\n");
+void RhythmChannel::snapshot(ChannelState& s) {
+    MidiChannel::snapshot(s);
+    s.type = "RTM";
 }
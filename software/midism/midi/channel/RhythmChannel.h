@@ -21,9 +21,10 @@ public:
 
     /**
      * @brief コンストラクタ
-     * @param module Rhythmを割り当てるFM音源モジュール
+     * @param module Rhythmを割り当てるFM音源モジュール(nullptr:リズム音源なし)
+     * @param no     MIDI Channel No.
      */
-    RhythmChannel(OpnBase* module);
+    RhythmChannel(OpnBase* module, int no = MIDI_RHYTHM_CHANNEL);
     RhythmChannel() = delete;
 
     /**
@@ -56,7 +57,7 @@ public:
      * @brief 当該チャンネルに割り当てられたVoiceのうち未使用のものを解放する
      * @return FM音源のVoiceは使用しないので常にnullptrを返す
      */
-    Voice* Release(int mid, bool type) override;
+    Voice* Release(int mid, bool type, uint32_t docks) override;
 
     /**
      * @brief 当該チャンネルに割り当てられたVoiceをすべて解放する
@@ -64,13 +65,19 @@ public:
      */
     void ReleaseAll() override;
 
+    /**
+     * @brief 割り当てられたVoiceを強制的に外す
+     * @return FM音源のVoiceは使用しないので常にfalseを返す
+     */
+    bool Revoke(Voice* voice) override;
+
     /**
      * @brief MIDIチャンネルのリセット
      */
     void Reset() override;
 
     // Debug
-    void dump() override;
+    void snapshot(ChannelState& s) override;
 
 private:
     /**
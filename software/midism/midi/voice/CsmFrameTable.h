@@ -0,0 +1,249 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// 音声データ
+#include "csm/VOICE.dat"
+
+/**
+ * @brief CSM音声データのフレーズバンク
+ * @details
+ * VOICE.datのフレームデータを、ビルド時(constexpr)にレジスタ値の差分で圧縮した
+ * フレーズバンク(rom_bank)に変換する。SysExでアップロードするフレーズバンクも同じ形式とする。
+ *
+ * フレーズバンクの形式(多バイト値はリトルエンディアン)
+ * - uint16_t size       : フレーズバンク全体のバイト数
+ * - uint8_t  count      : フレーズ数(1-128)
+ * - uint16_t offset[]   : 各フレーズの先頭位置(フレーズバンクの先頭から)
+ * - フレーズ            : フレームの並び
+ *
+ * フレームの形式
+ * - uint32_t mask       : bit 0       Timer Aが変化した
+ *                         bit 1-N     TL[0..N-1]が変化した
+ *                         bit N+1-2N  Block/F-Number[0..N-1]が変化した
+ *                         bit 31      フレーズの最終フレーム
+ * - 差分                : 変化したレジスタ値の前フレームとの差分(ZigZag符号化した可変長整数)
+ * フレーズの先頭では、全てのレジスタ値を0として差分を求める。
+ */
+namespace csm {
+
+constexpr uint16_t PITCH_MASK   = 0x03ff;  // Timer A (10bit)
+constexpr uint16_t PHRASE_START = 0x4000;  // フレーズの先頭フレーム
+constexpr uint16_t PHRASE_END   = 0x8000;  // フレーズの最終フレーム
+
+constexpr int NUM_FRAMES = sizeof(frame_data) / sizeof(frame_data[0]);  // フレーム数
+constexpr int DOCKS      = (CSM_N + 3) / 4;  // 使用するFM音源モジュール数
+constexpr int DOCK_REGS  = 2 + 4 * 3;        // Timer A + (TL, F-Number2, F-Number1) x 4
+
+// フレームのレジスタ値: Timer A, TL[CSM_N], Block/F-Number[CSM_N]
+constexpr int FIELDS          = 1 + CSM_N * 2;
+constexpr int FIELD_TL        = 1;
+constexpr int FIELD_FNUM      = 1 + CSM_N;
+constexpr uint32_t LAST_FRAME = 0x80000000;  // maskの最終フレームのビット
+static_assert(FIELDS < 32, "CSM_N is too large");
+
+// フレーズバンクのヘッダ
+constexpr int BANK_HEADER = 3;    // size, count
+constexpr int MAX_PHRASES = 128;  // Note番号の数
+
+// 書き込むレジスタアドレス(CH3)
+// F-Number2はF-Number1より先に書き込む必要がある
+constexpr uint8_t DOCK_ADDRESS[DOCK_REGS] = {
+    0x25, 0x24,        // Timer A
+    0x42, 0xad, 0xa9,  // OP1 TL, F-Number2, F-Number1
+    0x4a, 0xae, 0xaa,  // OP2
+    0x46, 0xac, 0xa8,  // OP3
+    0x4e, 0xa6, 0xa2,  // OP4
+};
+
+/**
+ * @brief FM音源モジュールdで書き込むレジスタ数
+ * @param d FM音源モジュール番号
+ * @details 最後のFM音源モジュールは、CSM_Nに含まれるオペレータ分だけ書き込む
+ */
+constexpr int dock_regs(int d) {
+    int ops = CSM_N - d * 4;
+    return 2 + 3 * (ops < 4 ? ops : 4);
+}
+
+/**
+ * @brief CSM周波数をBlock/F-Numberに変換する
+ * @param freq CSM周波数
+ * @return Block/F-Number (14bit)
+ */
+constexpr uint16_t to_fnumber(uint16_t freq) {
+    for (int blk = 5; blk >= 0; blk--) {
+        // f = 72 * csm_f * (2**20) / 4000000 / (2 ** (blk - 1))
+        uint32_t f = ((uint32_t)38 * freq) >> blk;
+        if (f < 2048) {
+            return ((blk << 11) | f) & 0x3fff;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 1フレーム分のレジスタデータ
+ */
+struct Frame {
+    uint8_t dock[DOCKS][DOCK_REGS];  // DOCK_ADDRESSの順に並べたデータ
+};
+
+/**
+ * @brief レジスタ値をFM音源モジュールごとのレジスタデータに並べる
+ * @param value  レジスタ値(FIELDS個)
+ * @param frame  レジスタデータ
+ */
+template <typename T>
+constexpr void make_frame(const T* value, Frame& frame) {
+    uint16_t pitch = value[0];
+    for (int d = 0; d < DOCKS; d++) {
+        uint8_t* p = frame.dock[d];
+        *p++       = pitch & 0x3;
+        *p++       = (pitch >> 2) & 0xff;
+        for (int op = 0; op < 4 && d * 4 + op < CSM_N; op++) {
+            int n         = d * 4 + op;
+            uint16_t fnum = value[FIELD_FNUM + n];
+            *p++          = value[FIELD_TL + n];
+            *p++          = fnum >> 8;
+            *p++          = fnum & 0xff;
+        }
+    }
+}
+
+/**
+ * @brief フレーズ
+ */
+struct Phrase {
+    int start;   // 先頭フレーム
+    int length;  // 最終フレーム - 先頭フレーム
+};
+
+constexpr int count_marks(uint16_t mark) {
+    int n = 0;
+    for (int i = 0; i < NUM_FRAMES; i++) {
+        if (frame_data[i].Pitch & mark) {
+            n++;
+        }
+    }
+    return n;
+}
+
+constexpr int NUM_PHRASES = count_marks(PHRASE_START);  // フレーズ数
+static_assert(NUM_PHRASES > 0 && NUM_PHRASES <= MAX_PHRASES, "VOICE.dat has no phrase");
+static_assert(NUM_PHRASES == count_marks(PHRASE_END), "VOICE.dat has unbalanced phrase marks");
+
+/**
+ * @brief フレーズの索引を生成する
+ * @details
+ * フレーズは重なってもよいので、n番目の先頭マークとn番目の最終マークを組にする。
+ */
+constexpr std::array<Phrase, NUM_PHRASES> make_phrases() {
+    std::array<Phrase, NUM_PHRASES> phrases{};
+    int s = 0;
+    int e = 0;
+    for (int i = 0; i < NUM_FRAMES; i++) {
+        if (frame_data[i].Pitch & PHRASE_START) {
+            phrases[s++].start = i;
+        }
+        if (frame_data[i].Pitch & PHRASE_END) {
+            phrases[e].length = i - phrases[e].start;
+            e++;
+        }
+    }
+    return phrases;
+}
+
+/**
+ * @brief フレーズバンクの書き込み先
+ * @details 容量を超えた分は書き込まずにサイズだけ数える(容量を求めるため)
+ */
+template <size_t N>
+struct BankWriter {
+    std::array<uint8_t, N> data{};
+    int size = 0;
+
+    constexpr void put(uint8_t b) {
+        if (size < (int)N) {
+            data[size] = b;
+        }
+        size++;
+    }
+    constexpr void set(int pos, uint8_t b) {
+        if (pos < (int)N) {
+            data[pos] = b;
+        }
+    }
+    constexpr void set16(int pos, uint16_t v) {
+        set(pos, v & 0xff);
+        set(pos + 1, v >> 8);
+    }
+    constexpr void put32(uint32_t v) {
+        for (int i = 0; i < 4; i++) {
+            put((v >> (i * 8)) & 0xff);
+        }
+    }
+    constexpr void put_varint(int32_t v) {
+        // ZigZag符号化して下位から7bitずつ(bit7は継続フラグ)
+        uint32_t z = (v < 0) ? ((uint32_t)(-v) << 1) - 1 : (uint32_t)v << 1;
+        while (z >= 0x80) {
+            put((z & 0x7f) | 0x80);
+            z >>= 7;
+        }
+        put(z);
+    }
+};
+
+/**
+ * @brief VOICE.datをフレーズバンクに変換する
+ */
+template <size_t N>
+constexpr BankWriter<N> encode_bank() {
+    const std::array<Phrase, NUM_PHRASES> phrases = make_phrases();
+    BankWriter<N> w;
+    w.size = BANK_HEADER + NUM_PHRASES * 2;
+    w.set(2, NUM_PHRASES);
+    for (int p = 0; p < NUM_PHRASES; p++) {
+        w.set16(BANK_HEADER + p * 2, w.size);
+        uint16_t prev[FIELDS]{};
+        for (int i = phrases[p].start; i <= phrases[p].start + phrases[p].length; i++) {
+            const frame_format& src = frame_data[i];
+            uint16_t value[FIELDS]{};
+            value[0] = src.Pitch & PITCH_MASK;
+            for (int n = 0; n < CSM_N; n++) {
+                value[FIELD_TL + n]   = src.TL[n];
+                value[FIELD_FNUM + n] = to_fnumber(src.Freq[n]);
+            }
+            uint32_t mask = (i == phrases[p].start + phrases[p].length) ? LAST_FRAME : 0;
+            for (int f = 0; f < FIELDS; f++) {
+                if (value[f] != prev[f]) {
+                    mask |= 1u << f;
+                }
+            }
+            w.put32(mask);
+            for (int f = 0; f < FIELDS; f++) {
+                if (value[f] != prev[f]) {
+                    w.put_varint(value[f] - prev[f]);
+                    prev[f] = value[f];
+                }
+            }
+        }
+    }
+    w.set16(0, w.size);
+    return w;
+}
+
+constexpr int ROM_BANK_SIZE = encode_bank<1>().size;  // 内蔵フレーズバンクのバイト数
+static_assert(ROM_BANK_SIZE <= 0xffff, "VOICE.dat is too large");
+
+// 内蔵フレーズバンク
+inline constexpr std::array<uint8_t, ROM_BANK_SIZE> rom_bank = encode_bank<ROM_BANK_SIZE>().data;
+
+}  // namespace csm
@@ -0,0 +1,72 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#include "CsmInterpolator.h"
+
+#include <cstring>
+
+CsmInterpolator::CsmInterpolator(int subframes)
+    : subframes(subframes < 1 ? 1 : subframes), remain(0) {
+    memset(value, 0, sizeof(value));
+    memset(step, 0, sizeof(step));
+    memset(target, 0, sizeof(target));
+    memset(block, 0, sizeof(block));
+}
+
+void CsmInterpolator::load(const uint16_t* frame) {
+    for (int f = 0; f < csm::FIELDS; f++) {
+        value[f] = (f < csm::FIELD_FNUM) ? (int32_t)frame[f] << FRAC_BITS : to_linear(frame[f]);
+    }
+}
+
+void CsmInterpolator::Start(const uint16_t* frame) {
+    memcpy(target, frame, sizeof(target));
+    load(frame);
+    memset(step, 0, sizeof(step));
+    remain = 1;
+}
+
+void CsmInterpolator::Target(const uint16_t* frame) {
+    // 現在値を直前のフレームに揃えてから差分を求める
+    load(target);
+    for (int n = 0; n < CSM_N; n++) {
+        uint8_t b0 = (target[csm::FIELD_FNUM + n] >> 11) & 7;
+        uint8_t b1 = (frame[csm::FIELD_FNUM + n] >> 11) & 7;
+        block[n]   = (b0 > b1) ? b0 : b1;
+    }
+    memcpy(target, frame, sizeof(target));
+    for (int f = 0; f < csm::FIELDS; f++) {
+        int32_t next = (f < csm::FIELD_FNUM) ? (int32_t)frame[f] << FRAC_BITS : to_linear(frame[f]);
+        step[f]      = (next - value[f]) / subframes;
+    }
+    remain = subframes;
+}
+
+void CsmInterpolator::Step(uint16_t* out) {
+    if (remain <= 1) {
+        // 最後のサブフレームは次のフレームの値をそのまま出力する
+        memcpy(out, target, sizeof(target));
+        load(target);
+        remain = 0;
+        return;
+    }
+    --remain;
+    constexpr int32_t half = 1 << (FRAC_BITS - 1);
+    for (int f = 0; f < csm::FIELD_FNUM; f++) {
+        value[f] += step[f];
+        out[f] = (value[f] + half) >> FRAC_BITS;
+    }
+    for (int n = 0; n < CSM_N; n++) {
+        int f = csm::FIELD_FNUM + n;
+        value[f] += step[f];
+        int shift     = FRAC_BITS + block[n];
+        uint32_t fnum = (value[f] + (1 << (shift - 1))) >> shift;
+        if (fnum > 0x7ff) {
+            fnum = 0x7ff;
+        }
+        out[f] = (block[n] << 11) | fnum;
+    }
+}
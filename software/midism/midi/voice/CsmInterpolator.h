@@ -0,0 +1,71 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include <cstdint>
+
+#include "CsmFrameTable.h"
+
+/**
+ * @brief CSMフレームの補間
+ * @details
+ * フレーム間をサブフレームに分割し、レジスタ値をQ8.8の固定小数点で線形補間する。
+ * 最後のサブフレームでは次のフレームの値をそのまま出力するので、誤差は蓄積しない。
+ * Block/F-Numberは、ブロックが異なるフレーム間でも周波数が単調に変化するよう
+ * F-Number << Blockの周波数領域で補間し、両端の大きい方のブロックで出力する。
+ * 補間結果はtests/test_csm_interpolator.cppで倍精度の計算と比較している。
+ */
+class CsmInterpolator {
+public:
+    static constexpr int FRAC_BITS = 8;  // Q8.8
+
+private:
+    const int subframes;             // 1フレームあたりのサブフレーム数
+    int remain;                      // 次のフレームまでのサブフレーム数
+    int32_t value[csm::FIELDS];      // 現在値(Q8.8, F-Numberは周波数領域)
+    int32_t step[csm::FIELDS];       // 1サブフレームあたりの変化量(Q8.8)
+    uint16_t target[csm::FIELDS];    // 次のフレームのレジスタ値
+    uint8_t block[CSM_N];            // 補間中に出力するBlock
+
+public:
+    /**
+     * @brief コンストラクタ
+     * @param subframes 1フレームあたりのサブフレーム数(1:補間しない)
+     */
+    explicit CsmInterpolator(int subframes);
+    CsmInterpolator() = delete;
+
+    /**
+     * @brief 最初のフレームを設定する
+     * @param frame レジスタ値(FIELDS個)
+     * @details 次のStep()でこのフレームをそのまま出力する
+     */
+    void Start(const uint16_t* frame);
+
+    /**
+     * @brief 次のフレームへの補間を開始する
+     * @param frame レジスタ値(FIELDS個)
+     */
+    void Target(const uint16_t* frame);
+
+    /**
+     * @brief 1サブフレーム分進めて、レジスタ値を出力する
+     * @param out レジスタ値(FIELDS個)
+     */
+    void Step(uint16_t* out);
+
+    /**
+     * @brief 目標のフレームに達したかどうか
+     * @details trueになったらTarget()で次のフレームを設定する
+     */
+    bool IsReached() const { return remain == 0; }
+
+private:
+    static int32_t to_linear(uint16_t fnum) {
+        return (int32_t)(fnum & 0x7ff) << ((fnum >> 11) & 7) << FRAC_BITS;
+    }
+    void load(const uint16_t* frame);
+};
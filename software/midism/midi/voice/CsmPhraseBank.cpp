@@ -0,0 +1,205 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#include "CsmPhraseBank.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "CsmPhraseDecoder.h"
+#include "Debugger.h"
+#if ENABLE_PHRASE_BANK_FLASH == 1
+#include "RP2040.h"
+#endif
+
+CsmPhraseBank& CsmPhraseBank::GetInstance() {
+    static CsmPhraseBank instance;
+    return instance;
+}
+
+CsmPhraseBank::CsmPhraseBank()
+    : revision(0), rx_slot(-1), rx_lsb(0), rx_size(0), rx_clear_lsb(0xff) {
+    // 全てのLSBを内蔵フレーズバンクにする
+    for (auto& bank : bank_table) {
+        bank = csm::rom_bank.data();
+    }
+    user.magic = MAGIC;
+    user.size  = sizeof(user);
+    memset(user.lsb, -1, sizeof(user.lsb));
+#if ENABLE_PHRASE_BANK_FLASH == 1
+    Load();
+#endif
+}
+
+void CsmPhraseBank::Clear(uint8_t lsb) {
+    lsb &= 0x7f;
+    for (int i = 0; i < USER_PHRASE_BANKS; i++) {
+        if (user.lsb[i] == lsb) {
+            user.lsb[i] = -1;
+        }
+    }
+    bank_table[lsb] = csm::rom_bank.data();
+    ++revision;
+}
+
+bool CsmPhraseBank::Store() {
+#if ENABLE_PHRASE_BANK_FLASH == 1
+    static_assert(sizeof(UserPhrases) <= FLASH_STORAGE_SIZE, "USER_PHRASE_BANKS is too large");
+    return flash_storage_write(FLASH_AREA_PHRASE_BANK, &user, sizeof(user));
+#else
+    return false;
+#endif
+}
+
+bool CsmPhraseBank::Load() {
+#if ENABLE_PHRASE_BANK_FLASH == 1
+    const UserPhrases* image = (const UserPhrases*)flash_storage_ptr(FLASH_AREA_PHRASE_BANK);
+    if (image->magic != MAGIC || image->size != sizeof(UserPhrases)) {
+        return false;
+    }
+    for (int i = 0; i < USER_PHRASE_BANKS; i++) {
+        if (image->lsb[i] < -1) {
+            return false;
+        }
+    }
+    memcpy(&user, image, sizeof(user));
+    for (int i = 0; i < USER_PHRASE_BANKS; i++) {
+        // 保存後に形式が変わっていても範囲外を読み出さないよう検査する
+        int size = user.data[i][0] | (user.data[i][1] << 8);
+        if (user.lsb[i] >= 0 && size <= USER_PHRASE_BANK_SIZE &&
+            CsmPhraseDecoder::Validate(user.data[i], size)) {
+            bank_table[user.lsb[i]] = user.data[i];
+        } else {
+            user.lsb[i] = -1;
+        }
+    }
+    ++revision;
+    return true;
+#else
+    return false;
+#endif
+}
+
+int CsmPhraseBank::bind(uint8_t lsb) {
+    lsb &= 0x7f;
+    // 受信中は内蔵フレーズバンクで再生する
+    bank_table[lsb] = csm::rom_bank.data();
+    ++revision;  // 書き換えるユーザー領域を再生中のCsmVoiceを止める
+
+    int slot = -1;
+    for (int i = 0; i < USER_PHRASE_BANKS; i++) {
+        if (user.lsb[i] == lsb) {
+            slot = i;  // 割り当て済みの領域を上書きする
+            break;
+        }
+        if (slot < 0 && user.lsb[i] < 0) {
+            slot = i;
+        }
+    }
+    if (slot < 0) {
+        return -2;  // 空きなし
+    }
+    user.lsb[slot] = -1;  // 受信が完了するまで未使用とする
+    return slot;
+}
+
+void CsmPhraseBank::SysExBegin(int tag) {
+    if (!rx_owner.Acquire(tag)) {
+        return;  // 他の入力元が受信中
+    }
+    rx_slot      = -1;
+    rx_size      = 0;
+    rx_clear_lsb = 0xff;
+}
+
+int CsmPhraseBank::SysExData(int tag, const uint8_t* data, int len) {
+    if (!rx_owner.Owns(tag)) {
+        return len;
+    }
+    tag = sysex_tag_value(tag);
+    if (tag == PHRASE_CLEAR) {
+        rx_clear_lsb = data[0];
+        return len;
+    }
+    if (tag != PHRASE_DUMP) {
+        return len;
+    }
+
+    int n = 0;
+    if (rx_slot == -1) {
+        // 先頭の1バイトは書き込み先のBank Select LSB
+        rx_lsb  = data[n++];
+        rx_slot = bind(rx_lsb);
+    }
+    if (rx_slot < 0) {
+        return len;  // 割り当てられなかったので読み捨て
+    }
+    // 上位/下位4bitの組から1バイトずつ書き込む(端数はパーサに残しておく)
+    while (len - n >= 2) {
+        if (rx_size >= USER_PHRASE_BANK_SIZE) {
+            rx_slot = -2;  // 容量超過
+            return len;
+        }
+        user.data[rx_slot][rx_size++] = (data[n] << 4) | (data[n + 1] & 0x0f);
+        n += 2;
+    }
+    return n;
+}
+
+void CsmPhraseBank::SysExEnd(int tag, bool complete) {
+    if (!rx_owner.Release(tag)) {
+        DPRINTF(1, "PHRASE: busy (source=%d)\n", sysex_tag_source(tag));
+        return;
+    }
+    switch (sysex_tag_value(tag)) {
+    case PHRASE_DUMP: {
+        bool valid =
+            complete && rx_slot >= 0 && CsmPhraseDecoder::Validate(user.data[rx_slot], rx_size);
+        if (valid) {
+            user.lsb[rx_slot]  = rx_lsb;
+            bank_table[rx_lsb] = user.data[rx_slot];
+            ++revision;
+        }
+        DPRINTF(1, "PHRASE DUMP: slot=%d size=%d %s\n", rx_slot, rx_size,
+                valid ? "" : (complete ? "(invalid)" : "(aborted)"));
+        break;
+    }
+    case PHRASE_STORE:
+        if (complete) {
+            bool result = Store();
+            DPRINTF(1, "PHRASE STORE: %s\n", result ? "OK" : "NG");
+        }
+        break;
+    case PHRASE_CLEAR:
+        if (complete && rx_clear_lsb < 0x80) {
+            Clear(rx_clear_lsb);
+        }
+        break;
+    }
+}
+
+// Debug
+void CsmPhraseBank::snapshot(PhraseBankState& s) const {
+    s.revision    = revision;
+    s.rom_size    = csm::rom_bank.size();
+    s.rom_phrases = CsmPhraseDecoder::GetPhraseCount(csm::rom_bank.data());
+    for (int i = 0; i < USER_PHRASE_BANKS; i++) {
+        s.lsb[i]     = user.lsb[i];
+        s.phrases[i] = (user.lsb[i] >= 0) ? CsmPhraseDecoder::GetPhraseCount(user.data[i]) : 0;
+    }
+}
+
+void CsmPhraseBank::print(const PhraseBankState& s) {
+    printf("\n=== CSM Phrase Bank (rev=%d, ROM=%dbytes/%dphrases) ===\n", s.revision,
+           (int)s.rom_size, s.rom_phrases);
+    for (int i = 0; i < USER_PHRASE_BANKS; i++) {
+        if (s.lsb[i] >= 0) {
+            printf("USER%d: LSB=%3d %dphrases\n", i, s.lsb[i], s.phrases[i]);
+        } else {
+            printf("USER%d: ---\n", i);
+        }
+    }
+}
@@ -0,0 +1,132 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include <cstdint>
+
+#include "SysExParser.h"
+#include "config.h"
+
+/**
+ * @brief ユーザーフレーズバンクの割り当て状況(デバッグ用)
+ */
+struct PhraseBankState {
+    uint32_t revision;                   // フレーズバンクの更新回数
+    uint32_t rom_size;                   // 内蔵フレーズバンクのバイト数
+    int rom_phrases;                     // 内蔵フレーズバンクのフレーズ数
+    int8_t lsb[USER_PHRASE_BANKS];       // 割り当てたBank Select LSB (-1:未使用)
+    uint8_t phrases[USER_PHRASE_BANKS];  // フレーズ数
+};
+
+/**
+ * @brief CSMフレーズバンク
+ * @details シングルトンクラス
+ * Bank Select LSBごとにフレーズバンク(形式はCsmFrameTable.hを参照)へのポインタを持つ。
+ * 初期状態では全てのLSBがVOICE.datから生成した内蔵フレーズバンクを指す。
+ * SysExでアップロードされたフレーズバンクはRAM上のユーザー領域に割り当てられ、
+ * 必要に応じてFlashに保存される。
+ */
+class CsmPhraseBank : public SysExHandler {
+public:
+    static constexpr int NUM_BANKS = 128;  // Bank Select LSB
+
+    /**
+     * @brief SysExのタグ
+     */
+    enum Command {
+        PHRASE_DUMP,   // フレーズバンクのダンプ
+        PHRASE_STORE,  // Flashへの保存
+        PHRASE_CLEAR,  // 内蔵フレーズバンクに戻す
+    };
+    // $F0に続くID (非営利ID $7D, モデルID $46, コマンド)
+    static constexpr uint8_t DUMP_ID[]  = {0x7d, 0x46, 0x04};
+    static constexpr uint8_t STORE_ID[] = {0x7d, 0x46, 0x05};
+    static constexpr uint8_t CLEAR_ID[] = {0x7d, 0x46, 0x06};
+
+private:
+    /**
+     * @brief ユーザーフレーズバンク(Flashへの保存イメージと同じ配置)
+     */
+    struct UserPhrases {
+        uint32_t magic;                                          // 識別子
+        uint32_t size;                                           // 構造体のサイズ
+        int8_t lsb[USER_PHRASE_BANKS];                           // 割り当てたLSB (-1:未使用)
+        uint8_t data[USER_PHRASE_BANKS][USER_PHRASE_BANK_SIZE];  // フレーズバンク
+    };
+    static constexpr uint32_t MAGIC = 0x53524850;  // "PHRS"
+
+    const uint8_t* bank_table[NUM_BANKS];  // LSB -> フレーズバンク
+    UserPhrases user;                      // ユーザーフレーズバンク
+    uint32_t revision;                     // フレーズバンクの更新回数
+
+    // 受信中のダンプ
+    int rx_slot;           // 書き込み先のユーザー領域 (-1:LSB待ち, -2:無効)
+    uint8_t rx_lsb;        // 書き込み先のLSB
+    int rx_size;           // 受信したバイト数
+    uint8_t rx_clear_lsb;  // PHRASE_CLEARの対象LSB (0xff:未受信)
+    SysExOwner rx_owner;   // 受信中の入力元
+
+    CsmPhraseBank();
+    ~CsmPhraseBank() = default;
+
+public:
+    CsmPhraseBank(const CsmPhraseBank&)            = delete;
+    CsmPhraseBank& operator=(const CsmPhraseBank&) = delete;
+    CsmPhraseBank(CsmPhraseBank&&)                 = delete;
+    CsmPhraseBank& operator=(CsmPhraseBank&&)      = delete;
+
+    /**
+     * @brief CsmPhraseBankのインスタンスを取得する
+     * @return CsmPhraseBankのインスタンス
+     */
+    static CsmPhraseBank& GetInstance();
+
+    /**
+     * @brief フレーズバンクを返す
+     * @param bk_program MIDI Bank/Program No. (MSB:bit31-24, LSB:bit23-16, Program:bit15-0)
+     * @return フレーズバンク
+     */
+    const uint8_t* GetBank(int32_t bk_program) const {
+        return bank_table[(bk_program >> 16) & 0x7f];
+    }
+
+    /**
+     * @brief フレーズバンクの更新回数を返す
+     * @details CsmVoiceは、再生中にこの値が変化したら再生を中止する
+     */
+    uint32_t GetRevision() const { return revision; }
+
+    /**
+     * @brief 内蔵フレーズバンクに戻す
+     * @param lsb Bank Select LSB (0-127)
+     */
+    void Clear(uint8_t lsb);
+
+    /**
+     * @brief ユーザーフレーズバンクをFlashに保存する
+     * @return true:成功
+     * @details ENABLE_PHRASE_BANK_FLASHが無効の場合は何もしない
+     */
+    bool Store();
+
+    /**
+     * @brief Flashからユーザーフレーズバンクを読み込む
+     * @return true:成功
+     */
+    bool Load();
+
+    // SysExHandler (tagはsysex_tag(入力元, Command))
+    void SysExBegin(int tag) override;
+    int SysExData(int tag, const uint8_t* data, int len) override;
+    void SysExEnd(int tag, bool complete) override;
+
+    // Debug
+    void snapshot(PhraseBankState& s) const;
+    static void print(const PhraseBankState& s);
+
+private:
+    int bind(uint8_t lsb);
+};
@@ -0,0 +1,112 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#include "CsmPhraseDecoder.h"
+
+#include <cstring>
+
+CsmPhraseDecoder::CsmPhraseDecoder() : ptr(nullptr), end(nullptr), last(false) {
+    memset(value, 0, sizeof(value));
+}
+
+int CsmPhraseDecoder::GetPhraseCount(const uint8_t* bank) {
+    if (bank == nullptr) {
+        return 0;
+    }
+    int count = bank[2];
+    if (count == 0 || count > csm::MAX_PHRASES ||
+        read16(bank) < csm::BANK_HEADER + count * 2) {
+        return 0;
+    }
+    return count;
+}
+
+bool CsmPhraseDecoder::Validate(const uint8_t* bank, int size) {
+    if (size < csm::BANK_HEADER || read16(bank) != size) {
+        return false;
+    }
+    int count = GetPhraseCount(bank);
+    if (count == 0) {
+        return false;
+    }
+    CsmPhraseDecoder decoder;
+    for (int i = 0; i < count; i++) {
+        if (!decoder.Start(bank, i)) {
+            return false;
+        }
+        while (decoder.Next()) {
+        }
+        if (!decoder.IsLast()) {
+            return false;  // 最終フレームの前に終端に達した
+        }
+    }
+    return true;
+}
+
+bool CsmPhraseDecoder::Start(const uint8_t* bank, int phrase) {
+    Stop();
+    int count = GetPhraseCount(bank);
+    if (phrase < 0 || phrase >= count) {
+        return false;
+    }
+    uint16_t size   = read16(bank);
+    uint16_t offset = read16(&bank[csm::BANK_HEADER + phrase * 2]);
+    if (offset < csm::BANK_HEADER + count * 2 || offset >= size) {
+        return false;
+    }
+    ptr  = &bank[offset];
+    end  = &bank[size];
+    last = false;
+    memset(value, 0, sizeof(value));
+    return true;
+}
+
+void CsmPhraseDecoder::Stop() {
+    ptr  = nullptr;
+    end  = nullptr;
+    last = false;
+}
+
+bool CsmPhraseDecoder::Next() {
+    if (ptr == nullptr || last) {
+        return false;
+    }
+    if (end - ptr < 4) {
+        Stop();
+        return false;
+    }
+    uint32_t mask = ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+    ptr += 4;
+    for (int f = 0; f < csm::FIELDS; f++) {
+        if (mask & (1u << f)) {
+            int32_t delta;
+            if (!read_varint(delta)) {
+                Stop();
+                return false;
+            }
+            value[f] += delta;
+        }
+    }
+    last = (mask & csm::LAST_FRAME) != 0;
+    return true;
+}
+
+bool CsmPhraseDecoder::read_varint(int32_t& v) {
+    uint32_t z = 0;
+    for (int shift = 0; shift < 32; shift += 7) {
+        if (ptr >= end) {
+            return false;
+        }
+        uint8_t b = *ptr++;
+        z |= (uint32_t)(b & 0x7f) << shift;
+        if ((b & 0x80) == 0) {
+            // ZigZag符号の復元
+            v = (z & 1) ? -(int32_t)((z + 1) >> 1) : (int32_t)(z >> 1);
+            return true;
+        }
+    }
+    return false;
+}
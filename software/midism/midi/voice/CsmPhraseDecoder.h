@@ -0,0 +1,78 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include <cstdint>
+
+#include "CsmFrameTable.h"
+
+/**
+ * @brief フレーズバンクのストリーミングデコーダ
+ * @details
+ * Timer Bのオーバーフローごとに1フレーム分の差分を読み出して、レジスタ値を更新する。
+ * フレーズバンクはSysExで受信したデータの場合もあるので、範囲外を読み出さないよう
+ * 全ての読み出しでサイズを確認する。
+ */
+class CsmPhraseDecoder {
+private:
+    const uint8_t* ptr;           // 次のフレームの位置 (nullptr:停止中)
+    const uint8_t* end;           // フレーズバンクの終端
+    uint16_t value[csm::FIELDS];  // 現在のレジスタ値
+    bool last;                    // 最終フレームを読み出した
+
+public:
+    CsmPhraseDecoder();
+
+    /**
+     * @brief フレーズバンクのフレーズ数を返す
+     * @param bank フレーズバンク
+     * @return フレーズ数 (0:不正なフレーズバンク)
+     */
+    static int GetPhraseCount(const uint8_t* bank);
+
+    /**
+     * @brief フレーズバンクの検査
+     * @param bank フレーズバンク
+     * @param size 受信したバイト数
+     * @return true:全てのフレーズを範囲内で最終フレームまで読み出せる
+     */
+    static bool Validate(const uint8_t* bank, int size);
+
+    /**
+     * @brief フレーズの読み出しを開始する
+     * @param bank   フレーズバンク
+     * @param phrase フレーズ番号
+     * @return false:フレーズがない
+     */
+    bool Start(const uint8_t* bank, int phrase);
+
+    /**
+     * @brief 読み出しを中止する
+     */
+    void Stop();
+
+    /**
+     * @brief 次のフレームを読み出す
+     * @return false:最終フレームの読み出し後、またはデータが不正
+     */
+    bool Next();
+
+    /**
+     * @brief 現在のレジスタ値を返す
+     * @details Timer A, TL[CSM_N], Block/F-Number[CSM_N]の順
+     */
+    const uint16_t* GetValues() const { return value; }
+
+    /**
+     * @brief 最終フレームを読み出したかどうか
+     * @details データが不正で中断した場合はfalse
+     */
+    bool IsLast() const { return last; }
+
+private:
+    static uint16_t read16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+    bool read_varint(int32_t& v);
+};
@@ -8,47 +8,69 @@
 
 #include <cstring>
 
+#include "CsmPhraseBank.h"
 #include "Debugger.h"
+#include "NoteVoice.h"
+#include "Profile.h"
 #include "RP2040.h"
+#include "VoiceAllocator.h"
+#include "hardware/timer.h"
 
-//#define ENABLE_INTERPOLATION
-#ifdef ENABLE_INTERPOLATION
-constexpr int INTERPOLATE = 4;
-#endif
-
-struct VoiceElement {
-    int start;
-    int length;
-} ve[]{
-    {  3, 27}, // T
-    { 27, 27}, // E
-    { 50, 27}, // C
-    { 78, 27}, // H
-    { 95, 27}, // N
-    {130, 27}, // O
-    {158, 25}, // P
-    {182, 27}, // O
-    {210, 24}, // L
-    {229, 27}, // I
-    {256, 27}, // S
-    {340, 48}, // TOKIO
-};
-static constexpr int num_of_voice = sizeof(ve) / sizeof(struct VoiceElement);
-
-CsmVoice::CsmVoice(std::array<OpnBase*, 4>& modules, int id)
+// Timer Bのカウント数(1カウント=288us @ 8MHz/2)
+constexpr float TIMER_B_COUNT = 125 * CsmVoice::TICK_PERIOD / 36;
+static_assert(TIMER_B_COUNT >= 1 && TIMER_B_COUNT <= 256, "CSM_SUBFRAMES is out of range");
+
+CsmVoice::CsmVoice(std::array<OpnBase*, MAX_DOCKS>& modules, uint8_t mask, int id)
     : Voice(true, id),  // CSM type
-      modules(modules),
+      modules{},
+      dock_mask(SelectDocks(modules, mask)),
       docks(0),
       operators(0),
       modTB(0),
+      irq(FM_IRQ0),
+      lenders{},
+      lender_count(0),
+      acquired(false),
+      interp(CSM_SUBFRAMES),
+      bank_rev(0),
       frame(0),
-      interp_count(0),
-      lastFrame(0),
-      isLastFrame(false) {
+      isLastFrame(false),
+      bInterrupt(false),
+      frame_due(false),
+      due_time(0),
+      frame_count(0),
+      late_count(0),
+      missed_count(0),
+      max_latency(0) {
+    // 使用するFM音源モジュールを先頭に詰める
+    for (int d = 0; d < (int)modules.size(); d++) {
+        if ((dock_mask >> d) & 1) {
+            if (docks == 0) {
+                irq = FM_IRQ0 + d;  // 最下位のDockの/IRQ
+            }
+            this->modules[docks++] = modules[d];
+        }
+    }
     SetProgram(0);   // デフォルト音色
     SetVolume(100);  // デフォルト音量
 }
 
+uint8_t CsmVoice::SelectDocks(const std::array<OpnBase*, MAX_DOCKS>& modules, uint8_t mask) {
+    uint8_t selected = 0;
+    int n            = 0;
+    for (int d = 0; d < (int)modules.size() && n < csm::DOCKS; d++) {
+        if (((mask >> d) & 1) && modules[d]) {
+            selected |= 1 << d;
+            n++;
+        }
+    }
+    // フレームの更新に最下位のDockの/IRQを使うので、/IRQがない場合は使用しない
+    if ((selected & ((1 << FM_IRQ_DOCKS) - 1)) == 0) {
+        return 0;
+    }
+    return selected;
+}
+
 CsmVoice::~CsmVoice() {
 }
 
@@ -57,10 +79,17 @@ void CsmVoice::Reset() {
     Voice::Reset();
     SetProgram(0);
     SetVolume(100);
+    decoder.Stop();
+    if (lender_count > 0) {
+        Stop();  // CH3を返却する
+    }
     frame        = 0;
-    interp_count = 0;
-    lastFrame    = 0;
     isLastFrame  = false;
+    frame_due    = false;
+    frame_count  = 0;
+    late_count   = 0;
+    missed_count = 0;
+    max_latency  = 0;
 }
 
 int CsmVoice::GetModuleId() {
@@ -83,10 +112,12 @@ void CsmVoice::NoteOn(int note, int32_t bk_program, int volume, VoiceEffect& eff
     UpdateFrame(true);
     SetModulation(effect, lr);
     IncrementNoteOnCount();
+    busy_begin();
 }
 
 void CsmVoice::NoteOff() {
     SetNoteOnCount(0);
+    busy_end();
 }
 
 void CsmVoice::SetPitch(VoiceEffect& e) {
@@ -103,66 +134,79 @@ void CsmVoice::SetModulation(VoiceEffect& effect, uint8_t lr) {
     }
 }
 
+void CsmVoice::AddLender(NoteVoice* voice) {
+    if (lender_count < (int)lenders.size()) {
+        lenders[lender_count++] = voice;
+    }
+}
+
 void CsmVoice::Init(bool bInterrupt) {
-    // 使用するFM音源モジュール数
-    docks = ((CSM_N % 4 == 0) ? CSM_N / 4 : CSM_N / 4 + 1);
+    this->bInterrupt = bInterrupt;
 
     // 実際に使用するオペレータ数 (<= CSM_N)
-    operators = CSM_N;
+    operators = docks * 4;
     if (operators > CSM_N) operators = CSM_N;
-    if (operators < 4) operators = 4;
 
-    // 使用するFM音源モジュールのCH3を初期化
-    for (OpnBase* opn : modules) {
-        if (opn) {
-            init_ch3(*opn);
-        }
+    // CH3を共有しない場合は、ここでCH3をCSMモードにしたままにする
+    if (lender_count == 0) {
+        acquire();
     }
 
-    // フレーム周期をTimer Bに設定
-#ifdef ENABLE_INTERPOLATION
-    constexpr uint8_t nb = (uint8_t)(256 - 125 * (float)FRAME_PERIOD / (INTERPOLATE * 36));
-#else
-    constexpr uint8_t nb = (uint8_t)(256 - 125 * (float)FRAME_PERIOD / 36);
-#endif
+    // サブフレームの周期をTimer Bに設定
+    constexpr uint8_t nb = (uint8_t)(256 - TIMER_B_COUNT);
     modules[modTB]->set_timer_b(nb);
 
     // 割り込み駆動の場合
     if (bInterrupt) {
-        // 割り込み信号の接続先GPIOを選択
-        uint8_t gpio = FM_IRQ0;
-        switch (modTB) {
-        case 1:
-            gpio = FM_IRQ1;
-            break;
-        case 2:
-            gpio = FM_IRQ2;
-            break;
-        case 3:
-            gpio = FM_IRQ3;
-            break;
-        default:
-            break;
-        }
-        // コールバック処理をlambda式で登録
-        attach_isr_callback(gpio, [this]() { UpdateFrame(false); });
+        // コールバック処理を登録(キャプチャなしのlambda式とthisの組)
+        // (割り込みハンドラ内ではフレーム更新を要求するだけにする)
+        attach_isr_callback(
+            irq, [](void* ctx) { static_cast<CsmVoice*>(ctx)->on_timer_b(); }, this);
     }
 }
 
 void CsmVoice::UpdateFrame(bool isFirst) {
     if (isFirst) {
+        acquire();
         update(true);
     } else if (isLastFrame) {
         // 最終フレームなのでTimerB割り込み信号の発生を停止
-        modules[modTB]->set_timer_mode(0x30);
-        isLastFrame = false;
-        frame       = 0;
+        stop_frame();
     } else {
         // 2回目以降の更新処理
         update(false);
     }
 }
 
+void CsmVoice::on_timer_b() {
+    due_time  = time_us_32();
+    frame_due = true;
+}
+
+void CsmVoice::Poll() {
+    if (!bInterrupt && !frame_due && IsFrameOver()) {
+        on_timer_b();
+    }
+    if (!frame_due) {
+        return;
+    }
+    frame_due = false;
+
+    // 期限のチェック
+    // Timer Bのフラグは次のupdate()でリセットするので、それまでの間のオーバーフローは失われる
+    uint32_t latency = time_us_32() - due_time;
+    if (latency > DEADLINE_US) {
+        ++late_count;
+        missed_count += latency / (uint32_t)(TICK_PERIOD * 1000);
+    }
+    if (latency > max_latency) {
+        max_latency = latency;
+    }
+    ++frame_count;
+
+    UpdateFrame(false);
+}
+
 bool CsmVoice::IsFrameOver() {
     return modules[modTB]->read_status() & 0x02;
 }
@@ -174,6 +218,7 @@ void CsmVoice::Stop() {
             opn->set_timer_mode(0x30);
         }
     }
+    release();
 }
 
 void CsmVoice::init_ch3(OpnBase& opn) {
@@ -203,81 +248,82 @@ void CsmVoice::init_ch3(OpnBase& opn) {
     opn.fm_set_output_lr(ch3, 0xc0);  // LR両方に出力(YM2608の場合)
 }
 
+void CsmVoice::acquire() {
+    if (acquired) {
+        return;
+    }
+    // CH3のNoteVoiceをMIDI Channelから回収する
+    // 発音中の場合は、init_ch3()でTLを最小にするので即座に消音される
+    VoiceAllocator& allocator = VoiceAllocator::GetInstance();
+    for (int i = 0; i < lender_count; i++) {
+        allocator.Revoke(lenders[i]);
+    }
+    // 使用するFM音源モジュールのCH3をCSMモードにする
+    for (int d = 0; d < docks; d++) {
+        init_ch3(*modules[d]);
+    }
+    acquired = true;
+}
+
+void CsmVoice::release() {
+    if (!acquired || lender_count == 0) {
+        return;
+    }
+    // CH3を通常モードに戻してNoteVoiceに返却する
+    for (int d = 0; d < docks; d++) {
+        modules[d]->fm_turnoff_key(2);
+        modules[d]->set_timer_mode(0x30);
+        modules[d]->set_fmch3_mode(0);
+    }
+    for (int i = 0; i < lender_count; i++) {
+        lenders[i]->Return();
+    }
+    acquired = false;
+}
+
 bool CsmVoice::update(bool isFirst) {
+    PROFILE_SCOPE(CSM_UPDATE);
+    CsmPhraseBank& bank = CsmPhraseBank::GetInstance();
+
     // 初回呼び出し処理
     if (isFirst) {
-        interp_count = 0;
-        frame        = ve[key % num_of_voice].start;
-        lastFrame    = frame + ve[key % num_of_voice].length;
-        isLastFrame  = false;
-        data         = (struct frame_format){0};
+        const uint8_t* phrases = bank.GetBank(bk_program);
+        int count              = CsmPhraseDecoder::GetPhraseCount(phrases);
+        decoder.Start(phrases, count ? key % count : 0);
+        bank_rev    = bank.GetRevision();
+        frame       = 0;
+        isLastFrame = false;
+    } else if (bank_rev != bank.GetRevision()) {
+        // 再生中のフレーズバンクが書き換えられた
+        decoder.Stop();
     }
 
-    uint16_t pitch = frame_data[frame].Pitch;
-#if 1
-    if (frame == lastFrame) {
-        pitch &= 0x7fff;
-        isLastFrame = true;
-    }
-#else
-    // Pitchの最上位ビットが立っている場合は最終フレーム
-    if (pitch & 0x8000) {
-        pitch &= 0x7fff;
-        isLastFrame = true;
-    }
-#endif
-
-#ifdef ENABLE_INTERPOLATION
-    if (interp_count == 0) {
-        // 差分の計算
-        diff.Pitch = (pitch - data.Pitch) / INTERPOLATE;
-        for (int j = 0; j < operators; j++) {
-            diff.TL[j]   = (frame_data[frame].TL[j] - data.TL[j]) / INTERPOLATE;
-            diff.Freq[j] = (frame_data[frame].Freq[j] - data.Freq[j]) / INTERPOLATE;
+    // 前のフレームに達していたら次のフレームを読み出す
+    if (isFirst || interp.IsReached()) {
+        if (!decoder.Next()) {
+            stop_frame();
+            return true;
+        }
+        if (isFirst) {
+            interp.Start(decoder.GetValues());  // 最初のフレームは補間しない
+        } else {
+            interp.Target(decoder.GetValues());
         }
     }
 
-    // 線形補間
-    data.Pitch += diff.Pitch;
-    for (int j = 0; j < operators; j++) {
-        data.TL[j] += diff.TL[j];
-        data.Freq[j] += diff.Freq[j];
+    // サブフレームのレジスタ値を求める
+    uint16_t value[csm::FIELDS];
+    interp.Step(value);
+    if (interp.IsReached()) {
+        isLastFrame = decoder.IsLast();
+        frame++;
     }
-#endif
+    csm::Frame f;
+    csm::make_frame(value, f);
 
     // フレームパラメータの更新
     for (int d = 0; d < docks; d++) {
-#ifdef ENABLE_INTERPOLATION
-        modules[d]->set_timer_a(data.Pitch);  // ピッチ (Timer A)
-#else
-        modules[d]->set_timer_a(pitch);  // ピッチ (Timer A)
-#endif
-        for (uint8_t op = 0; op < 4; op++) {
-            int n = d * 4 + op;
-            if (n < operators) {
-#ifdef ENABLE_INTERPOLATION
-                uint8_t tl = data.TL[n];
-#else
-                uint8_t tl = frame_data[frame].TL[n];
-#endif
-                modules[d]->fm_set_total_level(2, op, tl);  // 振幅
-
-                uint16_t fnum = 0;
-                for (int blk = 5; blk >= 0; blk--) {
-                    // f = 72 * csm_f * (2**20) / 4000000 / (2 ** (blk - 1))
-#ifdef ENABLE_INTERPOLATION
-                    uint32_t f = ((uint32_t)38 * data.Freq[n]) >> blk;
-#else
-                    uint32_t f = ((uint32_t)38 * frame_data[frame].Freq[n]) >> blk;
-#endif
-                    if (f < 2048) {
-                        fnum = ((blk << 11) | f) & 0x3fff;
-                        break;
-                    }
-                }
-                modules[d]->fm_set_fnumber_ch3(op, fnum >> 8, fnum & 0xff);  // 周波数
-            }
-        }
+        modules[d]->write_registers(csm::DOCK_ADDRESS, f.dock[d], csm::dock_regs(d));
     }
 
     // Timer B(フレーム)とTimer A(ピッチ)をスタート
@@ -291,20 +337,25 @@ bool CsmVoice::update(bool isFirst) {
         }
     }
 
-#ifdef ENABLE_INTERPOLATION
-    if (interp_count++ == INTERPOLATE) {
-        interp_count = 0;
-        frame++;
-    }
     return isLastFrame;
-#else
-    frame++;
-    return isLastFrame;
-#endif
+}
+
+void CsmVoice::stop_frame() {
+    modules[modTB]->set_timer_mode(0x30);
+    isLastFrame = false;
+    frame       = 0;
+    release();
 }
 
 // Debug
-void CsmVoice::dump() {
-    printf("ID=%02d CH=%02d PG=%04x %04x VOL=%3d KEY=%3d TYPE=%s\n", id, GetChannel(),
-           bk_program >> 16, bk_program & 0xffff, volume, GetKey(), GetType() ? "CSM " : "Note");
+void CsmVoice::snapshot(VoiceState& s) {
+    Voice::snapshot(s);
+    s.dock_mask    = dock_mask;
+    s.operators    = operators;
+    s.acquired     = acquired;
+    s.frame_count  = frame_count;
+    s.late_count   = late_count;
+    s.missed_count = missed_count;
+    s.max_latency  = max_latency;
+    s.deadline     = DEADLINE_US;
 }
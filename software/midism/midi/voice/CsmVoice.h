@@ -8,41 +8,74 @@
 #include <array>
 #include <cstdint>
 
+#include "CsmFrameTable.h"
+#include "CsmInterpolator.h"
+#include "CsmPhraseDecoder.h"
 #include "OpnBase.h"
 #include "Voice.h"
+#include "config.h"
 
-// 音声データ
-#include "csm/VOICE.dat"
+class NoteVoice;
 
 class CsmVoice : public Voice {
 private:
-    std::array<OpnBase*, 4>& modules;
-    int operators;  // 使用するオペレータ数
-    int docks;      // 使用するFM音源モジュール数
-    int modTB;      // Timer Bを使用するFM音源モジュール
-
-    int frame;         // 現在再生中のフレーム
-    int interp_count;  // 現在の補間回数
-    int lastFrame;     // 最終フレーム
-    bool isLastFrame;  // 最終フレームフラグ
-
-    struct frame_format data;  // CSM音声データ
-    struct diff_format {
-        int16_t Pitch;
-        int16_t TL[CSM_N];
-        int16_t Freq[CSM_N];
-    };
-    struct diff_format diff;  // フレーム補完用データ
+    std::array<OpnBase*, MAX_DOCKS> modules;    // 使用するFM音源モジュール(先頭からdocks個)
+    uint8_t dock_mask;                          // 使用するDockのビットマップ
+    int operators;                              // 使用するオペレータ数
+    int docks;                                  // 使用するFM音源モジュール数
+    int modTB;                                  // Timer Bを使用するFM音源モジュール(modulesの添字)
+    int irq;                                    // Timer Bの割り込み信号を接続したGPIO
+    std::array<NoteVoice*, MAX_DOCKS> lenders;  // CH3を共有するNoteVoice(先頭からlender_count個)
+    int lender_count;                           // CH3を共有するNoteVoiceの数
+    bool acquired;                              // true:CH3をCSMモードで使用中
+
+    CsmPhraseDecoder decoder;  // 再生中のフレーズ
+    CsmInterpolator interp;    // フレーム間の補間
+    uint32_t bank_rev;         // 再生開始時のフレーズバンクの更新回数
+    int frame;                 // 再生したフレーム数
+    bool isLastFrame;          // 最終フレームフラグ
+
+    // フレーム更新の遅延処理
+    bool bInterrupt;             // true:割り込み駆動, false:ポーリング
+    volatile bool frame_due;     // Timer Bがオーバーフローしてフレーム更新待ち
+    volatile uint32_t due_time;  // Timer Bがオーバーフローした時刻(us)
+    uint32_t frame_count;        // DEBUG: 更新したフレーム数
+    uint32_t late_count;         // DEBUG: DEADLINE_USを超えて更新したフレーム数
+    uint32_t missed_count;       // DEBUG: 更新できずに読み飛ばしたフレーム数
+    uint32_t max_latency;        // DEBUG: オーバーフローから更新までの最大時間(us)
 
 public:
+    // Timer Bの周期(ms)
+    static constexpr float TICK_PERIOD = FRAME_PERIOD / CSM_SUBFRAMES;
+    // フレーム更新の期限(us)
+    // Timer Bのオーバーフローからこの時間内にフレームパラメータを更新する
+    static constexpr uint32_t DEADLINE_US = (uint32_t)(TICK_PERIOD * 1000) / 4;
+
     /**
      * @brief コンストラクタ
-     * @param modules   FM音源モジュールのリスト
+     * @param modules   FM音源モジュールのリスト(Dock順)
+     * @param mask      使用するDockのビットマップ(CSM_VOICE_DOCKS)
      * @param id        Voice ID (for debug)
+     * @details 実際に使用するDockはSelectDocks()で決める
      */
-    CsmVoice(std::array<OpnBase*, 4>& modules, int id);
+    CsmVoice(std::array<OpnBase*, MAX_DOCKS>& modules, uint8_t mask, int id);
     CsmVoice() = delete;
 
+    /**
+     * @brief 実際に使用するDockを求める
+     * @param modules   FM音源モジュールのリスト(Dock順)
+     * @param mask      使用するDockのビットマップ
+     * @return 使用するDockのビットマップ
+     * @details maskのうちFM音源モジュールが実装されたDockを、下位から最大csm::DOCKS個選ぶ。
+     *          最下位のDockに/IRQがない(Dock0-3でない)場合は0を返す
+     */
+    static uint8_t SelectDocks(const std::array<OpnBase*, MAX_DOCKS>& modules, uint8_t mask);
+
+    /**
+     * @brief 使用するDockのビットマップを返す
+     */
+    uint8_t GetDockMask() const { return dock_mask; }
+
     /**
      * @brief デストラクタ
      */
@@ -109,9 +142,18 @@ public:
      */
     void SetModulation(VoiceEffect& effect, uint8_t lr) override;
 
+    /**
+     * @brief CH3を共有するNoteVoiceを登録する
+     * @param voice 使用するDockのCH3のNoteVoice
+     * @details Init()の前に呼び出す。登録した場合、CH3は発音中だけCSMモードにし、
+     *          それ以外の間はNoteVoiceとして使えるようにする
+     */
+    void AddLender(NoteVoice* voice);
+
     /**
      * @brief CSMモードの動作設定を行う
      * @param bInterrupt  true:割り込み駆動, false:ポーリング
+     * @details CH3を共有するNoteVoiceがない場合は、ここでCH3をCSMモードにする
      */
     void Init(bool bInterrupt);
 
@@ -119,9 +161,19 @@ public:
      * @brief 再生開始とフレームの更新処理
      * @param isFirst true:再生開始, false:フレーム更新(2回目以降)
      * @details 2回目以降はTimer Bのオーバーフローごとに呼び出す。
+     *          Bank Select LSBでフレーズバンクを、Note番号でフレーズを選択する。
+     *          CSM_SUBFRAMES回の呼び出しごとにフレーズの次のフレームへ進む。
      */
     void UpdateFrame(bool isFirst);
 
+    /**
+     * @brief 更新待ちのフレームがあれば更新する
+     * @details メインループから呼び出す。割り込みハンドラではフレーム更新の要求だけを行い、
+     *          レジスタの書き込みはここで行う。
+     *          ポーリングの場合は、ここでTimer Bのオーバーフローを検出する。
+     */
+    void Poll();
+
     /** 
      * @brief フレームオーバーの検出
      * @return true:フレームオーバー
@@ -135,14 +187,32 @@ public:
     void Stop();
 
     // Debug
-    void dump() override;
+    void snapshot(VoiceState& s) override;
 
 private:
+    /**
+     * @brief Timer Bのオーバーフロー(割り込みハンドラ)
+     * @details フレーム更新を要求するだけで、FM音源モジュールにはアクセスしない
+     */
+    void on_timer_b();
+
     /**
      *  @brief CH3の初期化
      */
     void init_ch3(OpnBase& opn);
 
+    /**
+     * @brief CH3をCSMモードにする
+     * @details CH3を共有するNoteVoiceを回収し、発音を止めてからCSMモードにする
+     */
+    void acquire();
+
+    /**
+     * @brief CH3を通常モードに戻す
+     * @details CH3を共有するNoteVoiceがある場合に限り、NoteVoiceにCH3を返却する
+     */
+    void release();
+
     /** 
      * @brief フレームパラメータの更新
      * @param isFirst true:最初のフレームから再生する
@@ -150,4 +220,10 @@ private:
      * @details 最終フレームなら、次回のTimer Bのオーバーフローで再生を終了する
      */
     bool update(bool isFirst);
+
+    /**
+     * @brief フレームの更新を停止する
+     * @details TimerBの割り込み信号の発生を停止し、CH3を返却する
+     */
+    void stop_frame();
 };
@@ -12,7 +12,10 @@
 #include <cstdlib>
 #include <vector>
 
-#include "Debugger.h"
+#include "Latency.h"
+#include "Profile.h"
+#include "ToneBank.h"
+#include "Trace.h"
 
 /**
  * @brief  OPN TL(Total Level)音量テーブル
@@ -60,41 +63,81 @@ static constexpr uint16_t fnum[16] = {
     0x051c,  // C# (+2)
 };
 
-NoteVoice::NoteVoice(OpnBase& module, uint8_t ch, int id)
+uint32_t NoteVoice::tone_load_count = 0;
+
+NoteVoice::NoteVoice(OpnBase& module, uint8_t ch, int id, bool lendable)
     : Voice(false, id),  // NoteType
       module(module),
-      fm_ch(ch) {
-    SetProgram(0);   // デフォルト音色
-    SetVolume(100);  // デフォルト音量
+      fm_ch(ch),
+      tone(nullptr),
+      tone_rev(0),
+      lendable(lendable),
+      lent(false),
+      pbv(0) {
+    // 音色は未設定(bk_program=-1)とし、最初のNoteOnで設定する
+    // FM音源モジュールのinit()で消音済みなので、ここではレジスタに書き込まない
 }
 
 NoteVoice::~NoteVoice() {
 }
 
 void NoteVoice::Reset() {
-    // コンストラクタと同じ設定にする
-    // 外部キーボードから使用するときなどのために音色をデフォルトに戻しておく
+    // コンストラクタと同じ設定にする(キーオフして音色を未設定にする)
+    // 音色は次のNoteOnでMIDIチャンネルの音色を設定するので、ここでは消音だけ行う
     Voice::Reset();
-    SetProgram(0);
-    SetVolume(100);
+    mute();
     pbv = 0;
 }
 
+void NoteVoice::mute() {
+    // リリース中の音も止めるため、全オペレータのTLを最小(-96dB)にする
+    for (int op = 0; op < 4; op++) {
+        module.fm_set_total_level(fm_ch, op, 0x7f);
+    }
+    tone = nullptr;
+}
+
 int NoteVoice::GetModuleId() {
     return module.id;
 }
 
+void NoteVoice::Lend() {
+    module.fm_turnoff_key(fm_ch);
+    SetNoteOnCount(0);
+    busy_end();
+    SetChannel(-1);
+    lent = true;
+}
+
+void NoteVoice::Return() {
+    lent       = false;
+    bk_program = -1;  // 音色を設定し直す
+    volume     = -1;
+    key        = -1;  // ピッチを設定し直す
+}
+
 void NoteVoice::SetProgram(int32_t no) {
-    if (bk_program != no) {
-        module.fm_set_tone(fm_ch, no & 0xff);
+    PROFILE_SCOPE(SET_PROGRAM);
+    ToneBank& bank = ToneBank::GetInstance();
+    if (bk_program != no || tone_rev != bank.GetRevision()) {
+        tone = bank.GetTone(no);
+        module.fm_set_tone(fm_ch, tone);
+        ++tone_load_count;
+        LATENCY_TONE_LOAD();
         bk_program = no;
-        DPRINTF(2, " P%04x:%d ", no >> 16, no & 0xff);
+        tone_rev   = bank.GetRevision();
+        volume     = -1;  // 音色データのTLで上書きされたので、音量を再設定させる
+        TRACE(TONE_LOAD, id, no >> 16, no & 0xff);
     }
 }
 
 void NoteVoice::SetVolume(int vol) {
+    if (vol < 0 || tone == nullptr) {
+        // -1:音色のTLを維持する, 音色が未設定の場合は次のSetProgram()の後で設定する
+        return;
+    }
     if (volume != vol) {
-        module.fm_set_volume(fm_ch, bk_program, opn_volume[vol]);
+        module.fm_set_volume(fm_ch, tone, opn_volume[vol]);
         volume = vol;
     }
 }
@@ -109,14 +152,17 @@ void NoteVoice::NoteOn(int note, int32_t bk_program, int volume, VoiceEffect& ef
     module.fm_turnon_key(fm_ch);
     SetModulation(effect, lr);
     IncrementNoteOnCount();
+    busy_begin();
 }
 
 void NoteVoice::NoteOff() {
     module.fm_turnoff_key(fm_ch);
     SetNoteOnCount(0);
+    busy_end();
 }
 
 void NoteVoice::SetPitch(VoiceEffect& effect) {
+    PROFILE_SCOPE(SET_PITCH);
     //  以下の理由でkey == -1のチェックは不要
     //  - NoteOn()からは、keyがセットされた後で呼ばれる。
     //  - NoteChannelからは、KeyOnのVoiceとして呼ばれる。
@@ -215,7 +261,7 @@ void NoteVoice::SetPitch(VoiceEffect& effect) {
     }
 
     module.fm_set_pitch(fm_ch, k - PBS_MARGIN, oct, diff);
-    DPRINTF(1, " PB k=%d, diff=%d ", pbkey, diff);
+    TRACE(PITCH, id, pbkey, diff);
 }
 
 void NoteVoice::SetModulation(VoiceEffect& effect, uint8_t lr) {
@@ -229,8 +275,10 @@ void NoteVoice::SetModulation(VoiceEffect& effect, uint8_t lr) {
 }
 
 // Debug
-void NoteVoice::dump() {
-    printf("ID=%02d CH=%02d PG=%04x %04x VOL=%3d KEY=%3d TYPE=%s OPN=%d-%d\n", id, GetChannel(),
-           bk_program >> 16, bk_program & 0xffff, volume, GetKey(), GetType() ? "CSM " : "Note",
-           module.id, fm_ch);
+void NoteVoice::snapshot(VoiceState& s) {
+    Voice::snapshot(s);
+    s.module   = module.id;
+    s.fm_ch    = fm_ch;
+    s.lendable = lendable;
+    s.lent     = lent;
 }
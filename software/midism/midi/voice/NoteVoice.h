@@ -15,16 +15,23 @@ class NoteVoice : public Voice {
 private:
     OpnBase& module;      // FM module
     const uint8_t fm_ch;  // FM moduleのChannel No.
+    const uint8_t* tone;  // 設定中の音色データ(nullptr:未設定)
+    uint32_t tone_rev;    // 設定中の音色データの更新回数(ToneBank)
+    const bool lendable;  // true:CSM VoiceとCH3を共有する
+    bool lent;            // true:CH3をCSM Voiceに貸し出し中
     int16_t pbv;          // PitchBend値
 
+    static uint32_t tone_load_count;  // DEBUG: 音色パラメータを設定した回数(全Voice)
+
 public:
     /**
      * @brief コンストラクタ
-     * @param module FM音源モジュール
-     * @param ch     FM音源モジュールのチャンネル番号
-     * @param id     Voice ID (for debug)
+     * @param module   FM音源モジュール
+     * @param ch       FM音源モジュールのチャンネル番号
+     * @param id       Voice ID (for debug)
+     * @param lendable true:CSM VoiceとCH3を共有する
      */
-    NoteVoice(OpnBase& module, uint8_t ch, int id);
+    NoteVoice(OpnBase& module, uint8_t ch, int id, bool lendable = false);
     NoteVoice() = delete;
 
     /**
@@ -34,6 +41,8 @@ public:
 
     /**
      * @brief Voice内部状態をリセットする
+     * @details キーオフとTLの最小化で消音し、音色を未設定にする。
+     *          音色は次のNoteOnで設定するので、MIDIリセットで音色を転送しない
      */
     void Reset() override;
 
@@ -43,17 +52,35 @@ public:
      */
     int GetModuleId() override;
 
+    bool IsLendable() override { return lendable; }
+    bool IsAvailable() override { return !lent; }
+
+    /**
+     * @brief CH3をCSM Voiceに貸し出す
+     * @details 発音を止めてMIDIチャンネルへの割り当てを解除し、返却されるまで割り当て不可にする。
+     *          VoiceAllocator::Revoke()から呼び出す
+     */
+    void Lend();
+
+    /**
+     * @brief CSM VoiceからCH3が返却された
+     * @details CSMモードで書き換えられた音色とピッチを、次のNoteOnで設定し直させる
+     */
+    void Return();
+
     /**
      * @brief MIDI Program(音色)のセット
-     * @param no MIDI Program No. (0-127)
-     * @details 現在のProgram値から更新された場合に限り、音色パラメータをセットする
+     * @param no MIDI Bank/Program No.
+     * @details 現在のProgram値から更新された場合か、ToneBankの音色が更新された場合に限り、
+     *          音色パラメータをセットする
      */
     void SetProgram(int32_t no) override;
 
     /**
      * @brief MIDI Volumeのセット
-     * @param vol MIDI Volume (0-127)
-     * @details 現在のVolume値から更新された場合に限り、音量をセットする
+     * @param vol MIDI Volume (0-127, -1:音色のTotal Levelを維持する)
+     * @details 現在のVolume値から更新された場合に限り、音量をセットする。
+     *          音色が未設定の場合は何もしない
      */
     void SetVolume(int vol) override;
 
@@ -94,5 +121,13 @@ public:
     void SetModulation(VoiceEffect& effect, uint8_t lr) override;
 
     // Debug
-    void dump() override;
+    void snapshot(VoiceState& s) override;
+    static uint32_t GetToneLoadCount() { return tone_load_count; }
+    static void ResetToneLoadCount() { tone_load_count = 0; }
+
+private:
+    /**
+     * @brief 全オペレータのTLを最小にして消音し、音色を未設定にする
+     */
+    void mute();
 };
@@ -0,0 +1,206 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#include "ToneBank.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "Debugger.h"
+#if ENABLE_TONE_BANK_FLASH == 1
+#include "RP2040.h"
+#endif
+
+ToneBank& ToneBank::GetInstance() {
+    static ToneBank instance;
+    return instance;
+}
+
+ToneBank::ToneBank()
+    : revision(0), rx_slot(-1), rx_records(0), rx_errors(0), rx_clear_msb(0xff) {
+    // 全てのバンクをプリセット音色にする
+    for (auto& bank : bank_table) {
+        bank = OpnBase::fm_tone_table;
+    }
+    user.magic = MAGIC;
+    user.size  = sizeof(user);
+    memset(user.msb, -1, sizeof(user.msb));
+#if ENABLE_TONE_BANK_FLASH == 1
+    Load();
+#endif
+}
+
+void ToneBank::Clear(uint8_t msb) {
+    msb &= 0x7f;
+    for (int i = 0; i < USER_TONE_BANKS; i++) {
+        if (user.msb[i] == msb) {
+            user.msb[i] = -1;
+        }
+    }
+    bank_table[msb] = OpnBase::fm_tone_table;
+    ++revision;
+}
+
+bool ToneBank::Store() {
+#if ENABLE_TONE_BANK_FLASH == 1
+    static_assert(sizeof(UserTones) <= FLASH_STORAGE_SIZE, "USER_TONE_BANKS is too large");
+    return flash_storage_write(FLASH_AREA_TONE_BANK, &user, sizeof(user));
+#else
+    return false;
+#endif
+}
+
+bool ToneBank::Load() {
+#if ENABLE_TONE_BANK_FLASH == 1
+    const UserTones* image = (const UserTones*)flash_storage_ptr(FLASH_AREA_TONE_BANK);
+    if (image->magic != MAGIC || image->size != sizeof(UserTones)) {
+        return false;
+    }
+    for (int i = 0; i < USER_TONE_BANKS; i++) {
+        if (image->msb[i] < -1) {
+            return false;
+        }
+    }
+    memcpy(&user, image, sizeof(user));
+    for (int i = 0; i < USER_TONE_BANKS; i++) {
+        if (user.msb[i] >= 0) {
+            bank_table[user.msb[i]] = user.tones[i];
+        }
+    }
+    ++revision;
+    return true;
+#else
+    return false;
+#endif
+}
+
+int ToneBank::bind(uint8_t msb) {
+    msb &= 0x7f;
+    int slot = -1;
+    for (int i = 0; i < USER_TONE_BANKS; i++) {
+        if (user.msb[i] == msb) {
+            return i;  // 既に割り当て済み
+        }
+        if (slot < 0 && user.msb[i] < 0) {
+            slot = i;
+        }
+    }
+    if (slot < 0) {
+        return -2;  // 空きなし
+    }
+    // 送られてこない音色はプリセットのままにするため、現在の音色をコピーしてから割り当てる
+    memcpy(user.tones[slot], bank_table[msb], sizeof(user.tones[slot]));
+    user.msb[slot]  = msb;
+    bank_table[msb] = user.tones[slot];
+    return slot;
+}
+
+bool ToneBank::decode(const uint8_t* record, Tone& tone, uint8_t& program) {
+    // チェックサム: レコード全体の和の下位7bitが0
+    uint8_t sum = 0;
+    for (int i = 0; i < RECORD_SIZE; i++) {
+        sum += record[i];
+    }
+    if ((sum & 0x7f) != 0 || record[0] >= BANK_SIZE) {
+        return false;
+    }
+    program                = record[0];
+    const uint8_t* nibbles = &record[1];
+    for (int i = 0; i < TONE_SIZE; i++) {
+        tone[i] = (nibbles[i * 2] << 4) | (nibbles[i * 2 + 1] & 0x0f);
+    }
+    return true;
+}
+
+void ToneBank::SysExBegin(int tag) {
+    if (!rx_owner.Acquire(tag)) {
+        return;  // 他の入力元が受信中
+    }
+    rx_slot      = -1;
+    rx_records   = 0;
+    rx_errors    = 0;
+    rx_clear_msb = 0xff;
+}
+
+int ToneBank::SysExData(int tag, const uint8_t* data, int len) {
+    if (!rx_owner.Owns(tag)) {
+        return len;
+    }
+    tag = sysex_tag_value(tag);
+    if (tag == TONE_CLEAR) {
+        rx_clear_msb = data[0];
+        return len;
+    }
+    if (tag != TONE_DUMP) {
+        return len;
+    }
+
+    int n = 0;
+    if (rx_slot == -1) {
+        // 先頭の1バイトは書き込み先のBank Select MSB
+        rx_slot = bind(data[n++]);
+    }
+    if (rx_slot < 0) {
+        return len;  // 割り当てられなかったので読み捨て
+    }
+    // 揃ったレコードから書き込む(端数はパーサに残しておく)
+    while (len - n >= RECORD_SIZE) {
+        Tone tone;
+        uint8_t program;
+        if (decode(&data[n], tone, program)) {
+            memcpy(user.tones[rx_slot][program], tone, TONE_SIZE);
+            ++rx_records;
+        } else {
+            ++rx_errors;
+        }
+        n += RECORD_SIZE;
+    }
+    return n;
+}
+
+void ToneBank::SysExEnd(int tag, bool complete) {
+    if (!rx_owner.Release(tag)) {
+        DPRINTF(1, "TONE: busy (source=%d)\n", sysex_tag_source(tag));
+        return;
+    }
+    switch (sysex_tag_value(tag)) {
+    case TONE_DUMP:
+        if (rx_records) {
+            ++revision;  // 発音中のVoiceは次のNoteOnで音色を再設定する
+        }
+        DPRINTF(1, "TONE DUMP: slot=%d records=%d errors=%d %s\n", rx_slot, rx_records,
+                rx_errors, complete ? "" : "(aborted)");
+        break;
+    case TONE_STORE:
+        if (complete) {
+            bool result = Store();
+            DPRINTF(1, "TONE STORE: %s\n", result ? "OK" : "NG");
+        }
+        break;
+    case TONE_CLEAR:
+        if (complete && rx_clear_msb < 0x80) {
+            Clear(rx_clear_msb);
+        }
+        break;
+    }
+}
+
+// Debug
+void ToneBank::snapshot(ToneBankState& s) const {
+    s.revision = revision;
+    memcpy(s.msb, user.msb, sizeof(s.msb));
+}
+
+void ToneBank::print(const ToneBankState& s) {
+    printf("\n=== Tone Bank (rev=%d) ===\n", s.revision);
+    for (int i = 0; i < USER_TONE_BANKS; i++) {
+        if (s.msb[i] >= 0) {
+            printf("USER%d: MSB=%3d\n", i, s.msb[i]);
+        } else {
+            printf("USER%d: ---\n", i);
+        }
+    }
+}
@@ -0,0 +1,138 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include <cstdint>
+
+#include "OpnBase.h"
+#include "SysExParser.h"
+#include "config.h"
+
+/**
+ * @brief ユーザー音色の割り当て状況(デバッグ用)
+ */
+struct ToneBankState {
+    uint32_t revision;            // 音色データの更新回数
+    int8_t msb[USER_TONE_BANKS];  // 割り当てたBank Select MSB (-1:未使用)
+};
+
+/**
+ * @brief FM音色バンク
+ * @details シングルトンクラス
+ * Bank Select MSBごとに128音色分のテーブルへのポインタを持ち、
+ * bk_programから音色データをO(1)で参照する。
+ * 初期状態では全てのバンクがOpnBaseのプリセット音色(ROM)を指す。
+ * SysExでアップロードされたバンクはRAM上のユーザー音色に割り当てられ、
+ * 必要に応じてFlashに保存される。
+ */
+class ToneBank : public SysExHandler {
+public:
+    static constexpr int TONE_SIZE      = OpnBase::FM_TONE_SIZE;    // 1音色のバイト数
+    static constexpr int BANK_SIZE      = OpnBase::MAXNUM_FM_TONE;  // 1バンクの音色数
+    static constexpr int NUM_BANKS      = 128;                      // Bank Select MSB
+    static constexpr int RECORD_SIZE    = 2 + TONE_SIZE * 2;        // ダンプの1音色分のバイト数
+
+    /**
+     * @brief SysExのタグ
+     */
+    enum Command {
+        TONE_DUMP,   // 音色ダンプ
+        TONE_STORE,  // Flashへの保存
+        TONE_CLEAR,  // バンクをプリセットに戻す
+    };
+    // $F0に続くID (非営利ID $7D, モデルID $46, コマンド)
+    static constexpr uint8_t DUMP_ID[]  = {0x7d, 0x46, 0x01};
+    static constexpr uint8_t STORE_ID[] = {0x7d, 0x46, 0x02};
+    static constexpr uint8_t CLEAR_ID[] = {0x7d, 0x46, 0x03};
+
+private:
+    using Tone = uint8_t[TONE_SIZE];
+
+    /**
+     * @brief ユーザー音色(Flashへの保存イメージと同じ配置)
+     */
+    struct UserTones {
+        uint32_t magic;                          // 識別子
+        uint32_t size;                           // 構造体のサイズ
+        int8_t msb[USER_TONE_BANKS];             // 割り当てたBank Select MSB (-1:未使用)
+        Tone tones[USER_TONE_BANKS][BANK_SIZE];  // 音色データ
+    };
+    static constexpr uint32_t MAGIC = 0x454e4f54;  // "TONE"
+
+    const Tone* bank_table[NUM_BANKS];  // MSB -> 音色テーブル
+    UserTones user;                     // ユーザー音色
+    uint32_t revision;                  // 音色データの更新回数
+
+    // 受信中の音色ダンプ
+    int rx_slot;           // 書き込み先のユーザー音色 (-1:MSB待ち, -2:無効)
+    uint32_t rx_records;   // 受信したレコード数
+    uint32_t rx_errors;    // チェックサムエラーのレコード数
+    uint8_t rx_clear_msb;  // TONE_CLEARの対象MSB (0xff:未受信)
+    SysExOwner rx_owner;   // 受信中の入力元
+
+    ToneBank();
+    ~ToneBank() = default;
+
+public:
+    ToneBank(const ToneBank&)            = delete;
+    ToneBank& operator=(const ToneBank&) = delete;
+    ToneBank(ToneBank&&)                 = delete;
+    ToneBank& operator=(ToneBank&&)      = delete;
+
+    /**
+     * @brief ToneBankのインスタンスを取得する
+     * @return ToneBankのインスタンス
+     */
+    static ToneBank& GetInstance();
+
+    /**
+     * @brief 音色データを返す
+     * @param bk_program MIDI Bank/Program No. (MSB:bit31-24, LSB:bit23-16, Program:bit15-0)
+     * @return 音色データ(TONE_SIZEバイト)
+     * @details Bank Select LSBは参照しない
+     */
+    const uint8_t* GetTone(int32_t bk_program) const {
+        return bank_table[(bk_program >> 24) & 0x7f][bk_program & 0x7f];
+    }
+
+    /**
+     * @brief 音色データの更新回数を返す
+     * @details Voiceは、この値が変化したら音色を再設定する
+     */
+    uint32_t GetRevision() const { return revision; }
+
+    /**
+     * @brief バンクをプリセット音色に戻す
+     * @param msb Bank Select MSB (0-127)
+     */
+    void Clear(uint8_t msb);
+
+    /**
+     * @brief ユーザー音色をFlashに保存する
+     * @return true:成功
+     * @details ENABLE_TONE_BANK_FLASHが無効の場合は何もしない
+     */
+    bool Store();
+
+    /**
+     * @brief Flashからユーザー音色を読み込む
+     * @return true:成功
+     */
+    bool Load();
+
+    // SysExHandler (tagはsysex_tag(入力元, Command))
+    void SysExBegin(int tag) override;
+    int SysExData(int tag, const uint8_t* data, int len) override;
+    void SysExEnd(int tag, bool complete) override;
+
+    // Debug
+    void snapshot(ToneBankState& s) const;
+    static void print(const ToneBankState& s);
+
+private:
+    int bind(uint8_t msb);
+    bool decode(const uint8_t* record, Tone& tone, uint8_t& program);
+};
@@ -6,8 +6,25 @@
 //
 #include "Voice.h"
 
+#include <cstdio>
+#include <cstring>
+
+#include "hardware/timer.h"
+
 Voice::Voice(bool type, int id)
-    : type(type), note_on_count(0), midi_ch(-1), bk_program(-1), volume(-1), key(-1), id(id) {
+    : note_on_count(0),
+      type(type),
+      midi_ch(-1),
+      busy(false),
+      busy_at(0),
+      busy_us(0),
+      queue(nullptr),
+      queue_prev(nullptr),
+      queue_next(nullptr),
+      bk_program(-1),
+      volume(-1),
+      key(-1),
+      id(id) {
 }
 
 Voice::~Voice() {
@@ -20,6 +37,7 @@ void Voice::Reset() {
     volume        = -1;
     key           = -1;
     note_on_count = 0;
+    busy_us       = 0;  // NoteOff()で累積した分も含めてクリアする
 }
 
 bool Voice::GetType() {
@@ -30,6 +48,14 @@ bool Voice::IsFree() {
     return midi_ch == -1;
 }
 
+bool Voice::IsLendable() {
+    return false;
+}
+
+bool Voice::IsAvailable() {
+    return true;
+}
+
 int Voice::GetChannel() {
     return midi_ch;
 }
@@ -61,6 +87,47 @@ int Voice::DecrementNoteOnCount() {
     return note_on_count;
 }
 
-void Voice::dump() {
-    // Debug implementation
+void Voice::busy_begin() {
+    if (!busy) {
+        busy    = true;
+        busy_at = time_us_32();
+    }
+}
+
+void Voice::busy_end() {
+    if (busy) {
+        busy = false;
+        busy_us += time_us_32() - busy_at;
+    }
+}
+
+uint32_t Voice::GetBusyTime() {
+    uint64_t us = busy_us;
+    if (busy) {
+        us += time_us_32() - busy_at;
+    }
+    return us / 1000;
+}
+
+void Voice::snapshot(VoiceState& s) {
+    memset(&s, 0, sizeof(s));
+    s.id         = id;
+    s.channel    = midi_ch;
+    s.csm        = type;
+    s.bk_program = bk_program;
+    s.volume     = volume;
+    s.key        = key;
+    s.busy_ms    = GetBusyTime();
+}
+
+void Voice::print(const VoiceState& s) {
+    printf("ID=%02d CH=%02d PG=%04x %04x VOL=%3d KEY=%3d TYPE=%s", s.id, s.channel,
+           s.bk_program >> 16, s.bk_program & 0xffff, s.volume, s.key, s.csm ? "CSM " : "Note");
+    if (!s.csm) {
+        printf(" OPN=%d-%d%s\n", s.module, s.fm_ch, s.lent ? " LENT" : (s.lendable ? " LEND" : ""));
+    } else {
+        printf("\n      DOCK=%x OP=%d CH3=%s FRAME=%d LATE=%d MISSED=%d MAX=%dus (DEADLINE=%dus)\n",
+               s.dock_mask, s.operators, s.acquired ? "CSM" : "Note", s.frame_count, s.late_count,
+               s.missed_count, s.max_latency, s.deadline);
+    }
 }
@@ -7,6 +7,11 @@
 #pragma once
 #include <cstdint>
 
+#include "config.h"
+
+// Voiceの最大数(Dock数 x FMチャンネル数 + CSM Voice)
+constexpr int MAX_VOICES = MAX_DOCKS * FM_CHANNELS_PER_DOCK + CSM_VOICES;
+
 /**
  * @brief RPN/NRPN設定管理
  */
@@ -32,14 +37,53 @@ public:
     }
 };
 
+/**
+ * @brief Voiceの状態のスナップショット(デバッグ表示用)
+ * @details Core0で取得し、Core1で表示する。ポインタを含まないのでそのままコピーできる
+ */
+struct VoiceState {
+    int id;                 // Voice ID
+    int channel;            // 属しているMIDI Channel No.
+    bool csm;               // true:CsmVoice, false:NoteVoice
+    int32_t bk_program;     // Bank/Program No.
+    int volume;             // MIDI Volume
+    int key;                // Note No.
+    // NoteVoice
+    int module;             // FM音源モジュールのID
+    int fm_ch;              // FM音源のチャンネル
+    bool lendable;          // true:CH3をCSM Voiceと共有する
+    bool lent;              // true:CH3をCSM Voiceに貸し出し中
+    // CsmVoice
+    uint8_t dock_mask;      // 使用するDockのビットマップ
+    int operators;          // 使用するオペレータ数
+    bool acquired;          // true:CH3をCSMモードで使用中
+    uint32_t frame_count;   // 更新したフレーム数
+    uint32_t late_count;    // DEADLINE_USを超えて更新したフレーム数
+    uint32_t missed_count;  // 更新できずに読み飛ばしたフレーム数
+    uint32_t max_latency;   // オーバーフローから更新までの最大時間(us)
+    uint32_t deadline;      // DEADLINE_US
+    uint32_t busy_ms;       // キーオンからキーオフまでの累積時間(ms)
+};
+
+class VoiceQueue;
+
 /**
  * @brief Voice class
  */
 class Voice {
+    friend class VoiceQueue;
+
 private:
     int note_on_count;  // NoteOn回数 (Keyオーバーラップ時のカウント用)
     const bool type;    // true:CsmVoice, false:NoteVoice
     int midi_ch;        // 属しているMIDI Channel No.
+    bool busy;          // キーオン中
+    uint32_t busy_at;   // キーオンした時刻(us)
+    uint64_t busy_us;   // キーオンからキーオフまでの累積時間(us)
+    // VoiceQueueのリンク
+    VoiceQueue* queue;  // 属しているキュー(nullptr:なし)
+    Voice* queue_prev;  // 前のVoice
+    Voice* queue_next;  // 次のVoice
 
 protected:
     int32_t bk_program;  // Bank/Program No.
@@ -49,6 +93,18 @@ protected:
     int volume;          // MIDI Volume (0:min - 127:max)
     int key;             // Note No. (0-127)
 
+    /**
+     * @brief キーオンの時刻を記録する
+     * @details 派生クラスのNoteOn()から呼び出す
+     */
+    void busy_begin();
+
+    /**
+     * @brief キーオンからの時間を累積する
+     * @details 派生クラスのNoteOff()から呼び出す。キーオン中でなければ何もしない
+     */
+    void busy_end();
+
 public:
     const int id;  // デバッグ用
 
@@ -83,6 +139,18 @@ public:
      */
     bool IsFree();
 
+    /**
+     * @brief CSM VoiceとCH3を共有するVoiceかどうかを返す
+     * @return true:CSM Voiceに貸し出すCH3のNoteVoice
+     */
+    virtual bool IsLendable();
+
+    /**
+     * @brief 割り当て可能かどうかを返す
+     * @return false:CH3をCSM Voiceに貸し出し中
+     */
+    virtual bool IsAvailable();
+
     /**
      * @brief Voiceの割り当て先MIDIチャンネルを返す
      * @return MIDI Channel No.
@@ -128,6 +196,13 @@ public:
      */
     int DecrementNoteOnCount();
 
+    /**
+     * @brief キーオンしていた累積時間を返す
+     * @return 累積時間(ms, キーオン中の時間を含む)
+     * @details Reset()でクリアする
+     */
+    uint32_t GetBusyTime();
+
     /**
      * @brief Module IDを返す
      * @return Module ID
@@ -184,5 +259,17 @@ public:
      */
     virtual void SetModulation(VoiceEffect& effect, uint8_t lr) = 0;
 
-    virtual void dump();
+    // Debug
+    /**
+     * @brief 内部状態のスナップショットを取得する
+     * @param s 取得先
+     */
+    virtual void snapshot(VoiceState& s);
+
+    /**
+     * @brief スナップショットを表示する
+     * @param s スナップショット
+     * @details Voiceにアクセスしないので、スナップショットを取得したコア以外から呼び出せる
+     */
+    static void print(const VoiceState& s);
 };
@@ -7,6 +7,10 @@
 #include "VoiceAllocator.h"
 
 #include "Debugger.h"
+#include "Profile.h"
+#include "config.h"
+#include "hardware/timer.h"
+#include "pico/stdlib.h"
 
 VoiceAllocator& VoiceAllocator::GetInstance() {
     static VoiceAllocator instance;
@@ -14,34 +18,50 @@ VoiceAllocator& VoiceAllocator::GetInstance() {
 }
 
 void VoiceAllocator::AddVoice(Voice* voice) {
-    voice_pool.push_back(voice);
+    if (!voice_pool.Push(voice)) {
+        panic("VoiceAllocator: too many voices (MAX_VOICES=%d)", MAX_VOICES);
+    }
 }
 
 void VoiceAllocator::DeleteAllVoices() {
-    for (auto& voice : voice_pool) {
-        delete voice;
-    }
-    voice_pool.clear();
+    voice_pool.Clear();
 }
 
 void VoiceAllocator::AddObserver(int channel, MidiChannelObserver* observer) {
-    observers.push_back({channel, observer});
+    if (!observers.Push({channel, observer})) {
+        panic("VoiceAllocator: too many observers");
+    }
 }
 
 void VoiceAllocator::DeleteAllObserver() {
-    observers.clear();
+    observers.Clear();
 }
 
-Voice* VoiceAllocator::AllocateVoice(int channel, int mid, bool type) {
+Voice* VoiceAllocator::AllocateVoice(int channel, int mid, bool type, AllocStats::Path& path) {
+    PROFILE_SCOPE(ALLOCATE_VOICE);
     Voice* candidate = nullptr;
+    Voice* lendable  = nullptr;  // CSM VoiceとCH3を共有するVoiceの候補
+
+    // チャンネルが属するケーブルで使用できるDock
+    // (CsmVoiceはCSM_VOICE_DOCKSでDockを割り当てるので対象外)
+    uint32_t docks = type ? 0xffffffff : MIDI_CABLE_DOCKS[channel / MIDI_CHANNELS];
 
     // note_voice_poolから未割り当てのVoiceを探す
     for (auto* voice : voice_pool) {
-        if (voice->IsFree() && voice->GetType() == type) {
+        if (voice->IsFree() && voice->IsAvailable() && voice->GetType() == type &&
+            ((docks >> voice->GetModuleId()) & 1)) {
+            if (voice->IsLendable()) {
+                // CSMモードへの切り替えで途切れるので後回しにする
+                if (lendable == nullptr || voice->GetModuleId() == mid) {
+                    lendable = voice;
+                }
+                continue;
+            }
             // 未割り当てのVoiceがあった
             candidate = voice;
             if (mid == -1 || candidate->GetModuleId() == mid) {
                 voice->SetChannel(channel);
+                path = AllocStats::POOL;
                 return voice;
             }
         }
@@ -50,10 +70,11 @@ Voice* VoiceAllocator::AllocateVoice(int channel, int mid, bool type) {
     // 優先度の低いMIDI Channelから依頼する
     for (auto it = observers.rbegin(); it != observers.rend(); ++it) {
         if (it->channel != channel) {
-            auto voice = it->observer->Release(mid, type);
+            auto voice = it->observer->Release(mid, type, docks);
             if (voice) {
                 // 未使用Voiceがあった
                 voice->SetChannel(channel);
+                path = AllocStats::STEAL;
                 return voice;
             }
         }
@@ -61,19 +82,44 @@ Voice* VoiceAllocator::AllocateVoice(int channel, int mid, bool type) {
     if (candidate) {
         // note_voice_poolで見つかった候補を返す
         candidate->SetChannel(channel);
+        path = AllocStats::POOL;
         return candidate;
     }
+    if (lendable) {
+        // CSM VoiceとCH3を共有するVoiceを返す
+        lendable->SetChannel(channel);
+        path = AllocStats::POOL;
+        return lendable;
+    }
     // 未使用Voiceがなかった
-    ++failed_count;
+    ++stats.path[AllocStats::FAILED];
+    path = AllocStats::FAILED;
     return nullptr;
 }
 
+void VoiceAllocator::Revoke(NoteVoice* voice) {
+    if (!voice->IsFree()) {
+        // 割り当て先のMIDI Channelから外す
+        for (auto& info : observers) {
+            if (info.channel == voice->GetChannel()) {
+                if (info.observer->Revoke(voice)) {
+                    ++stats.revoke_cut;
+                }
+                break;
+            }
+        }
+    }
+    voice->Lend();
+    ++stats.revoke;
+}
+
 /**
  * @brief Voiceを解放する
  * @details MIDI Channelに割り当て済みのVoiceを解放し、全Voiceをリセットする
  */
 void VoiceAllocator::Reset() {
-    failed_count = 0;
+    stats          = {};
+    stats.start_ms = time_us_64() / 1000;
     // Channelに割り当て済みのVoiceを強制解放
     for (auto& info : observers) {
         info.observer->ReleaseAll();
@@ -82,18 +128,52 @@ void VoiceAllocator::Reset() {
     for (auto& voice : voice_pool) {
         voice->Reset();
     }
+    NoteVoice::ResetToneLoadCount();  // Reset()での音色設定は数えない
+}
+
+void VoiceAllocator::Reset(int cable) {
+    int first = cable * MIDI_CHANNELS;
+    int last  = first + MIDI_CHANNELS;
+    // ケーブルのChannelに割り当て済みのVoiceを強制解放
+    for (auto& info : observers) {
+        if (info.channel >= first && info.channel < last) {
+            info.observer->ReleaseAll();
+        }
+    }
+    // 解放したVoiceをリセット
+    for (auto& voice : voice_pool) {
+        int ch = voice->GetChannel();
+        if (ch >= first && ch < last) {
+            voice->Reset();
+        }
+    }
 }
 
 //
 // For debug
 //
-int VoiceAllocator::GetFailedCount() {
-    return failed_count;
+const AllocStats& VoiceAllocator::GetStats() {
+    return stats;
 }
 
-void VoiceAllocator::dump() {
-    printf("\n=== Voice List ===\n");
+int VoiceAllocator::GetBusyTimes(uint32_t* ms, int max) {
+    int n = 0;
     for (auto& voice : voice_pool) {
-        voice->dump();
+        if (n >= max) {
+            break;
+        }
+        ms[n++] = voice->GetBusyTime();
+    }
+    return n;
+}
+
+int VoiceAllocator::snapshot(VoiceState* s, int max) {
+    int n = 0;
+    for (auto& voice : voice_pool) {
+        if (n >= max) {
+            break;
+        }
+        voice->snapshot(s[n++]);
     }
+    return n;
 }
@@ -5,21 +5,46 @@
 // See LICENSE file for details.
 //
 #pragma once
-#include <vector>
-
 #include "CsmVoice.h"
+#include "FixedVector.h"
 #include "MidiChannelObserver.h"
 #include "NoteVoice.h"
+#include "config.h"
+
+/**
+ * @brief Voiceの割り当ての統計
+ * @details 常時有効。MIDIリセット(VoiceAllocator::Reset())でクリアする
+ */
+struct AllocStats {
+    /**
+     * @brief 割り当ての経路
+     */
+    enum Path : uint8_t {
+        LOCAL,   // ChannelのfreeQueueから再利用
+        POOL,    // voice_poolの未割り当てのVoice
+        STEAL,   // 他のChannelから回収(Release)
+        FAILED,  // 割り当て失敗
+        PATHS,
+    };
+
+    uint32_t path[PATHS];       // 経路ごとの割り当て回数
+    uint32_t tone_load[PATHS];  // 経路ごとの、割り当てたVoiceのNote Onで音色を設定した回数
+    uint32_t hint;              // midを指定した割り当ての回数(失敗を除く)
+    uint32_t hint_hit;          // midと同じmoduleのVoiceを割り当てた回数
+    uint32_t revoke;            // CH3をCSM Voiceに切り替えた回数
+    uint32_t revoke_cut;        // 発音中のCH3を切り替えた回数
+    uint32_t start_ms;          // 集計を開始した時刻(ms)
+};
 
 /**
  * @brief VoiceAllocator class
- * @details シングルトンクラス
+ * @details シングルトンクラス。リストは固定長で、動的メモリ確保は行わない。
  */
 class VoiceAllocator {
 private:
-    std::vector<ObserverInfo> observers;  // MIDI ChannelのObserverのリスト
-    std::vector<Voice*> voice_pool;       // Voiceのリスト
-    int failed_count;                     // DEBUG: Allocation fail count
+    FixedVector<ObserverInfo, MIDI_CABLES * MIDI_CHANNELS> observers;  // MIDI ChannelのObserver
+    FixedVector<Voice*, MAX_VOICES> voice_pool;                         // Voiceのリスト
+    AllocStats stats;                                                   // 割り当ての統計
 
     VoiceAllocator()  = default;
     ~VoiceAllocator() = default;
@@ -40,11 +65,13 @@ public:
     /**
      * @brief Voiceを登録する
      * @param voice    登録するNoteVoiceのインスタンスへのポインタ
+     * @details MAX_VOICESを超えた場合はpanicする
      */
     void AddVoice(Voice* voice);
 
     /**
      * @brief 登録したVoiceを全て削除する
+     * @details 登録を解除するだけで、Voiceのインスタンスは破棄しない(MidiFactoryが破棄する)
      */
     void DeleteAllVoices();
 
@@ -62,18 +89,47 @@ public:
 
     /**
      * @brief MIDI ChannelにVoiceを割り当てる
-     * @param channel MIDI Channel No.
+     * @param channel MIDI Channel No. (ケーブル番号 * MIDI_CHANNELS + チャンネル番号)
      * @param mid     module id
      * @param type    Voice Type true:CsmVoice, false:NoteVoice
+     * @param path    割り当ての経路の格納先(POOL/STEAL/FAILED)
      * @return Voiceのインスタンスへのポインタ
      * @details 
+     * NoteVoiceは、チャンネルが属するケーブルのDock(MIDI_CABLE_DOCKS)から割り当てる。
      * voice_poolに未割り当てのVoiceがあればそれを返す。
      * midと一致するVoiceを優先的に割り当てることで、同一Channel内では
      * なるべく同じmoduleが使われるように仕向ける。
      * ない場合はMIDI ChannelのObserver経由で未使用のVoiceを回収する。
+     * CSM VoiceとCH3を共有するNoteVoiceは、CSMモードへの切り替えで発音が途切れるので、
+     * 他に割り当てられるVoiceがない場合に限り割り当てる。
      * 回収できなかった場合はnullptrを返す。
      */
-    Voice* AllocateVoice(int channel, int mid, bool type);
+    Voice* AllocateVoice(int channel, int mid, bool type, AllocStats::Path& path);
+
+    /**
+     * @brief Voiceの割り当てを統計に記録する
+     * @param path  割り当ての経路(LOCAL/POOL/STEAL)
+     * @param mid   割り当てを要求したmodule id(-1:指定なし)
+     * @param voice 割り当てたVoice
+     * @param loads 割り当てたVoiceのNote Onで音色を設定した回数
+     */
+    void CountAllocation(AllocStats::Path path, int mid, Voice* voice, uint32_t loads) {
+        ++stats.path[path];
+        stats.tone_load[path] += loads;
+        if (mid != -1) {
+            ++stats.hint;
+            if (voice->GetModuleId() == mid) {
+                ++stats.hint_hit;
+            }
+        }
+    }
+
+    /**
+     * @brief CSM Voiceが使用するCH3のNoteVoiceを回収する
+     * @param voice 回収するNoteVoice
+     * @details 割り当て先のMIDI Channelから外して発音を止め、CH3が返却されるまで割り当てない
+     */
+    void Revoke(NoteVoice* voice);
 
     /**
      * @brief Voiceを解放する
@@ -81,9 +137,33 @@ public:
      */
     void Reset();
 
+    /**
+     * @brief ケーブルのMIDI Channelに割り当てたVoiceを解放する
+     * @param cable ケーブル番号
+     * @details
+     * ケーブルのMIDI Channel(cable * MIDI_CHANNELS から MIDI_CHANNELS個)に割り当て済みのVoiceを
+     * 解放してリセットする。他のケーブルのVoiceと統計には影響しない(GM/GS/XGリセット用)。
+     */
+    void Reset(int cable);
+
     //
     // For debug
     //
-    int GetFailedCount();
-    void dump();
+    const AllocStats& GetStats();
+
+    /**
+     * @brief 全Voiceのキーオンしていた累積時間を取得する
+     * @param ms  取得先(ms)
+     * @param max 取得するVoiceの最大数
+     * @return 取得したVoiceの数
+     */
+    int GetBusyTimes(uint32_t* ms, int max);
+
+    /**
+     * @brief 全Voiceの状態のスナップショットを取得する
+     * @param s   取得先
+     * @param max 取得するVoiceの最大数
+     * @return 取得したVoiceの数
+     */
+    int snapshot(VoiceState* s, int max);
 };
@@ -0,0 +1,143 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include "Voice.h"
+
+/**
+ * @brief Voiceのキュー(侵入型の双方向リスト)
+ * @details
+ * リンクはVoice自身が持つので、追加や移動でメモリを確保しない。
+ * Voiceは同時に1つのキューにだけ属する。Voiceを取り除いても、他のVoiceを指す
+ * イテレータは無効にならない。
+ */
+class VoiceQueue {
+private:
+    Voice* head;  // 先頭
+    Voice* tail;  // 末尾
+    int count;    // Voice数
+
+public:
+    /**
+     * @brief 先頭から末尾に向かうイテレータ
+     */
+    class iterator {
+    private:
+        Voice* voice;
+
+    public:
+        explicit iterator(Voice* voice) : voice(voice) {}
+        Voice* operator*() const { return voice; }
+        Voice* operator->() const { return voice; }
+        iterator& operator++() {
+            voice = voice->queue_next;
+            return *this;
+        }
+        bool operator==(const iterator& rhs) const { return voice == rhs.voice; }
+        bool operator!=(const iterator& rhs) const { return voice != rhs.voice; }
+    };
+
+    constexpr VoiceQueue() : head(nullptr), tail(nullptr), count(0) {}
+    VoiceQueue(const VoiceQueue&)            = delete;
+    VoiceQueue& operator=(const VoiceQueue&) = delete;
+
+    iterator begin() const { return iterator(head); }
+    iterator end() const { return iterator(nullptr); }
+
+    bool empty() const { return count == 0; }
+    int size() const { return count; }
+    Voice* front() const { return head; }
+    Voice* back() const { return tail; }
+
+    /**
+     * @brief 次のVoiceを返す
+     * @return 次のVoice(末尾ではnullptr)
+     */
+    static Voice* next(Voice* voice) { return voice->queue_next; }
+
+    /**
+     * @brief 前のVoiceを返す
+     * @return 前のVoice(先頭ではnullptr)
+     */
+    static Voice* prev(Voice* voice) { return voice->queue_prev; }
+
+    /**
+     * @brief 末尾に追加する
+     * @param voice どのキューにも属していないVoice
+     */
+    void push_back(Voice* voice) {
+        voice->queue      = this;
+        voice->queue_prev = tail;
+        voice->queue_next = nullptr;
+        if (tail) {
+            tail->queue_next = voice;
+        } else {
+            head = voice;
+        }
+        tail = voice;
+        ++count;
+    }
+
+    /**
+     * @brief 取り除く
+     * @param voice 取り除くVoice
+     * @return true:取り除いた, false:このキューに属していない
+     */
+    bool remove(Voice* voice) {
+        if (voice->queue != this) {
+            return false;
+        }
+        if (voice->queue_prev) {
+            voice->queue_prev->queue_next = voice->queue_next;
+        } else {
+            head = voice->queue_next;
+        }
+        if (voice->queue_next) {
+            voice->queue_next->queue_prev = voice->queue_prev;
+        } else {
+            tail = voice->queue_prev;
+        }
+        voice->queue      = nullptr;
+        voice->queue_prev = nullptr;
+        voice->queue_next = nullptr;
+        --count;
+        return true;
+    }
+
+    /**
+     * @brief 別のキューのVoiceをすべて末尾に移動する
+     * @param src 移動元のキュー(空になる)
+     */
+    void splice(VoiceQueue& src) {
+        if (src.head == nullptr) {
+            return;
+        }
+        for (Voice* v = src.head; v; v = v->queue_next) {
+            v->queue = this;
+        }
+        src.head->queue_prev = tail;
+        if (tail) {
+            tail->queue_next = src.head;
+        } else {
+            head = src.head;
+        }
+        tail = src.tail;
+        count += src.count;
+        // 移動元を空にする
+        src.head  = nullptr;
+        src.tail  = nullptr;
+        src.count = 0;
+    }
+
+    /**
+     * @brief すべてのVoiceを取り除く
+     */
+    void clear() {
+        while (head) {
+            remove(head);
+        }
+    }
+};
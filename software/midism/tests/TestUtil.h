@@ -0,0 +1,30 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include <cstdio>
+
+// 失敗したチェックの数
+static int test_failures = 0;
+
+/**
+ * @brief 条件を確認し、成り立たなければ失敗として表示する
+ * @details 失敗してもテストは継続し、最後にTEST_RESULT()で終了コードを返す
+ */
+#define CHECK(cond, ...)                                                \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            printf("%s:%d: CHECK(%s) failed: ", __FILE__, __LINE__, #cond); \
+            printf(__VA_ARGS__);                                        \
+            printf("\n");                                               \
+            ++test_failures;                                            \
+        }                                                               \
+    } while (0)
+
+/**
+ * @brief テストの結果を表示し、main()の戻り値を返す
+ */
+#define TEST_RESULT() (printf("%s\n", test_failures ? "FAILED" : "OK"), test_failures ? 1 : 0)
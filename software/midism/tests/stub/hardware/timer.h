@@ -0,0 +1,18 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+#pragma once
+#include <cstdint>
+
+// ホストのテスト用のタイマー(時刻はテストが進める)
+extern uint32_t test_now_us;
+
+static inline uint32_t time_us_32() {
+    return test_now_us;
+}
+static inline uint64_t time_us_64() {
+    return test_now_us;
+}
@@ -0,0 +1,122 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+// CsmInterpolatorのテスト
+// 内蔵フレーズバンクの全フレーズを、CsmVoiceと同じ手順で補間して、
+// - 出力したサブフレームの数
+// - フレームの境界で、フレームのレジスタ値と完全に一致すること
+// - 補間した値が、倍精度で計算した値と1LSB以内であること
+// をサブフレーム数ごとに確認する。
+//
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "CsmInterpolator.h"
+#include "CsmPhraseDecoder.h"
+#include "TestUtil.h"
+
+using Frame = std::vector<uint16_t>;
+
+// F-Number << Blockの周波数領域の値
+static double to_linear(uint16_t fnum) {
+    return (double)(fnum & 0x7ff) * (1 << ((fnum >> 11) & 7));
+}
+
+// フレーズをデコードしたフレームの並び
+static std::vector<Frame> decode(const uint8_t* bank, int phrase) {
+    std::vector<Frame> frames;
+    CsmPhraseDecoder decoder;
+    decoder.Start(bank, phrase);
+    while (decoder.Next()) {
+        frames.emplace_back(decoder.GetValues(), decoder.GetValues() + csm::FIELDS);
+        if (decoder.IsLast()) {
+            break;
+        }
+    }
+    return frames;
+}
+
+// CsmVoiceと同じ手順で補間したサブフレームの並び
+static std::vector<Frame> interpolate(const std::vector<Frame>& frames, int subframes) {
+    std::vector<Frame> out;
+    CsmInterpolator interp(subframes);
+    uint16_t value[csm::FIELDS];
+    size_t next = 0;
+    interp.Start(frames[next].data());
+    interp.Step(value);
+    out.emplace_back(value, value + csm::FIELDS);
+    while (true) {
+        if (interp.IsReached()) {
+            if (++next >= frames.size()) {
+                break;
+            }
+            interp.Target(frames[next].data());
+        }
+        interp.Step(value);
+        out.emplace_back(value, value + csm::FIELDS);
+    }
+    return out;
+}
+
+// 補間した値と基準値の差(F-Numberは補間中のBlockも確認する)
+static int error(const Frame& a, const Frame& b, double t, int f, uint16_t got) {
+    if (f < csm::FIELD_FNUM) {
+        int ref = (int)std::floor(a[f] + (b[f] - a[f]) * t + 0.5);
+        return std::abs(got - ref);
+    }
+    int block = std::max((a[f] >> 11) & 7, (b[f] >> 11) & 7);
+    if (((got >> 11) & 7) != block) {
+        return 0x800;  // Blockが異なる
+    }
+    double linear = to_linear(a[f]) + (to_linear(b[f]) - to_linear(a[f])) * t;
+    int ref       = std::min((int)std::floor(linear / (1 << block) + 0.5), 0x7ff);
+    return std::abs((got & 0x7ff) - ref);
+}
+
+int main() {
+    const uint8_t* bank = csm::rom_bank.data();
+    int phrases         = CsmPhraseDecoder::GetPhraseCount(bank);
+    CHECK(phrases > 0, "no phrase in ROM bank");
+
+    for (int subframes : {1, 2, 3, 4, 5, 8, 16}) {
+        int max_error = 0;
+        for (int p = 0; p < phrases; p++) {
+            std::vector<Frame> frames = decode(bank, p);
+            CHECK(!frames.empty(), "phrase %d is empty", p);
+            if (frames.empty()) {
+                continue;
+            }
+            std::vector<Frame> out = interpolate(frames, subframes);
+
+            size_t expect = (frames.size() - 1) * subframes + 1;
+            CHECK(out.size() == expect, "N=%d phrase %d: %zu subframes (expected %zu)", subframes,
+                  p, out.size(), expect);
+            if (out.size() != expect) {
+                continue;
+            }
+            for (size_t i = 0; i < out.size(); i++) {
+                size_t k = (i + subframes - 1) / subframes;  // 補間先のフレーム
+                int s    = i - (k - 1) * subframes;         // サブフレーム(1-subframes)
+                for (int f = 0; f < csm::FIELDS; f++) {
+                    if (i == 0 || s == subframes) {
+                        CHECK(out[i][f] == frames[k][f],
+                              "N=%d phrase %d frame %zu field %d: %04x (expected %04x)",
+                              subframes, p, k, f, out[i][f], frames[k][f]);
+                        continue;
+                    }
+                    int e = error(frames[k - 1], frames[k], (double)s / subframes, f, out[i][f]);
+                    CHECK(e <= 1, "N=%d phrase %d subframe %zu field %d: %04x (error %d)",
+                          subframes, p, i, f, out[i][f], e);
+                    max_error = std::max(max_error, e);
+                }
+            }
+        }
+        printf("N=%2d: %d phrases, max error %d LSB\n", subframes, phrases, max_error);
+    }
+    return TEST_RESULT();
+}
@@ -0,0 +1,208 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+// DIN MIDI入力(DmaRingReader, MidiStreamParser)のテスト
+// UARTのDMAを模擬するバイト列の書き込み側で、メインループと同じように一定数ずつ取り出し、
+// - 書き込みバイト数(uint32_t)の桁あふれをまたぐ取り出し
+// - オーバーランからの復帰とGetOverruns()
+// - 取り出しの境界をまたぐランニングステータス
+// - チャンネルメッセージの途中のリアルタイムメッセージ
+// - 3バイトずつに区切ったSysExと、新しいステータスバイトによるSysExの中断
+// を確認する。
+//
+#include <cstring>
+
+#include "DmaRingReader.h"
+#include "MidiStreamParser.h"
+#include "TestUtil.h"
+
+static constexpr uint32_t RING_SIZE = 64;  // リングバッファのサイズ(2のべき乗)
+static constexpr int DRAIN_MAX      = 5;   // 1回に取り出す最大バイト数
+
+/**
+ * @brief UARTのDMAを模擬する書き込み側
+ * @details リングバッファを周回して書き込み、書き込んだバイト数を単調増加させる
+ */
+struct SyntheticUart {
+    volatile uint8_t buffer[RING_SIZE];
+    uint32_t write;  // 書き込んだバイト数
+
+    explicit SyntheticUart(uint32_t start) : buffer{}, write(start) {}
+
+    void Send(const uint8_t* data, int len) {
+        for (int i = 0; i < len; i++) {
+            buffer[write++ & (RING_SIZE - 1)] = data[i];
+        }
+    }
+};
+
+/**
+ * @brief MidiStreamParserが出力したメッセージの記録
+ */
+struct Received {
+    static constexpr int MAX = 64;
+    uint8_t msg[MAX][3];
+    int num[MAX];
+    int count = 0;
+
+    void Push(const uint8_t m[3], int n) {
+        if (count < MAX) {
+            memcpy(msg[count], m, n);
+            num[count++] = n;
+        }
+    }
+
+    bool Equals(int i, const uint8_t* m, int n) const {
+        return i < count && num[i] == n && memcmp(msg[i], m, n) == 0;
+    }
+};
+
+/**
+ * @brief メインループと同じように、未読データがなくなるまでDRAIN_MAXずつ取り出す
+ * @return Drain()を呼び出した回数
+ */
+static int drain_all(SyntheticUart& uart, DmaRingReader& ring, MidiStreamParser& parser,
+                     Received& rx) {
+    int calls = 0;
+    while (ring.IsPending(uart.write)) {
+        ring.Drain(uart.write, DRAIN_MAX, [&](uint8_t data) {
+            uint8_t msg[3];
+            int num = parser.Push(data, msg);
+            if (num) {
+                rx.Push(msg, num);
+            }
+        });
+        ++calls;
+    }
+    return calls;
+}
+
+int main() {
+    // 書き込みバイト数の桁あふれをまたいで取り出す
+    {
+        SyntheticUart uart(0xffffffff - 20);
+        DmaRingReader ring(uart.buffer, RING_SIZE);
+        MidiStreamParser parser;
+        Received rx;
+        ring.Reset(uart.write);
+
+        // Note On 16個(48バイト)を書き込み、DRAIN_MAXずつ取り出す
+        for (int i = 0; i < 16; i++) {
+            const uint8_t m[3] = {0x90, (uint8_t)(60 + i), 100};
+            uart.Send(m, 3);
+            if (i % 4 == 3) {
+                drain_all(uart, ring, parser, rx);
+            }
+        }
+        CHECK(uart.write < 0x100, "write count did not wrap (%08x)", (unsigned)uart.write);
+        CHECK(rx.count == 16, "received %d messages", rx.count);
+        for (int i = 0; i < rx.count; i++) {
+            const uint8_t m[3] = {0x90, (uint8_t)(60 + i), 100};
+            CHECK(rx.Equals(i, m, 3), "message %d %02x %02x %02x", i, rx.msg[i][0], rx.msg[i][1],
+                  rx.msg[i][2]);
+        }
+        CHECK(ring.GetOverruns() == 0, "overruns %u", (unsigned)ring.GetOverruns());
+        CHECK(!ring.IsPending(uart.write), "data left");
+    }
+
+    // オーバーランからの復帰
+    {
+        SyntheticUart uart(0xfffffff0);
+        DmaRingReader ring(uart.buffer, RING_SIZE);
+        ring.Reset(uart.write);
+
+        // バッファサイズ+10バイトを取り出さずに書き込む
+        uint8_t data[RING_SIZE + 10];
+        for (uint32_t i = 0; i < sizeof(data); i++) {
+            data[i] = (uint8_t)i;
+        }
+        uart.Send(data, sizeof(data));
+
+        // 上書きされていない最新のバッファサイズ分から読み出す
+        uint8_t out[RING_SIZE + 10];
+        int n = 0;
+        while (ring.IsPending(uart.write)) {
+            ring.Drain(uart.write, DRAIN_MAX, [&](uint8_t d) { out[n++] = d; });
+        }
+        CHECK(ring.GetOverruns() == 1, "overruns %u", (unsigned)ring.GetOverruns());
+        CHECK(n == (int)RING_SIZE, "read %d bytes after overrun", n);
+        CHECK(out[0] == 10 && out[n - 1] == RING_SIZE + 9, "read %02x-%02x", out[0], out[n - 1]);
+
+        // 以後は通常どおり読み出せる
+        const uint8_t more[3] = {0xaa, 0xbb, 0xcc};
+        uart.Send(more, 3);
+        n = 0;
+        ring.Drain(uart.write, DRAIN_MAX, [&](uint8_t d) { out[n++] = d; });
+        CHECK(n == 3 && memcmp(out, more, 3) == 0, "read %d bytes after recovery", n);
+        CHECK(ring.GetOverruns() == 1, "overruns %u after recovery", (unsigned)ring.GetOverruns());
+    }
+
+    // ランニングステータスとリアルタイムメッセージ
+    {
+        SyntheticUart uart(0);
+        DmaRingReader ring(uart.buffer, RING_SIZE);
+        MidiStreamParser parser;
+        Received rx;
+        ring.Reset(uart.write);
+
+        // 2つ目以降のNote Onはランニングステータス。取り出しの境界(5バイト目)をまたぐ
+        const uint8_t running[] = {0x90, 0x3c, 0x64, 0x3e, 0x64, 0x40, 0x00};
+        uart.Send(running, sizeof(running));
+        // Note Onの途中にTiming Clock
+        const uint8_t realtime[] = {0x80, 0x3c, 0xf8, 0x40};
+        uart.Send(realtime, sizeof(realtime));
+        int calls = drain_all(uart, ring, parser, rx);
+
+        const uint8_t m0[3] = {0x90, 0x3c, 0x64};
+        const uint8_t m1[3] = {0x90, 0x3e, 0x64};
+        const uint8_t m2[3] = {0x90, 0x40, 0x00};
+        const uint8_t m3[1] = {0xf8};
+        const uint8_t m4[3] = {0x80, 0x3c, 0x40};
+        CHECK(calls == 3, "drained in %d calls", calls);
+        CHECK(rx.count == 5, "received %d messages", rx.count);
+        CHECK(rx.Equals(0, m0, 3), "running status: first message");
+        CHECK(rx.Equals(1, m1, 3), "running status across drain boundary");
+        CHECK(rx.Equals(2, m2, 3), "running status: third message");
+        CHECK(rx.Equals(3, m3, 1), "realtime byte inside a channel message");
+        CHECK(rx.Equals(4, m4, 3), "channel message around a realtime byte");
+    }
+
+    // System Exclusive
+    {
+        SyntheticUart uart(0);
+        DmaRingReader ring(uart.buffer, RING_SIZE);
+        MidiStreamParser parser;
+        Received rx;
+        ring.Reset(uart.write);
+
+        // GM System On: 3バイトずつに区切る
+        const uint8_t gm_on[] = {0xf0, 0x7e, 0x7f, 0x09, 0x01, 0xf7};
+        uart.Send(gm_on, sizeof(gm_on));
+        // 途中で新しいステータスバイトが来たSysEx。後から来た$F7は読み捨てる
+        const uint8_t cut[] = {0xf0, 0x43, 0x10, 0x4c, 0x90, 0x3c, 0x64, 0xf7};
+        uart.Send(cut, sizeof(cut));
+        drain_all(uart, ring, parser, rx);
+
+        const uint8_t s0[3] = {0xf0, 0x7e, 0x7f};
+        const uint8_t s1[3] = {0x09, 0x01, 0xf7};
+        const uint8_t c0[3] = {0xf0, 0x43, 0x10};
+        const uint8_t c1[3] = {0x90, 0x3c, 0x64};
+        CHECK(rx.count == 4, "received %d messages", rx.count);
+        CHECK(rx.Equals(0, s0, 3), "sysex chunk 1");
+        CHECK(rx.Equals(1, s1, 3), "sysex chunk 2");
+        CHECK(rx.Equals(2, c0, 3), "cut sysex chunk");
+        CHECK(rx.Equals(3, c1, 3), "status byte after cut sysex");
+
+        // 中断後のデータバイトはランニングステータスとして扱う
+        const uint8_t after[] = {0x3e, 0x64};
+        uart.Send(after, sizeof(after));
+        drain_all(uart, ring, parser, rx);
+        const uint8_t c2[3] = {0x90, 0x3e, 0x64};
+        CHECK(rx.count == 5 && rx.Equals(4, c2, 3), "running status after cut sysex");
+    }
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,154 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+// MidiPanelのテスト
+// I/Oポートを模擬するHALで、Core1の走査ループと同じようにUpdate()を呼び出し、
+// - 走査の間隔と、点灯している列に応じたPAへの書き込み(前回の列の消灯の省略)
+// - スイッチのチャタリング除去
+// - MIDI入力の処理待ちによる走査の保留と、その上限
+// - MIDIリセットボタンの長押しの検出
+// を確認する。
+//
+#include "MidiPanel.h"
+#include "TestUtil.h"
+#include "YM2608.h"
+#include "config.h"
+
+uint32_t test_now_us = 0;
+
+/**
+ * @brief パネルのI/Oポートを模擬するHAL
+ * @details PA bit0-3でLowにした列のスイッチをPBに返す。表示モードとリセットのボタンは全列で読める。
+ */
+class PanelHal : public HAL {
+public:
+    uint16_t channels = 0;  // ONのMIDIチャンネルのスイッチ(正論理, bit0-15:CH1-16)
+    uint8_t buttons   = 0;  // 押されているボタン(正論理, bit6:表示モード, bit7:リセット)
+    int pa_writes     = 0;  // PAへの書き込み回数
+    int pa_blanks     = 0;  // 列を切り替えないPAへの書き込み(前回の列の消灯)の回数
+
+    uint8_t read(uint8_t adrs, uint8_t /*a1*/) override {
+        if (adrs != 0x0f) {
+            return 0;
+        }
+        uint8_t sw = buttons;
+        for (int row = 0; row < 4; row++) {
+            if ((pa & (1 << row)) == 0) {
+                sw |= (channels >> (row * 4)) & 0x0f;
+            }
+        }
+        return wire((uint8_t)~sw);
+    }
+    void write(uint8_t adrs, uint8_t data, uint8_t /*a1*/, uint8_t /*wait*/) override {
+        if (adrs == 0x0e) {
+            uint8_t next = wire(data);
+            ++pa_writes;
+            if ((next & 0x0f) == (pa & 0x0f)) {
+                ++pa_blanks;
+            }
+            pa = next;
+        }
+    }
+    uint8_t read_status(uint8_t /*a1*/) override { return 0; }
+
+private:
+    uint8_t pa = 0x0f;  // PAに書き込まれた値(bit0-3:列の選択(Low), bit4-7:LED)
+
+    // コネクタの配線(ENABLE_CONNECTOR_WIRING_BUG_WORKAROUNDではビットが反転している)
+    static uint8_t wire(uint8_t v) {
+#if ENABLE_CONNECTOR_WIRING_BUG_WORKAROUND == 1
+        uint8_t r = 0;
+        for (int i = 0; i < 8; i++) {
+            if ((v >> i) & 1) {
+                r |= 0x80 >> i;
+            }
+        }
+        return r;
+#else
+        return v;
+#endif
+    }
+};
+
+// Core1の走査ループを模擬する(10usごとにUpdate()を呼び出す)
+static int run(MidiPanel& panel, uint32_t us, int* resets = nullptr) {
+    int scans = 0;
+    for (uint32_t t = 0; t < us; t += 10) {
+        test_now_us += 10;
+        if (panel.Update(test_now_us)) {
+            ++scans;
+            if (resets && panel.IsMidiReset()) {
+                ++*resets;
+            }
+        }
+    }
+    return scans;
+}
+
+int main() {
+    PanelHal hal;
+    YM2608 module(hal, YM2608_CLOCK, 0);
+
+    // 起動時はチャタリング除去せずに初期値を確定する
+    hal.channels = 0x000f;  // CH1-4 ON
+    hal.buttons  = 0x40;    // ON/OFF表示モード
+    MidiPanel panel(module);
+    CHECK(panel.GetMidiSwState() == 0x000f, "initial switches %04x", panel.GetMidiSwState());
+
+    // PANEL_SCAN_USごとに1列走査する
+    // 点灯しているのは1列だけなので、前回の列の消灯は省略され、PAは走査ごとに1回だけ書き込む
+    hal.pa_writes = 0;
+    hal.pa_blanks = 0;
+    int scans     = run(panel, 100000);
+    CHECK(scans == 100000 / PANEL_SCAN_US, "scans in 100ms: %d", scans);
+    CHECK(hal.pa_writes == scans, "PA writes in %d scans: %d", scans, hal.pa_writes);
+    CHECK(hal.pa_blanks == 0, "PA blanking writes: %d", hal.pa_blanks);
+
+    // 隣り合う2列が点灯している場合は、2列目の走査の前に1列目を消灯する
+    hal.channels = 0x00ff;  // CH1-8 ON
+    run(panel, PANEL_DEBOUNCE_US * 2);
+    CHECK(panel.GetMidiSwState() == 0x00ff, "switches on %04x", panel.GetMidiSwState());
+    hal.pa_writes = 0;
+    hal.pa_blanks = 0;
+    scans         = run(panel, PANEL_SCAN_US * 4 * 10);  // 全列を10周
+    CHECK(scans == 40, "scans in 10 cycles: %d", scans);
+    CHECK(hal.pa_blanks == 10, "PA blanking writes in 10 cycles: %d", hal.pa_blanks);
+    CHECK(hal.pa_writes == scans + 10, "PA writes in 10 cycles: %d", hal.pa_writes);
+
+    // スイッチOFFはPANEL_DEBOUNCE_US後に確定する
+    hal.channels = 0x0000;
+    run(panel, PANEL_DEBOUNCE_US / 2);
+    CHECK(panel.GetMidiSwState() == 0x00ff, "switches changed before debounce %04x",
+          panel.GetMidiSwState());
+    run(panel, PANEL_DEBOUNCE_US * 2);
+    CHECK(panel.GetMidiSwState() == 0x0000, "switches off %04x", panel.GetMidiSwState());
+
+    // PANEL_DEBOUNCE_USより短いチャタリングは無視する
+    hal.channels = 0x0001;
+    run(panel, PANEL_DEBOUNCE_US / 4);
+    hal.channels = 0x0000;
+    run(panel, PANEL_DEBOUNCE_US * 2);
+    CHECK(panel.GetMidiSwState() == 0x0000, "glitch was not ignored %04x", panel.GetMidiSwState());
+
+    // MIDI入力の処理待ちの間は走査しないが、PANEL_MAX_YIELD_US以上は保留しない
+    panel.SetPending(true);
+    scans = run(panel, 1000000);
+    panel.SetPending(false);
+    CHECK(scans == 1000000 / PANEL_MAX_YIELD_US, "scans while pending: %d", scans);
+
+    // MIDIリセットボタンはPANEL_RESET_HOLD_USの長押しで検出し、押し続けるとその周期で検出する
+    hal.buttons = 0xc0;
+    int resets  = 0;
+    run(panel, PANEL_RESET_HOLD_US / 2, &resets);
+    CHECK(resets == 0, "reset detected too early");
+    run(panel, PANEL_RESET_HOLD_US * 2, &resets);
+    CHECK(resets == 2, "resets while held 2.5s: %d", resets);
+    hal.buttons = 0x40;
+    run(panel, PANEL_RESET_HOLD_US * 2, &resets);
+    CHECK(resets == 2, "reset detected after release: %d", resets);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,150 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+// opn_probe()/opn_scan()のテスト
+// YM2608、YM2203、未接続のDockを模擬するHALで、
+// - FM音源LSIの種類の判定
+// - 書き換えたSSGのレジスタが0に戻っていること
+// - 未接続およびnullptrのDockがOPN_NONEになり、ビットマップに含まれないこと
+// を確認する。
+//
+#include <cstring>
+
+#include "OpnProbe.h"
+#include "TestUtil.h"
+#include "config.h"
+
+/**
+ * @brief YM2608を模擬するHAL
+ * @details A1=0/1で別のレジスタ空間を持ち、$FFの読み出しでID(0x01)を返す
+ */
+class FakeYM2608 : public HAL {
+public:
+    uint8_t reg[2][256];
+
+    FakeYM2608() { memset(reg, 0, sizeof(reg)); }
+
+    uint8_t read(uint8_t adrs, uint8_t a1) override {
+        if (a1 == 0 && adrs == 0xff) {
+            return 0x01;
+        }
+        return reg[a1 & 1][adrs];
+    }
+    void write(uint8_t adrs, uint8_t data, uint8_t a1, uint8_t /*wait*/) override {
+        reg[a1 & 1][adrs] = data;
+    }
+    uint8_t read_status(uint8_t /*a1*/) override { return 0; }
+};
+
+/**
+ * @brief YM2203を模擬するHAL
+ * @details A1を持たないので、A1=1の書き込みもA1=0のレジスタに反映される。
+ *          SSG以外のレジスタは読み出せない(id_valueを返す)。
+ */
+class FakeYM2203 : public HAL {
+public:
+    uint8_t reg[256];
+    uint8_t id_value;  // SSG以外のレジスタの読み出し値
+
+    explicit FakeYM2203(uint8_t id_value = 0) : id_value(id_value) {
+        memset(reg, 0, sizeof(reg));
+    }
+
+    uint8_t read(uint8_t adrs, uint8_t /*a1*/) override {
+        return (adrs < 0x10) ? reg[adrs] : id_value;
+    }
+    void write(uint8_t adrs, uint8_t data, uint8_t /*a1*/, uint8_t /*wait*/) override {
+        reg[adrs] = data;
+    }
+    uint8_t read_status(uint8_t /*a1*/) override { return 0; }
+};
+
+/**
+ * @brief 未接続のDockを模擬するHAL
+ * @details データバスが浮いているので、直前にバスに出したアドレスが読み出される
+ */
+class FloatingBus : public HAL {
+public:
+    uint8_t read(uint8_t adrs, uint8_t /*a1*/) override { return adrs; }
+    void write(uint8_t /*adrs*/, uint8_t /*data*/, uint8_t /*a1*/, uint8_t /*wait*/) override {}
+    uint8_t read_status(uint8_t /*a1*/) override { return 0; }
+};
+
+/**
+ * @brief プルアップされた未接続のDockを模擬するHAL
+ */
+class PulledUpBus : public HAL {
+public:
+    uint8_t read(uint8_t /*adrs*/, uint8_t /*a1*/) override { return 0xff; }
+    void write(uint8_t /*adrs*/, uint8_t /*data*/, uint8_t /*a1*/, uint8_t /*wait*/) override {}
+    uint8_t read_status(uint8_t /*a1*/) override { return 0; }
+};
+
+int main() {
+    // 種類の判定とSSGのレジスタの復元
+    {
+        FakeYM2608 opna;
+        CHECK(opn_probe(opna) == OPN_YM2608, "YM2608 detected as %s",
+              opn_type_name(opn_probe(opna)));
+        CHECK(opna.reg[0][0x00] == 0 && opna.reg[0][0x01] == 0, "YM2608 SSG $00=%02x $01=%02x",
+              opna.reg[0][0x00], opna.reg[0][0x01]);
+        CHECK(opna.reg[1][0x01] == 0, "YM2608 $101=%02x", opna.reg[1][0x01]);
+
+        FakeYM2203 opn;
+        CHECK(opn_probe(opn) == OPN_YM2203, "YM2203 detected as %s", opn_type_name(opn_probe(opn)));
+        CHECK(opn.reg[0x00] == 0 && opn.reg[0x01] == 0, "YM2203 SSG $00=%02x $01=%02x",
+              opn.reg[0x00], opn.reg[0x01]);
+
+        // $FFがたまたまIDと同じ値でも、A1の確認でYM2203と判定する
+        FakeYM2203 opn_id(0x01);
+        CHECK(opn_probe(opn_id) == OPN_YM2203, "YM2203($FF=01) detected as %s",
+              opn_type_name(opn_probe(opn_id)));
+
+        FloatingBus floating;
+        CHECK(opn_probe(floating) == OPN_NONE, "floating bus detected as %s",
+              opn_type_name(opn_probe(floating)));
+
+        PulledUpBus pulled_up;
+        CHECK(opn_probe(pulled_up) == OPN_NONE, "pulled-up bus detected as %s",
+              opn_type_name(opn_probe(pulled_up)));
+    }
+
+    // 全Dockの走査
+    {
+        FakeYM2608 opna0, opna5;
+        FakeYM2203 opn2;
+        FloatingBus floating;
+        HAL* hals[MAX_DOCKS] = {&opna0,    &floating, &opn2,   nullptr,
+                                &floating, &opna5,    nullptr, &floating};
+        const OpnType expected[MAX_DOCKS] = {OPN_YM2608, OPN_NONE,   OPN_YM2203, OPN_NONE,
+                                             OPN_NONE,   OPN_YM2608, OPN_NONE,   OPN_NONE};
+        OpnType types[MAX_DOCKS];
+        memset(types, 0xff, sizeof(types));
+
+        uint32_t found = opn_scan(hals, types, MAX_DOCKS);
+        CHECK(found == ((1u << 0) | (1u << 2) | (1u << 5)), "found %02x", (unsigned)found);
+        for (int d = 0; d < MAX_DOCKS; d++) {
+            CHECK(types[d] == expected[d], "dock%d %s (expected %s)", d, opn_type_name(types[d]),
+                  opn_type_name(expected[d]));
+        }
+        CHECK(opna0.reg[0][0x00] == 0 && opna0.reg[0][0x01] == 0, "dock0 SSG not restored");
+        CHECK(opn2.reg[0x00] == 0 && opn2.reg[0x01] == 0, "dock2 SSG not restored");
+        CHECK(opna5.reg[0][0x00] == 0 && opna5.reg[0][0x01] == 0, "dock5 SSG not restored");
+
+        // 何も接続されていない
+        HAL* empty[MAX_DOCKS];
+        for (auto& h : empty) {
+            h = &floating;
+        }
+        found = opn_scan(empty, types, MAX_DOCKS);
+        CHECK(found == 0, "empty docks found %02x", (unsigned)found);
+        for (int d = 0; d < MAX_DOCKS; d++) {
+            CHECK(types[d] == OPN_NONE, "empty dock%d %s", d, opn_type_name(types[d]));
+        }
+    }
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,297 @@
+//
+// Copyright (c) 2025 46nori All rights reserved.
+//
+// This code is licensed under the MIT License.
+// See LICENSE file for details.
+//
+// SysExParserとSysExOwnerのテスト
+// 受信したデータ部を記録するハンドラで、
+// - IDの一致と不一致(GM/GS/XGリセットのようなデータ部を持たないメッセージを含む)
+// - IDの途中まで一致してから分岐した場合の最長一致
+// - リングバッファ(128バイト)より長いデータ部と、SysExData()が残した端数の再送
+// - 新しいステータスバイトによる中断(complete=false)
+// - 複数の入力元で共有するハンドラの受信権(SysExOwner)
+// を確認する。
+//
+#include <cstring>
+
+#include "SysExParser.h"
+#include "TestUtil.h"
+
+/**
+ * @brief 受信したデータ部を記録するハンドラ
+ * @details SysExData()はrecordバイト単位で消費し、端数は残す(0の場合は消費しない)
+ */
+class Recorder : public SysExHandler {
+public:
+    static constexpr int MAX_DATA = 2048;
+
+    int record;             // SysExData()で消費する単位
+    int begins    = 0;      // SysExBegin()の回数
+    int ends      = 0;      // SysExEnd()の回数
+    bool complete = false;  // 最後のSysExEnd()のcomplete
+    int last_tag  = -1;     // 最後に受け取ったタグ
+    int max_len   = 0;      // SysExData()に渡された最大のバイト数
+    uint8_t data[MAX_DATA];
+    int len = 0;  // 記録したバイト数
+
+    explicit Recorder(int record = 1) : record(record) {}
+
+    void Clear() {
+        begins = ends = len = max_len = 0;
+        complete                      = false;
+        last_tag                      = -1;
+    }
+
+    void SysExBegin(int tag) override {
+        ++begins;
+        last_tag = tag;
+    }
+    int SysExData(int tag, const uint8_t* d, int n) override {
+        last_tag = tag;
+        if (n > max_len) {
+            max_len = n;
+        }
+        if (record == 0) {
+            return 0;
+        }
+        int used = n - n % record;
+        if (len + used <= MAX_DATA) {
+            memcpy(data + len, d, used);
+            len += used;
+        }
+        return used;
+    }
+    void SysExEnd(int tag, bool c) override {
+        ++ends;
+        last_tag = tag;
+        complete = c;
+    }
+};
+
+/**
+ * @brief 複数の入力元で共有するハンドラ(ToneBankなどと同じ受信権の扱い)
+ */
+class SharedRecorder : public Recorder {
+public:
+    SysExOwner rx_owner;
+    int busy = 0;  // 受信権がなく無視したメッセージの数
+
+    void SysExBegin(int tag) override {
+        if (rx_owner.Acquire(tag)) {
+            Recorder::SysExBegin(tag);
+        }
+    }
+    int SysExData(int tag, const uint8_t* d, int n) override {
+        if (!rx_owner.Owns(tag)) {
+            return n;
+        }
+        return Recorder::SysExData(tag, d, n);
+    }
+    void SysExEnd(int tag, bool c) override {
+        if (!rx_owner.Release(tag)) {
+            ++busy;
+            return;
+        }
+        Recorder::SysExEnd(tag, c);
+    }
+};
+
+// メッセージを1バイトずつ入力する
+static void push(SysExParser& parser, const uint8_t* msg, int len) {
+    for (int i = 0; i < len; i++) {
+        parser.Push(msg[i]);
+    }
+}
+
+static constexpr uint8_t GM_SYSTEM_ON[] = {0x7e, 0x7f, 0x09, 0x01};
+static constexpr uint8_t XG_RESET[]     = {0x43, 0x10, 0x4c, 0x00, 0x00, 0x7e, 0x00};
+static constexpr uint8_t SHORT_ID[]     = {0x7d};
+static constexpr uint8_t LONG_ID[]      = {0x7d, 0x46, 0x01};
+
+int main() {
+    // IDの一致と不一致
+    {
+        SysExParser parser;
+        Recorder reset, xg;
+        parser.Register(GM_SYSTEM_ON, sizeof(GM_SYSTEM_ON), &reset, 1, true);
+        parser.Register(XG_RESET, sizeof(XG_RESET), &xg, 2, true);
+
+        const uint8_t gm_on[] = {0xf0, 0x7e, 0x7f, 0x09, 0x01, 0xf7};
+        push(parser, gm_on, sizeof(gm_on));
+        CHECK(reset.begins == 1 && reset.ends == 1 && reset.complete && reset.last_tag == 1,
+              "GM System On: begins=%d ends=%d complete=%d tag=%d", reset.begins, reset.ends,
+              reset.complete, reset.last_tag);
+        CHECK(!parser.IsActive(), "parser active after $F7");
+
+        // 最後のバイトが異なる
+        reset.Clear();
+        const uint8_t gm_off[] = {0xf0, 0x7e, 0x7f, 0x09, 0x02, 0xf7};
+        push(parser, gm_off, sizeof(gm_off));
+        CHECK(reset.begins == 0 && reset.ends == 0, "GM System Off matched GM System On");
+
+        // 登録していないメーカーID
+        const uint8_t roland[] = {0xf0, 0x41, 0x10, 0x42, 0x12, 0xf7};
+        push(parser, roland, sizeof(roland));
+        CHECK(reset.begins == 0 && xg.begins == 0, "unregistered ID matched");
+
+        // データ部を持たないメッセージにデータが続く
+        const uint8_t gm_extra[] = {0xf0, 0x7e, 0x7f, 0x09, 0x01, 0x00, 0xf7};
+        push(parser, gm_extra, sizeof(gm_extra));
+        CHECK(reset.ends == 1 && !reset.complete, "GM System On with data: ends=%d complete=%d",
+              reset.ends, reset.complete);
+
+        // XGリセットの途中(6バイト目)で分岐する
+        reset.Clear();
+        const uint8_t xg_diverge[] = {0xf0, 0x43, 0x10, 0x4c, 0x00, 0x00, 0x7f, 0x00, 0xf7};
+        push(parser, xg_diverge, sizeof(xg_diverge));
+        CHECK(xg.begins == 0 && reset.begins == 0, "diverged XG reset matched");
+
+        const uint8_t xg_reset[] = {0xf0, 0x43, 0x10, 0x4c, 0x00, 0x00, 0x7e, 0x00, 0xf7};
+        push(parser, xg_reset, sizeof(xg_reset));
+        CHECK(xg.begins == 1 && xg.ends == 1 && xg.complete, "XG reset not matched");
+    }
+
+    // IDの途中まで一致してから分岐した場合は、それまでの最長一致のハンドラに渡す
+    {
+        SysExParser parser;
+        Recorder shorter, longer;
+        parser.Register(SHORT_ID, sizeof(SHORT_ID), &shorter, 1);
+        parser.Register(LONG_ID, sizeof(LONG_ID), &longer, 2);
+
+        const uint8_t diverge[] = {0xf0, 0x7d, 0x46, 0x02, 0x10, 0xf7};
+        push(parser, diverge, sizeof(diverge));
+        const uint8_t expected[] = {0x46, 0x02, 0x10};
+        CHECK(longer.begins == 0, "longer ID matched after divergence");
+        CHECK(shorter.begins == 1 && shorter.ends == 1 && shorter.complete, "shorter ID not matched");
+        CHECK(shorter.len == 3 && memcmp(shorter.data, expected, 3) == 0,
+              "shorter ID received %d bytes", shorter.len);
+
+        // 全体が一致した場合は長い方
+        shorter.Clear();
+        const uint8_t full[] = {0xf0, 0x7d, 0x46, 0x01, 0x10, 0x20, 0xf7};
+        push(parser, full, sizeof(full));
+        CHECK(longer.begins == 1 && longer.complete && shorter.begins == 0, "longest match failed");
+        CHECK(longer.len == 2 && longer.data[0] == 0x10 && longer.data[1] == 0x20,
+              "longer ID received %d bytes", longer.len);
+
+        // IDの途中で終了した場合も、それまでの最長一致で確定する
+        shorter.Clear();
+        const uint8_t truncated[] = {0xf0, 0x7d, 0x46, 0xf7};
+        push(parser, truncated, sizeof(truncated));
+        CHECK(shorter.begins == 1 && shorter.complete && shorter.len == 1 &&
+                  shorter.data[0] == 0x46,
+              "truncated ID: begins=%d len=%d", shorter.begins, shorter.len);
+    }
+
+    // リングバッファより長いデータ部を、7バイト単位で消費するハンドラで受信する
+    {
+        SysExParser parser;
+        Recorder records(7);
+        parser.Register(LONG_ID, sizeof(LONG_ID), &records, 3);
+
+        static uint8_t payload[1001];  // 7の倍数(143レコード)
+        for (int i = 0; i < (int)sizeof(payload); i++) {
+            payload[i] = (uint8_t)((i * 37) & 0x7f);
+        }
+        parser.Push(0xf0);
+        push(parser, LONG_ID, sizeof(LONG_ID));
+        for (int i = 0; i < (int)sizeof(payload); i++) {
+            parser.Push(payload[i]);
+            if (i == 500) {
+                parser.Push(0xf8);  // リアルタイムメッセージは読み飛ばす
+            }
+        }
+        CHECK(parser.IsActive(), "parser not active during long payload");
+        parser.Push(0xf7);
+        CHECK(records.ends == 1 && records.complete, "long payload: ends=%d complete=%d",
+              records.ends, records.complete);
+        CHECK(records.len == (int)sizeof(payload), "long payload: received %d bytes", records.len);
+        CHECK(memcmp(records.data, payload, sizeof(payload)) == 0, "long payload corrupted");
+        CHECK(records.max_len <= SysExParser::BUFFER_SIZE, "passed %d bytes at once",
+              records.max_len);
+
+        // 消費しないハンドラはバッファ溢れで中断する
+        SysExParser stalled;
+        Recorder never(0);
+        stalled.Register(LONG_ID, sizeof(LONG_ID), &never, 4);
+        stalled.Push(0xf0);
+        push(stalled, LONG_ID, sizeof(LONG_ID));
+        for (int i = 0; i < SysExParser::BUFFER_SIZE + 1; i++) {
+            stalled.Push(0x00);
+        }
+        CHECK(never.ends == 1 && !never.complete, "overflow: ends=%d complete=%d", never.ends,
+              never.complete);
+        stalled.Push(0xf7);
+        CHECK(never.ends == 1 && !stalled.IsActive(), "overflow: ended twice");
+    }
+
+    // 新しいステータスバイトによる中断
+    {
+        SysExParser parser;
+        Recorder records;
+        parser.Register(LONG_ID, sizeof(LONG_ID), &records, 5);
+
+        const uint8_t head[] = {0xf0, 0x7d, 0x46, 0x01, 0x10, 0x20};
+        push(parser, head, sizeof(head));
+        bool consumed = parser.Push(0x90);
+        CHECK(!consumed, "status byte consumed by SysEx");
+        CHECK(records.begins == 1 && records.ends == 1 && !records.complete,
+              "abort: begins=%d ends=%d complete=%d", records.begins, records.ends,
+              records.complete);
+        CHECK(!parser.IsActive(), "parser active after abort");
+        CHECK(!parser.Push(0x3c), "data byte after abort consumed by SysEx");
+
+        // IDの照合中に中断した場合も、一致していたハンドラに終了を通知する
+        records.Clear();
+        const uint8_t matching[] = {0xf0, 0x7d, 0x46, 0x01};
+        push(parser, matching, sizeof(matching));
+        parser.Abort();
+        CHECK(records.begins == 1 && records.ends == 1 && !records.complete,
+              "Abort(): begins=%d ends=%d complete=%d", records.begins, records.ends,
+              records.complete);
+    }
+
+    // 複数の入力元で共有するハンドラ
+    {
+        SysExParser parser[2];
+        SharedRecorder shared;
+        shared.record = 1;
+        for (int src = 0; src < 2; src++) {
+            parser[src].Register(LONG_ID, sizeof(LONG_ID), &shared, sysex_tag(src, 6));
+        }
+        const uint8_t msg0[] = {0xf0, 0x7d, 0x46, 0x01, 0x00, 0x01, 0x02, 0x03, 0xf7};
+        const uint8_t msg1[] = {0xf0, 0x7d, 0x46, 0x01, 0x10, 0x11, 0x12, 0x13, 0xf7};
+
+        // 入力元0の受信中に、入力元1のメッセージが割り込む
+        push(parser[0], msg0, 6);
+        push(parser[1], msg1, sizeof(msg1));
+        push(parser[0], msg0 + 6, sizeof(msg0) - 6);
+        CHECK(shared.busy == 1, "busy %d", shared.busy);
+        CHECK(shared.begins == 1 && shared.ends == 1 && shared.complete,
+              "owner: begins=%d ends=%d", shared.begins, shared.ends);
+        CHECK(sysex_tag_source(shared.last_tag) == 0 && sysex_tag_value(shared.last_tag) == 6,
+              "owner tag %x", shared.last_tag);
+        CHECK(shared.len == 4 && memcmp(shared.data, msg0 + 4, 4) == 0,
+              "owner received %d bytes", shared.len);
+
+        // 受信権が解放された後は、入力元1のメッセージを受け付ける
+        shared.Clear();
+        push(parser[1], msg1, sizeof(msg1));
+        CHECK(shared.busy == 1 && shared.begins == 1 && shared.complete,
+              "second source: busy=%d begins=%d", shared.busy, shared.begins);
+        CHECK(sysex_tag_source(shared.last_tag) == 1, "second source tag %x", shared.last_tag);
+        CHECK(shared.len == 4 && memcmp(shared.data, msg1 + 4, 4) == 0,
+              "second source received %d bytes", shared.len);
+
+        // 中断しても受信権は解放される
+        shared.Clear();
+        push(parser[0], msg0, 6);
+        parser[0].Push(0x90);
+        push(parser[1], msg1, sizeof(msg1));
+        CHECK(shared.busy == 1 && shared.ends == 2 && shared.complete,
+              "after abort: busy=%d ends=%d", shared.busy, shared.ends);
+    }
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2025 46nori All rights reserved.
+#
+# This code is licensed under the MIT License.
+# See LICENSE file for details.
+#
+"""
+VOICE.dat形式のCSM音声データをフレーズバンクに変換し、SysExファイルを出力する。
+
+フレーズの範囲はPitchのbit14(先頭フレーム)とbit15(最終フレーム)で指定する。
+フレーズバンクの形式はmidi/voice/CsmFrameTable.hと同じ。
+
+usage: csm_phrase_pack.py VOICE.dat LSB out.syx
+"""
+import re
+import sys
+
+PITCH_MASK = 0x03FF
+PHRASE_START = 0x4000
+PHRASE_END = 0x8000
+LAST_FRAME = 0x80000000
+MAX_PHRASES = 128
+
+
+def to_fnumber(freq):
+    # CsmFrameTable.hのto_fnumber()と同じ変換
+    for blk in range(5, -1, -1):
+        f = (38 * freq) >> blk
+        if f < 2048:
+            return ((blk << 11) | f) & 0x3FFF
+    return 0
+
+
+def parse(path):
+    frames = []
+    pattern = re.compile(r"\{\s*(0x[0-9a-fA-F]+|\d+)\s*,\s*\{([^}]*)\}\s*,\s*\{([^}]*)\}\s*\}")
+    for m in pattern.finditer(open(path).read()):
+        tl = [int(x, 0) for x in m.group(2).split(",")]
+        freq = [int(x, 0) for x in m.group(3).split(",")]
+        frames.append((int(m.group(1), 0), tl, freq))
+    return frames
+
+
+def varint(v):
+    z = (v << 1) if v >= 0 else ((-v) << 1) - 1
+    out = bytearray()
+    while z >= 0x80:
+        out.append((z & 0x7F) | 0x80)
+        z >>= 7
+    out.append(z)
+    return out
+
+
+def encode(frames):
+    starts = [i for i, f in enumerate(frames) if f[0] & PHRASE_START]
+    ends = [i for i, f in enumerate(frames) if f[0] & PHRASE_END]
+    if not starts or len(starts) != len(ends) or len(starts) > MAX_PHRASES:
+        raise ValueError("unbalanced phrase marks")
+
+    header = 3 + len(starts) * 2
+    body = bytearray()
+    offsets = []
+    for start, end in zip(starts, ends):
+        offsets.append(header + len(body))
+        prev = None
+        for i in range(start, end + 1):
+            pitch, tl, freq = frames[i]
+            value = [pitch & PITCH_MASK] + tl + [to_fnumber(f) for f in freq]
+            if prev is None:
+                prev = [0] * len(value)
+            mask = LAST_FRAME if i == end else 0
+            deltas = bytearray()
+            for n, (v, p) in enumerate(zip(value, prev)):
+                if v != p:
+                    mask |= 1 << n
+                    deltas += varint(v - p)
+            body += mask.to_bytes(4, "little") + deltas
+            prev = value
+
+    size = header + len(body)
+    bank = size.to_bytes(2, "little") + bytes([len(starts)])
+    for offset in offsets:
+        bank += offset.to_bytes(2, "little")
+    return bank + body
+
+
+def main():
+    if len(sys.argv) != 4:
+        print(__doc__)
+        sys.exit(1)
+    bank = encode(parse(sys.argv[1]))
+    lsb = int(sys.argv[2], 0) & 0x7F
+    nibbles = bytearray()
+    for b in bank:
+        nibbles += bytes([b >> 4, b & 0x0F])
+    with open(sys.argv[3], "wb") as f:
+        f.write(bytes([0xF0, 0x7D, 0x46, 0x04, lsb]) + nibbles + bytes([0xF7]))
+    print("%d phrases, %d bytes" % (bank[2], len(bank)))
+
+
+if __name__ == "__main__":
+    main()
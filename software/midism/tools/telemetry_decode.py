@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2025 46nori All rights reserved.
+#
+# This code is licensed under the MIT License.
+# See LICENSE file for details.
+#
+"""
+統計情報のSysEx応答(F0 7D 46 11 ss vv [データ] F7)をテキストに変換する。
+
+応答はSysExライブラリアンなどで受信し、.syxファイル(バイナリ)に保存しておく。
+ファイルに複数のメッセージが含まれていてもよい。-rを指定すると、要求メッセージ
+(F0 7D 46 10 ss F7)を.syxファイルに書き出す。ssを省略すると全セクションを要求する。
+
+usage: telemetry_decode.py response.syx
+       telemetry_decode.py -r request.syx [section]
+"""
+import struct
+import sys
+
+REQUEST_ID = bytes([0x7D, 0x46, 0x10])
+RESPONSE_ID = bytes([0x7D, 0x46, 0x11])
+FORMAT_VERSION = 1
+
+BUS_CLASSES = ["FM_OP", "FM_CH", "KEYON", "RHYTHM", "SSG", "TIMER", "PORT", "STAT", "OTHER"]
+LATENCY_TYPES = ["NoteOn", "NoteOn+load", "NoteOff", "Control", "Program", "Other"]
+LATENCY_STAGES = ["dispatch", "key on", "done"]
+ALLOC_PATHS = ["local", "pool", "steal", "failure"]
+
+
+def unpack7(data):
+    # 先頭の1byteに続く最大7byteのbit7を復元する
+    out = bytearray()
+    for i in range(0, len(data), 8):
+        msb, group = data[i], data[i + 1 : i + 8]
+        for j, b in enumerate(group):
+            out.append(b | (((msb >> j) & 1) << 7))
+    return bytes(out)
+
+
+def upper(index):
+    if index < 2:
+        return index
+    e = index // 2
+    return ((2 + (index & 1)) << (e - 1)) + (1 << (e - 1)) - 1
+
+
+def percentile(buckets, count, vmax, percent):
+    rank = (count * percent + 99) // 100
+    total = 0
+    for i, n in enumerate(buckets):
+        total += n
+        if total >= rank:
+            return min(upper(i) if i < len(buckets) - 1 else vmax, vmax)
+    return vmax
+
+
+def print_summary(w):
+    names = ["uptime(ms)", "voice fail", "voice steal", "tone load", "CH3 revoke",
+             "CH3 revoke cut", "trace drop core0", "trace drop core1"]
+    for name, v in zip(names, w):
+        print("  %-18s %u" % (name, v))
+    sources = w[8]
+    print("  batch high-water  " + " ".join("%u" % v for v in w[9 : 9 + sources]))
+
+
+def print_channels(w):
+    for ch in range(w[0]):
+        ok, ng, active, hold = w[1 + 4 * ch : 5 + 4 * ch]
+        line = "  CH=%02d release ok=%u fail=%u" % (ch, ok, ng)
+        if active != 0xFFFFFFFF:
+            line += " max activeQ=%u holdQ=%u" % (active, hold)
+        print(line)
+
+
+def print_bus(w):
+    docks, classes = w[0], w[1]
+    p = 2
+    for d in range(docks):
+        for c in range(classes):
+            writes, reads, busy = w[p : p + 3]
+            p += 3
+            if writes or reads:
+                name = BUS_CLASSES[c] if c < len(BUS_CLASSES) else str(c)
+                print("  DOCK%d %-7s writes=%u reads=%u busy=%uus" % (d, name, writes, reads, busy))
+    for core in range(2):
+        count, contended, wait, max_wait = w[p : p + 4]
+        p += 4
+        print("  core%d access=%u wait=%u total=%uus max=%uus" % (core, count, contended, wait,
+                                                                  max_wait))
+
+
+def print_latency(w):
+    types, stages, buckets = w[0], w[1], w[2]
+    p = 3
+    print("  %-20s %7s %6s %6s %6s" % ("(us)", "count", "p50", "p99", "max"))
+    for t in range(types):
+        for s in range(stages):
+            count, vmax = w[p], w[p + 1]
+            hist = w[p + 2 : p + 2 + buckets]
+            p += 2 + buckets
+            if count:
+                print("  %-11s %-8s %7u %6u %6u %6u" % (LATENCY_TYPES[t], LATENCY_STAGES[s], count,
+                      percentile(hist, count, vmax, 50), percentile(hist, count, vmax, 99), vmax))
+
+
+def print_alloc(w):
+    paths = w[0]
+    count, loads = w[1 : 1 + paths], w[1 + paths : 1 + 2 * paths]
+    p = 1 + 2 * paths
+    hint, hit, elapsed, voices = w[p : p + 4]
+    for name, n, load in zip(ALLOC_PATHS, count, loads):
+        print("  %-7s %8u (tone load %u)" % (name, n, load))
+    print("  affinity %u/%u (%u%%)" % (hit, hint, hit * 100 // hint if hint else 0))
+    busy = w[p + 4 : p + 4 + voices]
+    print("  busy(%%) in %ums: " % elapsed +
+          " ".join("%02d:%u" % (i, b * 100 // elapsed if elapsed else 0) for i, b in enumerate(busy)))
+
+
+def print_banks(w):
+    # 未使用のスロットは-1(0xFFFFFFFF)
+    tones, rev = w[0], w[1]
+    print("  tone bank rev=%u" % rev)
+    for i, msb in enumerate(w[2 : 2 + tones]):
+        print("    USER%d: %s" % (i, "---" if msb == 0xFFFFFFFF else "MSB=%3u" % msb))
+    p = 2 + tones
+    phrases, rev = w[p], w[p + 1]
+    if phrases:
+        print("  phrase bank rev=%u" % rev)
+    for i in range(phrases):
+        lsb, count = w[p + 2 + i * 2], w[p + 3 + i * 2]
+        print("    USER%d: %s" % (i, "---" if lsb == 0xFFFFFFFF else "LSB=%3u %uphrases" % (lsb, count)))
+
+
+SECTIONS = [("Summary", print_summary), ("Channels", print_channels), ("Bus", print_bus),
+            ("Latency", print_latency), ("Alloc", print_alloc), ("Banks", print_banks)]
+
+
+def decode(msg):
+    section, version = msg[4], msg[5]
+    if version != FORMAT_VERSION:
+        print("unsupported format version %d" % version)
+        return
+    raw = unpack7(msg[6:-1])
+    words = struct.unpack("<%dI" % (len(raw) // 4), raw[: len(raw) // 4 * 4])
+    if section >= len(SECTIONS):
+        print("unknown section %d" % section)
+        return
+    name, func = SECTIONS[section]
+    print("[%s]" % name)
+    func(words)
+
+
+def main():
+    argv = sys.argv[1:]
+    if len(argv) >= 2 and argv[0] == "-r":
+        section = int(argv[2], 0) if len(argv) > 2 else 0x7F
+        open(argv[1], "wb").write(bytes([0xF0]) + REQUEST_ID + bytes([section, 0xF7]))
+        return
+    if len(argv) != 1:
+        print(__doc__)
+        sys.exit(1)
+    data = open(argv[0], "rb").read()
+    start = 0
+    while True:
+        start = data.find(bytes([0xF0]) + RESPONSE_ID, start)
+        if start < 0:
+            break
+        end = data.find(b"\xf7", start)
+        if end < 0:
+            break
+        decode(data[start : end + 1])
+        start = end + 1
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2025 46nori All rights reserved.
+#
+# This code is licensed under the MIT License.
+# See LICENSE file for details.
+#
+"""
+トレースの生データ(デバッガの`tr 1`で出力される`@T`行)をテキストに変換する。
+
+イベントの書式はdiag/TraceEvents.hから読み込むので、ファームウェアと同じ版を使うこと。
+`@T`以外の行はそのまま出力する。-sを指定すると、両コアのレコードを時刻順に並べ替える。
+
+usage: trace_decode.py [-s] [log.txt]
+"""
+import os
+import re
+import sys
+
+EVENTS_H = os.path.join(os.path.dirname(__file__), "..", "diag", "TraceEvents.h")
+
+
+def load_events(path):
+    pattern = re.compile(r'X\(\s*(\w+)\s*,\s*(\d+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+    return [(m.group(1), m.group(3)) for m in pattern.finditer(open(path).read())]
+
+
+def decode(line, events):
+    # @T core time event arg0 arg1 arg2
+    f = line.split()
+    core, time, event = int(f[1]), int(f[2]), int(f[3])
+    args = tuple(int(x) for x in f[4:7])
+    if event >= len(events):
+        return time, "%10u %d| ?%d %d %d %d" % ((time, core, event) + args)
+    name, fmt = events[event]
+    n = fmt.count("%") - 2 * fmt.count("%%")
+    return time, "%10u %d| %s" % (time, core, fmt % args[:n])
+
+
+def main():
+    argv = sys.argv[1:]
+    sort = "-s" in argv
+    argv = [a for a in argv if a != "-s"]
+    if len(argv) > 1:
+        print(__doc__)
+        sys.exit(1)
+    events = load_events(EVENTS_H)
+    src = open(argv[0]) if argv else sys.stdin
+
+    records = []
+    for line in src:
+        line = line.rstrip("\r\n")
+        record = None
+        if line.startswith("@T "):
+            try:
+                record = decode(line, events)
+            except (ValueError, IndexError, TypeError):
+                pass
+        if not sort:
+            print(record[1] if record else line)
+        elif record:
+            records.append(record)
+    for _, text in sorted(records, key=lambda r: r[0]):
+        print(text)
+
+if __name__ == "__main__":
+    main()
@@ -24,6 +24,7 @@
  *
  */
 
+#include "config.h"
 #include "tusb.h"
 
 /* A combination of interfaces must have a unique product id, since PC will save device driver after the first plug.
@@ -70,7 +71,47 @@ uint8_t const* tud_descriptor_device_cb(void) {
 
 enum { ITF_NUM_MIDI = 0, ITF_NUM_MIDI_STREAMING, ITF_NUM_TOTAL };
 
-#define CONFIG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + TUD_MIDI_DESC_LEN)
+// MIDI_CABLES本の仮想ケーブル(Embedded Jack)を持つMIDIインターフェース
+// TUD_MIDI_DESCRIPTOR()はケーブル1本分なので、構成要素のマクロから組み立てる
+#if MIDI_CABLES < 1 || MIDI_CABLES > 4
+#error "MIDI_CABLES must be 1-4"
+#endif
+#define MIDI_DESC_LEN                                                \
+    (TUD_MIDI_DESC_HEAD_LEN + TUD_MIDI_DESC_JACK_LEN * MIDI_CABLES + \
+     TUD_MIDI_DESC_EP_LEN(MIDI_CABLES) * 2)
+
+#if MIDI_CABLES == 1
+#define MIDI_DESC_JACKS TUD_MIDI_DESC_JACK(1)
+#define MIDI_JACKID_IN  TUD_MIDI_JACKID_IN_EMB(1)
+#define MIDI_JACKID_OUT TUD_MIDI_JACKID_OUT_EMB(1)
+#elif MIDI_CABLES == 2
+#define MIDI_DESC_JACKS TUD_MIDI_DESC_JACK(1), TUD_MIDI_DESC_JACK(2)
+#define MIDI_JACKID_IN  TUD_MIDI_JACKID_IN_EMB(1), TUD_MIDI_JACKID_IN_EMB(2)
+#define MIDI_JACKID_OUT TUD_MIDI_JACKID_OUT_EMB(1), TUD_MIDI_JACKID_OUT_EMB(2)
+#elif MIDI_CABLES == 3
+#define MIDI_DESC_JACKS TUD_MIDI_DESC_JACK(1), TUD_MIDI_DESC_JACK(2), TUD_MIDI_DESC_JACK(3)
+#define MIDI_JACKID_IN \
+    TUD_MIDI_JACKID_IN_EMB(1), TUD_MIDI_JACKID_IN_EMB(2), TUD_MIDI_JACKID_IN_EMB(3)
+#define MIDI_JACKID_OUT \
+    TUD_MIDI_JACKID_OUT_EMB(1), TUD_MIDI_JACKID_OUT_EMB(2), TUD_MIDI_JACKID_OUT_EMB(3)
+#else
+#define MIDI_DESC_JACKS \
+    TUD_MIDI_DESC_JACK(1), TUD_MIDI_DESC_JACK(2), TUD_MIDI_DESC_JACK(3), TUD_MIDI_DESC_JACK(4)
+#define MIDI_JACKID_IN                                                                   \
+    TUD_MIDI_JACKID_IN_EMB(1), TUD_MIDI_JACKID_IN_EMB(2), TUD_MIDI_JACKID_IN_EMB(3), \
+        TUD_MIDI_JACKID_IN_EMB(4)
+#define MIDI_JACKID_OUT                                                                     \
+    TUD_MIDI_JACKID_OUT_EMB(1), TUD_MIDI_JACKID_OUT_EMB(2), TUD_MIDI_JACKID_OUT_EMB(3), \
+        TUD_MIDI_JACKID_OUT_EMB(4)
+#endif
+
+// Interface number, string index, EP Out & EP In address, EP size
+#define MIDI_DESCRIPTOR(_itfnum, _stridx, _epout, _epin, _epsize)          \
+    TUD_MIDI_DESC_HEAD(_itfnum, _stridx, MIDI_CABLES), MIDI_DESC_JACKS,    \
+        TUD_MIDI_DESC_EP(_epout, _epsize, MIDI_CABLES), MIDI_JACKID_IN,    \
+        TUD_MIDI_DESC_EP(_epin, _epsize, MIDI_CABLES), MIDI_JACKID_OUT
+
+#define CONFIG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + MIDI_DESC_LEN)
 
 #if CFG_TUSB_MCU == OPT_MCU_LPC175X_6X || CFG_TUSB_MCU == OPT_MCU_LPC177X_8X || \
     CFG_TUSB_MCU == OPT_MCU_LPC40XX
@@ -87,7 +128,7 @@ uint8_t const desc_fs_configuration[] = {
                           100),
 
     // Interface number, string index, EP Out & EP In address, EP size
-    TUD_MIDI_DESCRIPTOR(ITF_NUM_MIDI, 0, EPNUM_MIDI, 0x80 | EPNUM_MIDI, 64)};
+    MIDI_DESCRIPTOR(ITF_NUM_MIDI, 0, EPNUM_MIDI, 0x80 | EPNUM_MIDI, 64)};
 
 #if TUD_OPT_HIGH_SPEED
 uint8_t const desc_hs_configuration[] = {
@@ -96,7 +137,7 @@ uint8_t const desc_hs_configuration[] = {
                           100),
 
     // Interface number, string index, EP Out & EP In address, EP size
-    TUD_MIDI_DESCRIPTOR(ITF_NUM_MIDI, 0, EPNUM_MIDI, 0x80 | EPNUM_MIDI, 512)};
+    MIDI_DESCRIPTOR(ITF_NUM_MIDI, 0, EPNUM_MIDI, 0x80 | EPNUM_MIDI, 512)};
 #endif
 
 // Invoked when received GET CONFIGURATION DESCRIPTOR